@@ -96,7 +96,7 @@ function CompileWithOption() {
 }
 
 function CommonArgs() {
-    echo "-o $object_id -c $case_id -e $entry_id -t $table_size -p $opt_num -l $load_factor -h $hit_percent -b $bin_size -q $quotient_tail_length -n $thread_num -z $zipfian_skew -f "$res_path""
+    echo "-o $object_id -c $case_id -e $entry_id -t $table_size -p $opt_num -l $load_factor -h $hit_percent -b $bin_size -q $quotient_tail_length -n $thread_num -z $zipfian_skew $zipfian_shuffle $adaptive_chains $fingerprint_lane -f "$res_path""
 }
 
 function CommonArgsWithYCSB() {
@@ -327,6 +327,9 @@ CompileWithOption
 
 thread_num=0
 zipfian_skew=0
+zipfian_shuffle=""
+adaptive_chains=""
+fingerprint_lane=""
 
 table_size=1
 opt_num=0
@@ -339,7 +342,7 @@ bin_size=127
 
 no_resize_object_ids=(6 7 15 17 20 24)
 space_eff_object_ids=(6 7 15 17 23 24)
-resize_object_ids=(6 7 15 18 21 24)
+resize_object_ids=(6 7 15 18 21 24 27 28)
 rss_object_ids=(6 7 15 18 21 24 25)
 
 # YCSB with resize
@@ -357,6 +360,23 @@ done
 thread_num=0
 enable_core_binding=false
 
+# YCSB write scaling, shared ResizableBlastHT against delegation to shard
+# owners; the entry id carries the thread count
+
+enable_core_binding=true
+for thread_num in 1 2 4 8 16 32 64; do
+    for case_id in 17 18 19 20 21 22; do
+        entry_id=$thread_num
+        for object_id in 21 29; do
+            for table_size in 33554432; do
+                RunWithRetry "RunYCSB"
+            done
+        done
+    done
+done
+thread_num=0
+enable_core_binding=false
+
 # YCSB with resize latency percentile
 
 thread_num=16
@@ -580,6 +600,80 @@ for case_id in 16; do
     done
 done
 
+# adaptive chains under skew, hops per hit with and without -a
+# -k maps the ranks to random keys; in insertion order the hot keys would
+# sit at the chain heads already
+
+zipfian_shuffle="-k"
+for case_id in 6; do
+    for object_id in 4; do
+        entry_id=0
+        for table_size in 16777215; do
+            opt_num=15099493
+            # the default tail length keeps chains too short to matter
+            for quotient_tail_length in 0 22; do
+                for zipfian_skew in 0 0.5 0.99 1.2; do
+                    for adaptive_chains in "" "-a"; do
+                        RunWithRetry "Run"
+                        let "entry_id++"
+                    done
+                done
+            done
+        done
+    done
+done
+quotient_tail_length=0
+zipfian_skew=0
+zipfian_shuffle=""
+adaptive_chains=""
+
+# skulker misses with and without the fingerprint lane, against blast
+
+for case_id in 7; do
+    entry_id=0
+    for table_size in 67108863; do
+        opt_num=63753420
+        object_id=20
+        RunWithRetry "Run"
+        object_id=14
+        for fingerprint_lane in "" "-g"; do
+            RunWithRetry "Run"
+            let "entry_id++"
+        done
+    done
+done
+fingerprint_lane=""
+
+# same-bin and bin-aware chains against plain byte array chains, concurrent
+
+thread_num=16
+for case_id in 1 3 6 7; do
+    for object_id in 17 30 31; do
+        entry_id=0
+        for table_size in 67108863; do
+            opt_num=63753420
+            RunWithRetry "Run"
+        done
+    done
+done
+thread_num=0
+
+# dereference table allocate and query latency, one thread, 4M keys in a
+# 1.05x table, for the inlined bin hashes and the vectorized bin scan
+
+for case_id in 9; do
+    for object_id in 0; do
+        entry_id=0
+        for table_size in 4404019; do
+            load_factor=0.95238
+            opt_num=4194304
+            RunWithRetry "Run"
+            let "entry_id++"
+        done
+    done
+done
+load_factor=1
+
 exit
 
 exit
@@ -26,9 +26,11 @@
 #include "benchmark_chainedht64.h"
 #include "benchmark_clht.h"
 #include "benchmark_cli_para.h"
+#include "benchmark_conc_bin_aware_chainedht.h"
 #include "benchmark_conc_bytearray_ht.h"
 #include "benchmark_conc_skulkerht.h"
 #include "benchmark_cuckoo.h"
+#include "benchmark_delegated_blast_ht.h"
 #include "benchmark_dereftab64.h"
 #include "benchmark_hash_distribution.h"
 // #include "benchmark_growt.h"
@@ -39,6 +41,7 @@
 #include "benchmark_object_64.h"
 #include "benchmark_resizable_blastht.h"
 #include "benchmark_resizable_bytearray_ht.h"
+#include "benchmark_resizable_ht.h"
 #include "benchmark_resizable_skulkerht.h"
 #include "benchmark_same_bin_chainedht.h"
 #include "benchmark_skulkerht.h"
@@ -176,7 +179,15 @@ void Benchmark::obj_fill_vec_prepare(std::vector<uint64_t>& key_vec,
 }
 
 void Benchmark::obj_fill(std::vector<uint64_t>& key_vec,
-                         std::vector<uint64_t>& value_vec) {
+                         std::vector<uint64_t>& value_vec,
+                         std::vector<uint8_t>* ptr_vec) {
+    if (ptr_vec) {
+        ptr_vec->resize(key_vec.size());
+        for (int i = 0; i < key_vec.size(); ++i) {
+            (*ptr_vec)[i] = obj->Insert(key_vec[i], value_vec[i]);
+        }
+        return;
+    }
     for (int i = 0; i < key_vec.size(); ++i) {
         obj->Insert(key_vec[i], value_vec[i]);
     }
@@ -190,9 +201,13 @@ void Benchmark::obj_fill_mem_free(int ins_cnt) {
 
 void Benchmark::batch_query_vec_prepare(std::vector<uint64_t>& key_vec,
                                         std::vector<uint64_t>& query_key_vec,
-                                        uint64_t op_cnt, double hit_rate) {
+                                        uint64_t op_cnt, double hit_rate,
+                                        std::vector<uint8_t>* ptr_vec,
+                                        std::vector<uint8_t>* query_ptr_vec) {
     query_key_vec.clear();
-    // TODO: consider ptr here
+    if (query_ptr_vec) {
+        query_ptr_vec->clear();
+    }
 
     uint32_t hit_bar;
     if (hit_rate > 1 - kEps) {
@@ -208,17 +223,24 @@ void Benchmark::batch_query_vec_prepare(std::vector<uint64_t>& key_vec,
     int key_ind_range = key_vec.size();
 
     if (zipfian_skew > kEps) {
-        ZipfianGenerator zipfian_generator(key_ind_range, zipfian_skew);
+        ZipfianGenerator zipfian_generator(key_ind_range, zipfian_skew,
+                                           zipfian_shuffle);
         while (op_cnt--) {
             uint64_t key;
 
             if (hit_bar >= (gen_key_hittable() & (~(uint32_t(0))))) {
                 int key_ind = zipfian_generator.next();
                 key = key_vec[key_ind];
-                // TODO: consider ptr here
+                if (query_ptr_vec) {
+                    query_ptr_vec->push_back((*ptr_vec)[key_ind]);
+                }
             } else {
                 key = gen_key_miss();
-                // TODO: consider ptr here
+                // a missing key can only be looked up in the overflow table
+                if (query_ptr_vec) {
+                    query_ptr_vec->push_back(
+                        DereferenceTable64::kOverflowTinyPtr);
+                }
             }
 
             query_key_vec.push_back(key);
@@ -231,10 +253,16 @@ void Benchmark::batch_query_vec_prepare(std::vector<uint64_t>& key_vec,
             if (hit_bar >= (gen_key_hittable() & (~(uint32_t(0))))) {
                 int key_ind = rgen64() % key_ind_range;
                 key = key_vec[key_ind];
-                // TODO: consider ptr here
+                if (query_ptr_vec) {
+                    query_ptr_vec->push_back((*ptr_vec)[key_ind]);
+                }
             } else {
                 key = gen_key_miss();
-                // TODO: consider ptr here
+                // a missing key can only be looked up in the overflow table
+                if (query_ptr_vec) {
+                    query_ptr_vec->push_back(
+                        DereferenceTable64::kOverflowTinyPtr);
+                }
             }
 
             query_key_vec.push_back(key);
@@ -248,6 +276,25 @@ void Benchmark::batch_query(std::vector<uint64_t>& query_key_vec) {
     }
 }
 
+void Benchmark::batch_query(std::vector<uint64_t>& query_key_vec,
+                            std::vector<uint8_t>& query_ptr_vec) {
+    for (uint64_t i = 0; i < query_key_vec.size(); ++i) {
+        obj->Query(query_key_vec[i], query_ptr_vec[i]);
+    }
+}
+
+void Benchmark::batch_multi_query(std::vector<uint64_t>& query_key_vec) {
+    BenchmarkByteArrayChained* chained_obj =
+        dynamic_cast<BenchmarkByteArrayChained*>(obj);
+    uint64_t values[kMultiQueryBatchSize];
+    bool found[kMultiQueryBatchSize];
+    for (uint64_t i = 0; i < query_key_vec.size(); i += kMultiQueryBatchSize) {
+        uint32_t batch_size = std::min<uint64_t>(kMultiQueryBatchSize,
+                                                 query_key_vec.size() - i);
+        chained_obj->MultiQuery(&query_key_vec[i], batch_size, values, found);
+    }
+}
+
 void Benchmark::batch_query_no_mem(std::vector<uint64_t>& key_vec,
                                    int query_cnt, double hit_rate) {
     uint32_t hit_bar;
@@ -702,7 +749,9 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
       load_factor(para.load_factor),
       hit_ratio(para.hit_percent),
       zipfian_skew(para.zipfian_skew),
+      zipfian_shuffle(para.zipfian_shuffle),
       rand_mem_free(para.rand_mem_free),
+      resize_log(para.resize_log),
       rgen64(rng::random_device_seed{}()),
       rgen128(rng::random_device_seed{}()) {
 
@@ -720,9 +769,9 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
             obj = new BenchmarkStdUnorderedMap64(table_size);
             break;
         case BenchmarkObjectType::BYTEARRAYCHAINEDHT:
-            obj = new BenchmarkByteArrayChained(table_size * 1.031,
-                                                para.quotienting_tail_length,
-                                                para.bin_size);
+            obj = new BenchmarkByteArrayChained(
+                table_size * 1.031, para.quotienting_tail_length,
+                para.bin_size, para.adaptive_chains);
             break;
         case BenchmarkObjectType::BINAWARECHAINEDHT:
             obj =
@@ -751,11 +800,20 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
         //     obj = new BenchmarkGrowt(table_size);
         //     break;
         case BenchmarkObjectType::CONCURRENT_SKULKERHT:
-            obj = new BenchmarkConcSkulkerHT(table_size, para.bin_size);
+            obj = new BenchmarkConcSkulkerHT(table_size, para.bin_size,
+                                             para.fingerprint_lane);
             break;
         case BenchmarkObjectType::CONCURRENT_BYTEARRAYCHAINEDHT:
-            obj =
-                new BenchmarkConcByteArrayChainedHT(table_size, para.bin_size);
+            obj = new BenchmarkConcByteArrayChainedHT(
+                table_size, para.bin_size, para.adaptive_chains);
+            break;
+        case BenchmarkObjectType::CONCURRENT_BINAWARECHAINEDHT:
+            obj = new BenchmarkConcBinAwareChainedHT(table_size * 1.11,
+                                                     para.bin_size);
+            break;
+        case BenchmarkObjectType::CONCURRENT_SAMEBINCHAINEDHT:
+            obj = new BenchmarkConcBinAwareChainedHT(table_size * 1.06,
+                                                     para.bin_size, 0);
             break;
         case BenchmarkObjectType::JUNCTION:
             obj = new BenchmarkJunction(table_size);
@@ -781,6 +839,26 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
             obj = new BenchmarkResizableBlastHT(table_size / part_num, part_num,
                                                 thread_num);
         } break;
+        case BenchmarkObjectType::RESIZABLE_HYBRID: {
+            uint64_t part_num = 16;
+            obj = new BenchmarkResizableHybridHT(table_size / part_num,
+                                                 part_num, thread_num);
+        } break;
+        case BenchmarkObjectType::RESIZABLE_YARDEDTPHT: {
+            uint64_t part_num = 16;
+            obj = new BenchmarkResizableYardedTPHT(table_size / part_num,
+                                                   part_num, thread_num);
+        } break;
+        case BenchmarkObjectType::RESIZABLE_BOLTHT: {
+            uint64_t part_num = 16;
+            obj = new BenchmarkResizableBoltHT(table_size / part_num, part_num,
+                                               thread_num);
+        } break;
+        case BenchmarkObjectType::DELEGATED_BLAST: {
+            uint64_t part_num = 16;
+            obj = new BenchmarkDelegatedBlastHT(table_size / part_num,
+                                                part_num, thread_num);
+        } break;
         case BenchmarkObjectType::STAGGER_BYTEARRAYCHAINEDHT: {
             uint64_t part_num = 16;
             obj = new BenchmarkStaggerByteArrayHT(table_size / part_num,
@@ -1108,11 +1186,16 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
                               << " ns/op" << std::endl;
 
                 if (para.object_id == BenchmarkObjectType::BYTEARRAYCHAINEDHT) {
-                    output_stream
-                        << "Query Entry Count: "
-                        << dynamic_cast<BenchmarkByteArrayChained*>(obj)
-                               ->QueryEntryCnt()
-                        << std::endl;
+                    uint64_t query_entry_cnt =
+                        dynamic_cast<BenchmarkByteArrayChained*>(obj)
+                            ->QueryEntryCnt();
+                    output_stream << "Query Entry Count: " << query_entry_cnt
+                                  << std::endl;
+                    // every query hits, so this is hops per hit; compare
+                    // runs with and without -a across -z skews
+                    output_stream << "Hops Per Hit: "
+                                  << double(query_entry_cnt) / double(opt_num)
+                                  << std::endl;
                 }
                 if (para.object_id == BenchmarkObjectType::SKULKERHT) {
                     output_stream << "Query Entry Count: "
@@ -1181,11 +1264,18 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
             hit_ratio = 0;
         case BenchmarkCaseType::QUERY_HIT_PERCENT_CUSTOM_LOAD_FACTOR:
         query_load_factor:
-            run = [this]() {
+            run = [this, para]() {
                 std::vector<uint64_t> key_vec, value_vec;
                 obj_fill_vec_prepare(key_vec, value_vec,
                                      int(floor(table_size * load_factor)));
 
+                // the dereference table is queried with the tiny pointers
+                // its allocations returned
+                std::vector<uint8_t> ptr_vec;
+                bool with_ptr =
+                    !thread_num &&
+                    para.object_id == BenchmarkObjectType::DEREFTAB64;
+
                 std::vector<std::tuple<uint64_t, uint64_t, uint64_t>> ops;
                 if (thread_num) {
                     vec_to_ops(key_vec, value_vec, ops, ConcOptType::INSERT);
@@ -1196,7 +1286,7 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
                 if (thread_num) {
                     obj->ConcurrentRun(ops, thread_num);
                 } else {
-                    obj_fill(key_vec, value_vec);
+                    obj_fill(key_vec, value_vec, with_ptr ? &ptr_vec : nullptr);
                 }
 
                 auto end = std::chrono::high_resolution_clock::now();
@@ -1221,7 +1311,8 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
                 std::vector<uint64_t> query_key_vec;
                 std::vector<uint8_t> query_ptr_vec;
                 batch_query_vec_prepare(key_vec, query_key_vec, opt_num,
-                                        hit_ratio);
+                                        hit_ratio, &ptr_vec,
+                                        with_ptr ? &query_ptr_vec : nullptr);
 
                 if (thread_num) {
                     vec_to_ops(query_key_vec, ops, ConcOptType::QUERY);
@@ -1231,6 +1322,8 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
 
                 if (thread_num) {
                     obj->ConcurrentRun(ops, thread_num);
+                } else if (with_ptr) {
+                    batch_query(query_key_vec, query_ptr_vec);
                 } else {
                     batch_query(query_key_vec);
                 }
@@ -1382,6 +1475,28 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
                                   << int(duration * 1000000.0 / double(opt_num))
                                   << " ns/op" << std::endl;
 
+                    // the same lookups, with the chain walks interleaved
+                    start = std::chrono::high_resolution_clock::now();
+
+                    batch_multi_query(query_key_vec);
+
+                    end = std::chrono::high_resolution_clock::now();
+                    duration =
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            end - start)
+                            .count();
+
+                    output_stream << "MultiQuery CPU Time: " << duration
+                                  << " ms" << std::endl;
+
+                    output_stream << "MultiQuery Throughput: "
+                                  << int(double(opt_num) / (duration / 1000.0))
+                                  << " ops/s" << std::endl;
+
+                    output_stream << "MultiQuery Latency: "
+                                  << int(duration * 1000000.0 / double(opt_num))
+                                  << " ns/op" << std::endl;
+
                     output_stream << std::endl;
                 }
             };
@@ -1954,6 +2069,10 @@ Benchmark::Benchmark(BenchmarkCLIPara& para)
 void Benchmark::Run() {
     this->run();
 
+    if (resize_log) {
+        obj->DumpResizeLog(output_stream);
+    }
+
     if (rand_mem_free) {
         sleep(1);
     }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <sys/types.h>
+#include <algorithm>
 #include <csignal>
 #include <cstdint>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <numeric>
+#include <random>
 #include <string>
 #include <vector>
 #include "benchmark_case_type.h"
@@ -20,11 +23,14 @@ namespace tinyptr {
 class Benchmark {
    public:
     static constexpr double kEps = 1e-6;
+    static constexpr uint32_t kMultiQueryBatchSize = 256;
 
    private:
     class ZipfianGenerator {
        public:
-        ZipfianGenerator(int n, double skew)
+        // with shuffle_ranks, ranks map to a random permutation of the
+        // indices, so the hot keys are not the ones inserted first
+        ZipfianGenerator(int n, double skew, bool shuffle_ranks = false)
             : n_(n), gen_(std::random_device{}()) {
             lookup_.resize(n_);
 
@@ -45,6 +51,15 @@ class Benchmark {
                 }
             }
             lookup_[n_ - 1] = n_ - 1;
+
+            if (shuffle_ranks) {
+                std::vector<int> rank_to_ind(n_);
+                std::iota(rank_to_ind.begin(), rank_to_ind.end(), 0);
+                std::shuffle(rank_to_ind.begin(), rank_to_ind.end(), gen_);
+                for (int j = 0; j < n_; j++) {
+                    lookup_[j] = rank_to_ind[lookup_[j]];
+                }
+            }
         }
 
         int next() { return lookup_[gen_() % n_]; }
@@ -73,14 +88,23 @@ class Benchmark {
 
     void obj_fill_vec_prepare(std::vector<uint64_t>& key_vec,
                               std::vector<uint64_t>& value_vec, int ins_cnt);
+    // ptr_vec, if given, receives the tiny pointer of every insert
     void obj_fill(std::vector<uint64_t>& key_vec,
-                  std::vector<uint64_t>& value_vec);
+                  std::vector<uint64_t>& value_vec,
+                  std::vector<uint8_t>* ptr_vec = nullptr);
     void obj_fill_mem_free(int ins_cnt);
 
     void batch_query_vec_prepare(std::vector<uint64_t>& key_vec,
                                  std::vector<uint64_t>& query_key_vec,
-                                 uint64_t op_cnt, double hit_rate);
+                                 uint64_t op_cnt, double hit_rate,
+                                 std::vector<uint8_t>* ptr_vec = nullptr,
+                                 std::vector<uint8_t>* query_ptr_vec = nullptr);
     void batch_query(std::vector<uint64_t>& query_key_vec);
+    // for objects that dereference the tiny pointer, e.g. DEREFTAB64
+    void batch_query(std::vector<uint64_t>& query_key_vec,
+                     std::vector<uint8_t>& query_ptr_vec);
+    // byte array chained tables only
+    void batch_multi_query(std::vector<uint64_t>& query_key_vec);
     void batch_query_no_mem(std::vector<uint64_t>& key_vec, int query_cnt,
                             double hit_rate);
 
@@ -124,6 +148,7 @@ class Benchmark {
     rng::rng128 rgen128;
 
     bool rand_mem_free = false;
+    bool resize_log = false;
 
     std::ofstream output_stream;
     uint64_t table_size;
@@ -132,6 +157,7 @@ class Benchmark {
     double load_factor;
     double hit_ratio;
     double zipfian_skew;
+    bool zipfian_shuffle = false;
 
     BenchmarkObject64* obj;
 
@@ -6,9 +6,11 @@ const BenchmarkObjectType BenchmarkByteArrayChained::TYPE =
     BenchmarkObjectType::BYTEARRAYCHAINEDHT;
 
 BenchmarkByteArrayChained::BenchmarkByteArrayChained(
-    int n, uint8_t quotienting_tail_length, uint16_t bin_size)
+    int n, uint8_t quotienting_tail_length, uint16_t bin_size,
+    bool adaptive_chains)
     : BenchmarkChained(TYPE) {
     tab = new ByteArrayChainedHT(n, quotienting_tail_length, bin_size);
+    tab->SetAdaptiveChains(adaptive_chains);
 }
 
 uint8_t BenchmarkByteArrayChained::Insert(uint64_t key, uint64_t value) {
@@ -28,6 +30,12 @@ bool BenchmarkByteArrayChained::Query(uint64_t key, uint64_t* value_ptr) {
     return tab->Query(key, value_ptr);
 }
 
+uint32_t BenchmarkByteArrayChained::MultiQuery(const uint64_t* keys,
+                                               uint32_t key_num,
+                                               uint64_t* values, bool* found) {
+    return tab->MultiQuery(keys, key_num, values, found);
+}
+
 void BenchmarkByteArrayChained::Update(uint64_t key, uint8_t ptr,
                                        uint64_t value) {
     tab->Update(key, value);
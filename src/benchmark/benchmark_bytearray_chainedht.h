@@ -14,13 +14,15 @@ class BenchmarkByteArrayChained : public BenchmarkChained {
 
    public:
     BenchmarkByteArrayChained(int n, uint8_t quotienting_tail_length,
-                              uint16_t bin_size);
+                              uint16_t bin_size, bool adaptive_chains = false);
 
     ~BenchmarkByteArrayChained() = default;
 
     uint8_t Insert(uint64_t key, uint64_t value);
     uint64_t Query(uint64_t key, uint8_t ptr);
     bool Query(uint64_t key, uint64_t* value_ptr);
+    uint32_t MultiQuery(const uint64_t* keys, uint32_t key_num,
+                        uint64_t* values, bool* found);
     void Update(uint64_t key, uint8_t ptr, uint64_t value);
     void Erase(uint64_t key, uint8_t ptr);
 
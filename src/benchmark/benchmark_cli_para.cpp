@@ -20,7 +20,7 @@ std::string BenchmarkCLIPara::GetOuputFileName() {
 void BenchmarkCLIPara::Parse(int argc, char** argv) {
     this->configuring_getopt();
     for (int c;
-         (c = getopt(argc, argv, "o:c:e:t:p:l:h:f:q:b:my:s:n:z:")) != -1;) {
+         (c = getopt(argc, argv, "o:c:e:t:p:l:h:f:q:b:my:s:n:z:krag")) != -1;) {
         switch (c) {
             // TODO: add validity check of parameters
             case 'o':
@@ -70,6 +70,18 @@ void BenchmarkCLIPara::Parse(int argc, char** argv) {
             case 'z':
                 zipfian_skew = std::stod(optarg);
                 break;
+            case 'k':
+                zipfian_shuffle = true;
+                break;
+            case 'r':
+                resize_log = true;
+                break;
+            case 'a':
+                adaptive_chains = true;
+                break;
+            case 'g':
+                fingerprint_lane = true;
+                break;
             case '?':
                 // if (optopt == 'f')
                 //     fprintf(stderr, "Option -%c requires an argument.\n",
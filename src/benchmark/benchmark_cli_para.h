@@ -33,11 +33,16 @@ class BenchmarkCLIPara {
     double hit_percent;
 
     double zipfian_skew = 0.0;
+    // map zipfian ranks to random keys rather than insertion order
+    bool zipfian_shuffle = false;
 
     int quotienting_tail_length;
     int bin_size;
 
     bool rand_mem_free = false;
+    bool resize_log = false;
+    bool adaptive_chains = false;
+    bool fingerprint_lane = false;
 
     std::string path;
     std::string ycsb_load_path;
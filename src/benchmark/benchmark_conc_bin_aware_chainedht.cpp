@@ -0,0 +1,116 @@
+#include "benchmark_conc_bin_aware_chainedht.h"
+
+namespace tinyptr {
+
+BenchmarkConcBinAwareChainedHT::BenchmarkConcBinAwareChainedHT(
+    uint64_t size, uint16_t bin_size, uint8_t double_slot_num)
+    : BenchmarkObject64(
+          double_slot_num ? BenchmarkObjectType::CONCURRENT_BINAWARECHAINEDHT
+                          : BenchmarkObjectType::CONCURRENT_SAMEBINCHAINEDHT) {
+    tab = new ConcurrentBinAwareChainedHT(size, false, 1.0, nullptr, bin_size,
+                                          double_slot_num);
+}
+
+uint8_t BenchmarkConcBinAwareChainedHT::Insert(uint64_t key, uint64_t value) {
+    return tab->Insert(key, value);
+}
+
+uint64_t BenchmarkConcBinAwareChainedHT::Query(uint64_t key, uint8_t ptr) {
+    uint64_t value;
+    tab->Query(key, &value);
+    return value;
+}
+
+void BenchmarkConcBinAwareChainedHT::Update(uint64_t key, uint8_t ptr,
+                                            uint64_t value) {
+    tab->Update(key, value);
+}
+
+void BenchmarkConcBinAwareChainedHT::Erase(uint64_t key, uint8_t ptr) {
+    tab->Free(key);
+}
+
+void BenchmarkConcBinAwareChainedHT::YCSBFill(std::vector<uint64_t>& keys,
+                                              int num_threads) {
+    std::vector<std::thread> threads;
+    size_t chunk_size = keys.size() / num_threads;
+
+    for (int i = 0; i < num_threads; ++i) {
+        size_t start_index = i * chunk_size;
+        size_t end_index =
+            (i == num_threads - 1) ? keys.size() : start_index + chunk_size;
+
+        threads.emplace_back([this, &keys, start_index, end_index]() {
+            for (size_t j = start_index; j < end_index; ++j) {
+                tab->Insert(keys[j], 0);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void BenchmarkConcBinAwareChainedHT::YCSBRun(
+    std::vector<std::pair<uint64_t, uint64_t>>& ops, int num_threads) {
+    std::vector<std::thread> threads;
+    size_t chunk_size = ops.size() / num_threads;
+
+    for (int i = 0; i < num_threads; ++i) {
+        size_t start_index = i * chunk_size;
+        size_t end_index =
+            (i == num_threads - 1) ? ops.size() : start_index + chunk_size;
+
+        threads.emplace_back([this, &ops, start_index, end_index]() {
+            uint64_t value;
+            for (size_t j = start_index; j < end_index; ++j) {
+                if (ops[j].first == 1) {
+                    tab->Insert(ops[j].second, 0);
+                } else if (ops[j].first == 2) {
+                    tab->Free(ops[j].second);
+                } else {
+                    tab->Query(ops[j].second, &value);
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void BenchmarkConcBinAwareChainedHT::ConcurrentRun(
+    std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>& ops,
+    int num_threads) {
+    std::vector<std::thread> threads;
+    size_t chunk_size = ops.size() / num_threads;
+
+    for (int i = 0; i < num_threads; ++i) {
+        size_t start_index = i * chunk_size;
+        size_t end_index =
+            (i == num_threads - 1) ? ops.size() : start_index + chunk_size;
+
+        threads.emplace_back([this, &ops, start_index, end_index, i]() {
+            uint64_t value;
+            for (size_t j = start_index; j < end_index; ++j) {
+                if (std::get<0>(ops[j]) == ConcOptType::INSERT) {
+                    tab->Insert(std::get<1>(ops[j]), std::get<2>(ops[j]));
+                } else if (std::get<0>(ops[j]) == ConcOptType::QUERY) {
+                    tab->Query(std::get<1>(ops[j]), &value);
+                } else if (std::get<0>(ops[j]) == ConcOptType::UPDATE) {
+                    tab->Update(std::get<1>(ops[j]), std::get<2>(ops[j]));
+                } else if (std::get<0>(ops[j]) == ConcOptType::ERASE) {
+                    tab->Free(std::get<1>(ops[j]));
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace tinyptr
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "benchmark_object_64.h"
+#include "concurrent_bin_aware_chained_ht.h"
+
+namespace tinyptr {
+
+// covers ConcurrentSameBinChainedHT as well, with no double slots
+class BenchmarkConcBinAwareChainedHT : public BenchmarkObject64 {
+   public:
+    BenchmarkConcBinAwareChainedHT(uint64_t size, uint16_t bin_size,
+                                   uint8_t double_slot_num = 126);
+
+    ~BenchmarkConcBinAwareChainedHT() = default;
+
+    uint8_t Insert(uint64_t key, uint64_t value);
+    uint64_t Query(uint64_t key, uint8_t ptr);
+    void Update(uint64_t key, uint8_t ptr, uint64_t value);
+    void Erase(uint64_t key, uint8_t ptr);
+
+    void YCSBFill(std::vector<uint64_t>& keys, int num_threads);
+    void YCSBRun(std::vector<std::pair<uint64_t, uint64_t>>& ops,
+                 int num_threads);
+
+    void ConcurrentRun(
+        std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>& ops,
+        int num_threads);
+
+   private:
+    ConcurrentBinAwareChainedHT* tab;
+};
+
+}  // namespace tinyptr
@@ -9,9 +9,10 @@ const BenchmarkObjectType BenchmarkConcByteArrayChainedHT::TYPE =
     BenchmarkObjectType::CONCURRENT_BYTEARRAYCHAINEDHT;
 
 BenchmarkConcByteArrayChainedHT::BenchmarkConcByteArrayChainedHT(
-    uint64_t size, uint16_t bin_size)
+    uint64_t size, uint16_t bin_size, bool adaptive_chains)
     : BenchmarkObject64(TYPE) {
     tab = new ConcurrentByteArrayChainedHT(size, bin_size);
+    tab->SetAdaptiveChains(adaptive_chains);
 }
 
 uint8_t BenchmarkConcByteArrayChainedHT::Insert(uint64_t key, uint64_t value) {
@@ -11,7 +11,8 @@ class BenchmarkConcByteArrayChainedHT : public BenchmarkObject64 {
     static const BenchmarkObjectType TYPE;
 
    public:
-    BenchmarkConcByteArrayChainedHT(uint64_t size, uint16_t bin_size);
+    BenchmarkConcByteArrayChainedHT(uint64_t size, uint16_t bin_size,
+                                    bool adaptive_chains = false);
 
     ~BenchmarkConcByteArrayChainedHT() = default;
 
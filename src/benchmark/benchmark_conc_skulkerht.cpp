@@ -5,9 +5,10 @@ namespace tinyptr {
 const BenchmarkObjectType BenchmarkConcSkulkerHT::TYPE =
     BenchmarkObjectType::CONCURRENT_SKULKERHT;
 
-BenchmarkConcSkulkerHT::BenchmarkConcSkulkerHT(uint64_t size, uint16_t bin_size)
+BenchmarkConcSkulkerHT::BenchmarkConcSkulkerHT(uint64_t size, uint16_t bin_size,
+                                               bool fingerprint_lane)
     : BenchmarkObject64(TYPE) {
-    tab = new ConcurrentSkulkerHT(size, bin_size);
+    tab = new ConcurrentSkulkerHT(size, bin_size, false, 1.0, fingerprint_lane);
 }
 
 uint8_t BenchmarkConcSkulkerHT::Insert(uint64_t key, uint64_t value) {
@@ -11,7 +11,8 @@ class BenchmarkConcSkulkerHT : public BenchmarkObject64 {
     static const BenchmarkObjectType TYPE;
 
    public:
-    BenchmarkConcSkulkerHT(uint64_t size, uint16_t bin_size);
+    BenchmarkConcSkulkerHT(uint64_t size, uint16_t bin_size,
+                           bool fingerprint_lane = false);
 
     ~BenchmarkConcSkulkerHT() = default;
 
@@ -0,0 +1,170 @@
+#include "benchmark_delegated_blast_ht.h"
+#include <algorithm>
+
+namespace tinyptr {
+
+const BenchmarkObjectType BenchmarkDelegatedBlastHT::TYPE =
+    BenchmarkObjectType::DELEGATED_BLAST;
+
+BenchmarkDelegatedBlastHT::BenchmarkDelegatedBlastHT(
+    uint64_t initial_size_per_part_, uint64_t part_num_, uint32_t thread_num_,
+    double resize_threshold_, double resize_factor_)
+    : BenchmarkObject64(TYPE),
+      owner_num(thread_num_ < 2 ? 0 : (thread_num_ + 1) / 2) {
+    if (!owner_num) {
+        shard = new SingleOwnerBlastHT(initial_size_per_part_, part_num_,
+                                       resize_threshold_, resize_factor_);
+        return;
+    }
+
+    // the partitions are spread over the owners, so the total table size
+    // matches the shared table's
+    uint64_t part_num_per_owner =
+        std::max<uint64_t>(1, (part_num_ + owner_num - 1) / owner_num);
+    // one more handle for the single-threaded calls
+    tab = new DelegatedBlastHT(initial_size_per_part_, owner_num,
+                               thread_num_ - owner_num + 1, part_num_per_owner,
+                               resize_threshold_, resize_factor_, true);
+    single_handle = tab->GetHandle();
+}
+
+BenchmarkDelegatedBlastHT::~BenchmarkDelegatedBlastHT() {
+    if (tab) {
+        tab->FreeHandle(single_handle);
+    }
+    delete tab;
+    delete shard;
+}
+
+int BenchmarkDelegatedBlastHT::client_num(int num_threads) {
+    return std::max<int>(1, num_threads - owner_num);
+}
+
+uint8_t BenchmarkDelegatedBlastHT::Insert(uint64_t key, uint64_t value) {
+    if (shard) {
+        return shard->Insert(key, value);
+    }
+    return tab->Insert(single_handle, key, value);
+}
+
+uint64_t BenchmarkDelegatedBlastHT::Query(uint64_t key, uint8_t ptr) {
+    uint64_t value;
+    if (shard) {
+        shard->Query(key, &value);
+    } else {
+        tab->Query(single_handle, key, &value);
+    }
+    return value;
+}
+
+void BenchmarkDelegatedBlastHT::Update(uint64_t key, uint8_t ptr,
+                                       uint64_t value) {
+    if (shard) {
+        shard->Update(key, value);
+    } else {
+        tab->Update(single_handle, key, value);
+    }
+}
+
+void BenchmarkDelegatedBlastHT::Erase(uint64_t key, uint8_t ptr) {
+    if (shard) {
+        shard->Erase(key);
+    } else {
+        tab->Erase(single_handle, key);
+    }
+}
+
+void BenchmarkDelegatedBlastHT::YCSBFill(std::vector<uint64_t>& keys,
+                                         int num_threads) {
+    if (shard) {
+        for (uint64_t key : keys) {
+            shard->Insert(key, 0);
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    int thread_num = client_num(num_threads);
+    size_t chunk_size = keys.size() / thread_num;
+
+    for (int i = 0; i < thread_num; ++i) {
+        size_t start_index = i * chunk_size;
+        size_t end_index =
+            (i == thread_num - 1) ? keys.size() : start_index + chunk_size;
+
+        threads.emplace_back([this, &keys, start_index, end_index]() {
+            uint64_t handle = tab->GetHandle();
+            DelegatedBlastHT::Request requests[kClientBatchSize];
+            DelegatedBlastHT::Response responses[kClientBatchSize];
+
+            for (size_t j = start_index; j < end_index;
+                 j += kClientBatchSize) {
+                uint32_t batch_size =
+                    std::min<size_t>(kClientBatchSize, end_index - j);
+                for (uint32_t k = 0; k < batch_size; ++k) {
+                    requests[k] = {keys[j + k], 0, DelegatedBlastHT::kInsert};
+                }
+                tab->Execute(handle, requests, batch_size, responses);
+            }
+            tab->FreeHandle(handle);
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void BenchmarkDelegatedBlastHT::YCSBRun(
+    std::vector<std::pair<uint64_t, uint64_t>>& ops, int num_threads) {
+    if (shard) {
+        uint64_t value;
+        for (auto& op : ops) {
+            if (op.first == 1) {
+                shard->Insert(op.second, 0);
+            } else if (op.first == 2) {
+                shard->Erase(op.second);
+            } else {
+                shard->Query(op.second, &value);
+            }
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    int thread_num = client_num(num_threads);
+    size_t chunk_size = ops.size() / thread_num;
+
+    for (int i = 0; i < thread_num; ++i) {
+        size_t start_index = i * chunk_size;
+        size_t end_index =
+            (i == thread_num - 1) ? ops.size() : start_index + chunk_size;
+
+        threads.emplace_back([this, &ops, start_index, end_index]() {
+            uint64_t handle = tab->GetHandle();
+            DelegatedBlastHT::Request requests[kClientBatchSize];
+            DelegatedBlastHT::Response responses[kClientBatchSize];
+
+            for (size_t j = start_index; j < end_index;
+                 j += kClientBatchSize) {
+                uint32_t batch_size =
+                    std::min<size_t>(kClientBatchSize, end_index - j);
+                for (uint32_t k = 0; k < batch_size; ++k) {
+                    uint64_t op = ops[j + k].first;
+                    requests[k] = {ops[j + k].second, 0,
+                                   op == 1   ? DelegatedBlastHT::kInsert
+                                   : op == 2 ? DelegatedBlastHT::kErase
+                                             : DelegatedBlastHT::kQuery};
+                }
+                tab->Execute(handle, requests, batch_size, responses);
+            }
+            tab->FreeHandle(handle);
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace tinyptr
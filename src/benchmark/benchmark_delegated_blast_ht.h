@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "benchmark_object_64.h"
+#include "benchmark_object_type.h"
+#include "delegated_ht.h"
+
+namespace tinyptr {
+
+// the thread budget is split between the owners of the shards and the
+// clients delegating to them: of num_threads, half (rounded up) own shards,
+// each pinned to a core, and the rest drive the workload in batches
+// delegation takes two threads, so a one-thread run drives a single shard
+// directly, with the same partitions
+class BenchmarkDelegatedBlastHT : public BenchmarkObject64 {
+   public:
+    static const BenchmarkObjectType TYPE;
+    static constexpr uint32_t kClientBatchSize = 64;
+
+   public:
+    BenchmarkDelegatedBlastHT(uint64_t initial_size_per_part_,
+                              uint64_t part_num_, uint32_t thread_num_ = 0,
+                              double resize_threshold_ = 0.75,
+                              double resize_factor_ = 2.0);
+
+    ~BenchmarkDelegatedBlastHT();
+
+    uint8_t Insert(uint64_t key, uint64_t value);
+    uint64_t Query(uint64_t key, uint8_t ptr);
+    void Update(uint64_t key, uint8_t ptr, uint64_t value);
+    void Erase(uint64_t key, uint8_t ptr);
+
+    void YCSBFill(std::vector<uint64_t>& keys, int num_threads);
+    void YCSBRun(std::vector<std::pair<uint64_t, uint64_t>>& ops,
+                 int num_threads);
+
+   private:
+    int client_num(int num_threads);
+
+    // with one thread, the shard it drives; tab is then null
+    SingleOwnerBlastHT* shard = nullptr;
+    DelegatedBlastHT* tab = nullptr;
+    uint64_t single_handle;
+    uint32_t owner_num;
+};
+
+}  // namespace tinyptr
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <execution>
 #include <mutex>
+#include <ostream>
 #include <thread>
 #include <tuple>
 #include <vector>
@@ -50,6 +51,9 @@ class BenchmarkObject64 {
         return {};
     }
 
+    // resizable tables write their resize event log here
+    virtual void DumpResizeLog(std::ostream& out) {}
+
    public:
     BenchmarkObjectType type;
 };
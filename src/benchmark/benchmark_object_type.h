@@ -35,7 +35,13 @@ struct BenchmarkObjectType {
         NONCONC_BLAST = 23,
         TBB = 24,
         STAGGER_BYTEARRAYCHAINEDHT = 25,
-        COUNT = 26
+        RESIZABLE_HYBRID = 26,
+        RESIZABLE_YARDEDTPHT = 27,
+        RESIZABLE_BOLTHT = 28,
+        DELEGATED_BLAST = 29,
+        CONCURRENT_BINAWARECHAINEDHT = 30,
+        CONCURRENT_SAMEBINCHAINEDHT = 31,
+        COUNT = 32
     };
 
     BenchmarkObjectType(const BenchmarkObjectType& b) = default;
@@ -24,6 +24,10 @@ BenchmarkResizableBlastHT::~BenchmarkResizableBlastHT() {
     delete tab;
 }
 
+void BenchmarkResizableBlastHT::DumpResizeLog(std::ostream& out) {
+    tab->DumpResizeLog(out);
+}
+
 uint8_t BenchmarkResizableBlastHT::Insert(uint64_t key, uint64_t value) {
     return tab->Insert(single_handle, key, value);
 }
@@ -28,6 +28,10 @@ BenchmarkResizableByteArrayChainedHT::~BenchmarkResizableByteArrayChainedHT() {
     delete tab;
 }
 
+void BenchmarkResizableByteArrayChainedHT::DumpResizeLog(std::ostream& out) {
+    tab->DumpResizeLog(out);
+}
+
 uint8_t BenchmarkResizableByteArrayChainedHT::Insert(uint64_t key,
                                                      uint64_t value) {
     return tab->Insert(single_handle, key, value);
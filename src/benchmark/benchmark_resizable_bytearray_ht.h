@@ -44,6 +44,8 @@ class BenchmarkResizableByteArrayChainedHT : public BenchmarkObject64 {
         std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>& ops, int num_threads, uint64_t record_num,
         const std::vector<double>& percentiles);
 
+    void DumpResizeLog(std::ostream& out);
+
    private:
     ResizableByteArrayChainedHT* tab;
     uint64_t single_handle;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <pthread.h>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include "benchmark_object_64.h"
+#include "benchmark_object_type.h"
+#include "resizable_ht.h"
+
+namespace tinyptr {
+
+// ResizableHT over any of the tables without a benchmark object of their
+// own; every thread takes a handle for the run
+template <typename HTType, int kType>
+class BenchmarkResizableHT : public BenchmarkObject64 {
+   public:
+    static const BenchmarkObjectType TYPE;
+
+   public:
+    BenchmarkResizableHT(uint64_t initial_size_per_part_, uint64_t part_num_,
+                         uint32_t thread_num_ = 0,
+                         double resize_threshold_ = 0.75,
+                         double resize_factor_ = 2.0);
+
+    ~BenchmarkResizableHT();
+
+    uint8_t Insert(uint64_t key, uint64_t value);
+    uint64_t Query(uint64_t key, uint8_t ptr);
+    void Update(uint64_t key, uint8_t ptr, uint64_t value);
+    void Erase(uint64_t key, uint8_t ptr);
+
+    void YCSBFill(std::vector<uint64_t>& keys, int num_threads);
+    void YCSBRun(std::vector<std::pair<uint64_t, uint64_t>>& ops,
+                 int num_threads);
+    std::vector<std::tuple<uint64_t, double, uint64_t>> YCSBRunWithLatencyRecording(
+        std::vector<std::pair<uint64_t, uint64_t>>& ops, int num_threads, uint64_t record_num,
+        const std::vector<double>& percentiles);
+
+    void ConcurrentRun(
+        std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>& ops,
+        int num_threads);
+    std::vector<std::tuple<uint64_t, double, uint64_t>> ConcurrentRunWithLatencyRecording(
+        std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>& ops, int num_threads, uint64_t record_num,
+        const std::vector<double>& percentiles);
+
+    void DumpResizeLog(std::ostream& out);
+
+   private:
+    HTType* tab;
+    uint64_t single_handle;
+    int thread_num;
+};
+
+using BenchmarkResizableHybridHT =
+    BenchmarkResizableHT<ResizableHybridHT,
+                         BenchmarkObjectType::RESIZABLE_HYBRID>;
+using BenchmarkResizableYardedTPHT =
+    BenchmarkResizableHT<ResizableYardedTPHT,
+                         BenchmarkObjectType::RESIZABLE_YARDEDTPHT>;
+using BenchmarkResizableBoltHT =
+    BenchmarkResizableHT<ResizableBoltHT,
+                         BenchmarkObjectType::RESIZABLE_BOLTHT>;
+
+}  // namespace tinyptr
@@ -24,6 +24,10 @@ BenchmarkResizableSkulkerHT::~BenchmarkResizableSkulkerHT() {
     delete tab;
 }
 
+void BenchmarkResizableSkulkerHT::DumpResizeLog(std::ostream& out) {
+    tab->DumpResizeLog(out);
+}
+
 uint8_t BenchmarkResizableSkulkerHT::Insert(uint64_t key, uint64_t value) {
     return tab->Insert(single_handle, key, value);
 }
@@ -37,6 +37,8 @@ class BenchmarkResizableSkulkerHT : public BenchmarkObject64 {
         std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>& ops,
         int num_threads);
 
+    void DumpResizeLog(std::ostream& out);
+
    private:
     ResizableSkulkerHT* tab;
     uint64_t single_handle;
@@ -1,4 +1,5 @@
 #include "blast_ht.h"
+#include "concurrent_byte_array_chained_ht.h"
 #include <immintrin.h>
 #include <sys/mman.h>
 #include <algorithm>
@@ -56,7 +57,8 @@ uint8_t BlastHT::AutoLockNum(uint64_t thread_num_supported) {
 }
 
 BlastHT::BlastHT(uint64_t size, uint8_t quotienting_tail_length,
-                 uint16_t bin_size, bool if_resize, double resize_threshold)
+                 uint16_t bin_size, bool if_resize, double resize_threshold,
+                 utils::PagePool* pool)
     : kHashSeed1(rand() & ((1 << 16) - 1)),
       kHashSeed2(65536 + rand()),
       kCloudQuotientingLength(quotienting_tail_length
@@ -84,7 +86,8 @@ BlastHT::BlastHT(uint64_t size, uint8_t quotienting_tail_length,
                                AutoFastDivisionInnerShift(kBinNum))},
       kFastDivisionReciprocal{
           (1ULL << kFastDivisionShift[0]) / kEntryByteLength + 1 /*not used*/,
-          (1ULL << kFastDivisionShift[1]) / kBinNum + 1} {
+          (1ULL << kFastDivisionShift[1]) / kBinNum + 1},
+      page_pool(pool) {
 
     assert(size / 2 >= (1ULL << (kCloudQuotientingLength)));
     assert(bin_size < 128);
@@ -132,7 +135,9 @@ BlastHT::BlastHT(uint64_t size, uint8_t quotienting_tail_length,
     //           << " bin_cnt_size_aligned: " << bin_cnt_size_aligned
     //           << " total_size: " << total_size << std::endl;
 
-    if (if_resize) {
+    if (page_pool) {
+        combined_mem = page_pool->Acquire(total_size);
+    } else if (if_resize) {
         // combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
         //                     MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
         combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
@@ -161,8 +166,9 @@ BlastHT::BlastHT(uint64_t size, uint8_t quotienting_tail_length,
 BlastHT::BlastHT(uint64_t size, uint16_t bin_size, bool if_resize, double resize_threshold)
     : BlastHT(size, 0, bin_size, if_resize, resize_threshold) {}
 
-BlastHT::BlastHT(uint64_t size, bool if_resize, double resize_threshold)
-    : BlastHT(size, 0, 127, if_resize, resize_threshold) {}
+BlastHT::BlastHT(uint64_t size, bool if_resize, double resize_threshold,
+                 utils::PagePool* pool)
+    : BlastHT(size, 0, 127, if_resize, resize_threshold, pool) {}
 
 BlastHT::~BlastHT() {
     // Calculate individual sizes
@@ -182,7 +188,11 @@ BlastHT::~BlastHT() {
     uint64_t total_size =
         cloud_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
-    munmap(combined_mem, total_size);
+    if (page_pool) {
+        page_pool->Release(combined_mem, total_size);
+    } else {
+        munmap(combined_mem, total_size);
+    }
 
     // std::cerr << "unallocated combined_mem: " << combined_mem << " end at: "
     //           << (void*)((uint64_t)(combined_mem) + total_size) << " with size: "
@@ -212,6 +222,77 @@ bool BlastHT::Insert(uint64_t key, uint64_t value) {
              !concurrent_version.compare_exchange_weak(expected_version,
                                                        expected_version + 1));
 
+    bool res = insert_in_cloud(cloud, cloud_id, fp, truncated_key, value);
+
+    concurrent_version++;
+    return res;
+}
+
+uint32_t BlastHT::BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                             uint32_t entry_num) {
+    uint64_t cloud_ids[kBulkInsertBatchSize];
+    uint8_t fps[kBulkInsertBatchSize];
+    uint32_t failed_num = 0;
+
+    for (uint32_t batch_start = 0; batch_start < entry_num;
+         batch_start += kBulkInsertBatchSize) {
+        std::pair<uint64_t, uint64_t>* batch = entries + batch_start;
+        uint32_t batch_size =
+            std::min<uint32_t>(kBulkInsertBatchSize, entry_num - batch_start);
+
+        // hash the whole batch up front so the cloud fetches overlap
+        for (uint32_t i = 0; i < batch_size; i++) {
+            uint64_t key = batch[i].first;
+            uint64_t truncated_key = key >> kBlastQuotientingLength;
+            uint64_t cloud_id =
+                ((HASH_FUNCTION(&truncated_key, sizeof(uint64_t),
+                                kHashSeed1) ^
+                  key) &
+                 kBlastQuotientingMask);
+            uint8_t fp = cloud_id >> kCloudQuotientingLength;
+            cloud_id = cloud_id & kQuotientingTailMask;
+
+            _mm_prefetch(&cloud_tab[(cloud_id << kCloudIdShiftOffset)],
+                         _MM_HINT_T0);
+            cloud_ids[i] = cloud_id;
+            fps[i] = fp;
+        }
+
+        for (uint32_t i = 0; i < batch_size;) {
+            uint64_t cloud_id = cloud_ids[i];
+            uint8_t* cloud = &cloud_tab[(cloud_id << kCloudIdShiftOffset)];
+
+            std::atomic<uint8_t>& concurrent_version =
+                *reinterpret_cast<std::atomic<uint8_t>*>(
+                    &cloud[kConcurrentVersionOffset]);
+
+            uint8_t expected_version;
+            do {
+                expected_version = concurrent_version.load();
+            } while ((expected_version & 1) ||
+                     !concurrent_version.compare_exchange_weak(
+                         expected_version, expected_version + 1));
+
+            // consecutive entries of the same cloud share one lock round
+            do {
+                if (!insert_in_cloud(cloud, cloud_id, fps[i],
+                                     batch[i].first >> kBlastQuotientingLength,
+                                     batch[i].second)) {
+                    entries[failed_num++] = batch[i];
+                }
+                i++;
+            } while (i < batch_size && cloud_ids[i] == cloud_id);
+
+            concurrent_version++;
+        }
+    }
+
+    return failed_num;
+}
+
+bool BlastHT::insert_in_cloud(uint8_t* cloud, uint64_t cloud_id, uint8_t fp,
+                              uint64_t truncated_key, uint64_t value) {
+
     uint8_t& control_info = cloud[kControlOffset];
     uint8_t crystal_cnt = control_info & kControlCrystalMask;
     uint8_t tp_cnt = (control_info >> kControlTinyPtrShift);
@@ -231,7 +312,6 @@ bool BlastHT::Insert(uint64_t key, uint64_t value) {
             value;
 
         control_info++;
-        concurrent_version++;
         return true;
     } else if (crystal_end >= fp_cnt + tp_cnt + 2) {
 
@@ -242,12 +322,10 @@ bool BlastHT::Insert(uint64_t key, uint64_t value) {
                                   truncated_key, value);
 
         control_info += (result << kControlTinyPtrShift);
-        concurrent_version++;
         return result;
     } else {
 
         if (__builtin_expect(crystal_cnt == 0, 0)) {
-            concurrent_version++;
             return false;
         }
 
@@ -276,7 +354,6 @@ bool BlastHT::Insert(uint64_t key, uint64_t value) {
                 control_info--;
                 uint8_t inc_cnt = 2;
                 control_info += (inc_cnt << kControlTinyPtrShift);
-                concurrent_version++;
                 return true;
             } else {
                 memmove(cloud + crystal_end - kEntryByteLength - tp_cnt,
@@ -291,7 +368,6 @@ bool BlastHT::Insert(uint64_t key, uint64_t value) {
                     last_crystal_trunced_key;
                 reinterpret_cast<uint64_t*>(
                     cloud + crystal_end + kValueOffset)[0] = last_crystal_value;
-                concurrent_version++;
                 return false;
             }
 
@@ -305,7 +381,6 @@ bool BlastHT::Insert(uint64_t key, uint64_t value) {
                 last_crystal_trunced_key;
             reinterpret_cast<uint64_t*>(cloud + crystal_end + kValueOffset)[0] =
                 last_crystal_value;
-            concurrent_version++;
 
             return false;
         }
@@ -657,7 +732,10 @@ void BlastHT::SetResizeStride(uint64_t stride_num) {
     resize_stride_size = ceil(1.0 * kCloudNum / (stride_num));
 }
 
-bool BlastHT::ResizeMoveStride(uint64_t stride_id, BlastHT* new_ht) {
+template <typename TargetHT>
+bool BlastHT::ResizeMoveStride(uint64_t stride_id, TargetHT* new_ht,
+                               TargetHT* split_ht, PartitionRouter router,
+                               uint64_t split_bit) {
 
     uint64_t stride_id_start = stride_id * resize_stride_size;
     uint64_t stride_id_end = stride_id_start + resize_stride_size;
@@ -665,65 +743,50 @@ bool BlastHT::ResizeMoveStride(uint64_t stride_id, BlastHT* new_ht) {
         stride_id_end = kCloudNum;
     }
 
-    // Resize queue configuration - must be power of 2 for fast bitwise operations
-    static constexpr uint8_t kResizeQueueSize = 128;
-    static constexpr uint8_t kResizeQueueMask = kResizeQueueSize - 1;
-
-    // Simple queue implementation for resize operations
-    struct ResizeQueue {
-        std::pair<uint64_t, uint64_t> data[kResizeQueueSize];
-        uint8_t front = 0;
-        uint8_t back = 0;
-        uint8_t size = 0;
-
-        inline void push(const std::pair<uint64_t, uint64_t>& item) {
-            data[back] = item;
-            back = (back + 1) & kResizeQueueMask;
-            size++;
-        }
+    // entries are collected per destination and handed over a batch at a
+    // time, so the destination can overlap their lookups
+    struct ResizeBatch {
+        std::pair<uint64_t, uint64_t> data[kBulkInsertBatchSize];
+        uint32_t size = 0;
+    };
 
-        inline std::pair<uint64_t, uint64_t> pop() {
-            auto item = data[front];
-            front = (front + 1) & kResizeQueueMask;
-            size--;
-            return item;
+    ResizeBatch batches[2];
+    TargetHT* targets[2] = {new_ht, split_ht};
+    bool res = true;
+
+    // a splitting resize sends the entries routed to the new partition to
+    // split_ht
+    auto move_entry = [&](uint64_t key, uint64_t value) {
+        uint8_t target = split_ht && (router.Route(key) & split_bit);
+        ResizeBatch& batch = batches[target];
+        batch.data[batch.size++] = std::make_pair(key, value);
+        if (batch.size == kBulkInsertBatchSize) {
+            res &= targets[target]->BulkInsert(batch.data, batch.size) == 0;
+            batch.size = 0;
         }
-
-        inline bool empty() const { return size == 0; }
-
-        inline uint8_t get_size() const { return size; }
     };
 
-    ResizeQueue ins_queue;
-
     for (uint64_t cloud_id = stride_id_start; cloud_id < stride_id_end;
          cloud_id++) {
         uint8_t* cloud = &cloud_tab[cloud_id << kCloudIdShiftOffset];
         uint8_t& control_info = cloud[kControlOffset];
         uint8_t crystal_cnt = control_info & kControlCrystalMask;
         uint8_t tp_cnt = (control_info >> kControlTinyPtrShift);
-        uint8_t fp_cnt = crystal_cnt + tp_cnt;
 
         uint8_t crystal_end = kControlOffset - kEntryByteLength * crystal_cnt;
 
-        for (uint8_t crystal_iter = 0, moved_cnt = 0;
-             crystal_iter < crystal_cnt; crystal_iter++) {
+        for (uint8_t crystal_iter = 0; crystal_iter < crystal_cnt;
+             crystal_iter++) {
 
             uint8_t fp = cloud[kFingerprintOffset + crystal_iter];
 
             uint8_t* entry = cloud + kControlOffset -
                              crystal_iter * kEntryByteLength - kEntryByteLength;
 
-            uint64_t ins_key = hash_key_rebuild(
-                (*reinterpret_cast<uint64_t*>(entry + kKeyOffset)), cloud_id,
-                fp);
-
-            new_ht->prefetch_key(ins_key);
-
-            ins_queue.push(std::make_pair(
-                ins_key, *reinterpret_cast<uint64_t*>(entry + kValueOffset)));
-
-            new_ht->prefetch_key(ins_key);
+            move_entry(hash_key_rebuild(
+                           (*reinterpret_cast<uint64_t*>(entry + kKeyOffset)),
+                           cloud_id, fp),
+                       *reinterpret_cast<uint64_t*>(entry + kValueOffset));
         }
 
         for (uint8_t tp_iter = 0; tp_iter < tp_cnt; tp_iter++) {
@@ -735,51 +798,30 @@ bool BlastHT::ResizeMoveStride(uint64_t stride_id, BlastHT* new_ht) {
 
             uint8_t* entry = ptab_query_entry_address(deref_key, *tiny_ptr);
 
-            uint64_t ins_key = hash_key_rebuild(
-                (*reinterpret_cast<uint64_t*>(entry + kKeyOffset)), cloud_id,
-                fp);
-
-            new_ht->prefetch_key(ins_key);
-
-            ins_queue.push(std::make_pair(
-                ins_key, *reinterpret_cast<uint64_t*>(entry + kValueOffset)));
-            new_ht->prefetch_key(ins_key);
-        }
-
-        if (ins_queue.get_size() >= 10) {
-            while (!ins_queue.empty()) {
-                auto ins_pair = ins_queue.pop();
-                if (!new_ht->Insert(ins_pair.first, ins_pair.second)) {
-                    return false;
-                }
-            }
+            move_entry(hash_key_rebuild(
+                           (*reinterpret_cast<uint64_t*>(entry + kKeyOffset)),
+                           cloud_id, fp),
+                       *reinterpret_cast<uint64_t*>(entry + kValueOffset));
         }
     }
 
-    while (!ins_queue.empty()) {
-        auto ins_pair = ins_queue.pop();
-        if (!new_ht->Insert(ins_pair.first, ins_pair.second)) {
-            return false;
+    for (uint8_t target = 0; target < 2; target++) {
+        if (batches[target].size) {
+            res &= targets[target]->BulkInsert(batches[target].data,
+                                               batches[target].size) == 0;
         }
     }
 
-    // // asfasdfasdfasfasdfa
-    //     auto end_time = std::chrono::high_resolution_clock::now();
-
-    //     static auto resize_time =
-    //         std::chrono::duration_cast<std::chrono::milliseconds>(end_time -
-    //                                                               end_time)
-    //             .count();
-
-    //     resize_time += std::chrono::duration_cast<std::chrono::milliseconds>(
-    //                        end_time - start_time)
-    //                        .count();
-
-    //     std::cerr << "Resize time: " << resize_time << "ms" << std::endl;
-
-    return true;
+    return res;
 }
 
+template bool BlastHT::ResizeMoveStride(uint64_t, BlastHT*, BlastHT*,
+                                        PartitionRouter, uint64_t);
+template bool BlastHT::ResizeMoveStride(uint64_t,
+                                        ConcurrentByteArrayChainedHT*,
+                                        ConcurrentByteArrayChainedHT*,
+                                        PartitionRouter, uint64_t);
+
 void BlastHT::Scan4Stats() {
     uint64_t total_slots = kCloudNum * kCloudByteLength;
     uint64_t used_slots = 0;
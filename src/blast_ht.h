@@ -18,6 +18,7 @@
 #include <utility>
 #include <vector>
 #include "common.h"
+#include "utils/page_pool.h"
 #include "utils/cache_line_size.h"
 
 namespace tinyptr {
@@ -99,26 +100,41 @@ class BlastHT {
     uint8_t AutoFastDivisionInnerShift(uint64_t divisor);
 
    public:
+    // with a pool, the table memory is taken from and returned to it
     BlastHT(uint64_t size, uint8_t quotienting_tail_length, uint16_t bin_size,
-            bool if_resize, double resize_threshold = 1.0);
+            bool if_resize, double resize_threshold = 1.0,
+            utils::PagePool* pool = nullptr);
     BlastHT(uint64_t size, uint16_t bin_size, bool if_resize, double resize_threshold = 1.0);
-    BlastHT(uint64_t size, bool if_resize, double resize_threshold = 1.0);
+    BlastHT(uint64_t size, bool if_resize, double resize_threshold = 1.0,
+            utils::PagePool* pool = nullptr);
 
     ~BlastHT();
 
     bool Insert(uint64_t key, uint64_t value);
+    // hashes and prefetches a whole batch before inserting it; used by resize
+    // migration and buffered inserts, which have a batch of entries at hand
+    // returns how many entries did not fit; those are moved to the front of
+    // entries, in order
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
     bool Query(uint64_t key, uint64_t* value_ptr);
     bool Update(uint64_t key, uint64_t value);
     void Free(uint64_t key);
 
     void SetResizeStride(uint64_t stride_num);
-    bool ResizeMoveStride(uint64_t stride_id, BlastHT* new_ht);
+    // the destination may be a BlastHT or a ConcurrentByteArrayChainedHT, so
+    // a resize can change a partition's representation
+    template <typename TargetHT>
+    bool ResizeMoveStride(uint64_t stride_id, TargetHT* new_ht,
+                          TargetHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
 
     void Scan4Stats();
 
     uint64_t GetTableSize() const { return kCloudNum * 4 - 1; }
 
    protected:
+    utils::PagePool* page_pool;
     void* combined_mem;
     uint8_t* cloud_tab;
     uint8_t* byte_array;
@@ -130,7 +146,13 @@ class BlastHT {
 
     uint64_t resize_stride_size;
 
+    static constexpr uint32_t kBulkInsertBatchSize = 64;
+
    protected:
+    // the insert itself; the caller holds the cloud's version lock
+    bool insert_in_cloud(uint8_t* cloud, uint64_t cloud_id, uint8_t fp,
+                         uint64_t truncated_key, uint64_t value);
+
     __attribute__((always_inline)) inline uint64_t hash_1(uint64_t key) {
         return HASH_FUNCTION(&key, sizeof(uint64_t), kHashSeed1);
     }
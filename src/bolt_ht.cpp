@@ -13,9 +13,6 @@
 
 namespace tinyptr {
 
-uint8_t BoltHT::kCloudLookup[256];
-struct BoltHTCloudLookupInitializer bolt_ht_cloud_lookup_initializer;
-
 // #define USE_CONCURRENT_VERSION_QUERY
 
 uint8_t BoltHT::AutoFastDivisionInnerShift(uint64_t divisor) {
@@ -58,7 +55,8 @@ uint8_t BoltHT::AutoLockNum(uint64_t thread_num_supported) {
 }
 
 BoltHT::BoltHT(uint64_t size, uint8_t quotienting_tail_length,
-               uint16_t bin_size)
+               uint16_t bin_size, bool if_resize, double resize_threshold,
+               utils::PagePool* pool)
     : kHashSeed1(rand() & ((1 << 16) - 1)),
       kHashSeed2(65536 + rand()),
       kQuotientingTailLength(quotienting_tail_length
@@ -72,7 +70,11 @@ BoltHT::BoltHT(uint64_t size, uint8_t quotienting_tail_length,
       kBinByteLength(kBinSize * kDropletByteLength),
       kCloudNum(1ULL << kQuotientingTailLength),
       kBinSize(bin_size),
-      kBinNum((size * kCloudOverflowBound + kBinSize - 1) / kBinSize),
+      kBinNum(if_resize ? static_cast<uint64_t>(std::ceil(
+                              (size * kCloudOverflowBound + kBinSize - 1) /
+                              kBinSize * resize_threshold))
+                        : (size * kCloudOverflowBound + kBinSize - 1) /
+                              kBinSize),
       kValueOffset(kKeyOffset + kQuotKeyByteLength),
       kDropletValueOffset(kValueOffset - 1),
       kFastDivisionShift{
@@ -83,9 +85,10 @@ BoltHT::BoltHT(uint64_t size, uint8_t quotienting_tail_length,
                                AutoFastDivisionInnerShift(kBinNum))},
       kFastDivisionReciprocal{
           (1ULL << kFastDivisionShift[0]) / kDropletByteLength + 1 /*not used*/,
-          (1ULL << kFastDivisionShift[1]) / kBinNum + 1} {
+          (1ULL << kFastDivisionShift[1]) / kBinNum + 1},
+      page_pool(pool) {
 
-    assert(size / 2 > (1ULL << (kQuotientingTailLength)));
+    assert(size / 2 >= (1ULL << (kQuotientingTailLength)));
     assert(bin_size < 128);
 
     // Determine the number of threads
@@ -121,13 +124,17 @@ BoltHT::BoltHT(uint64_t size, uint8_t quotienting_tail_length,
         cloud_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
     // Allocate a single aligned block
-    void* combined_mem;
     // if (posix_memalign(&combined_mem, 64, total_size) != 0) {
     //     // Handle allocation failure
     //     abort();
     // }
-    combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
-                        MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    combined_mem_size = total_size;
+    if (page_pool) {
+        combined_mem = page_pool->Acquire(total_size);
+    } else {
+        combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+                            MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    }
 
     // Assign pointers to their respective regions
     uint8_t* base =
@@ -143,12 +150,18 @@ BoltHT::BoltHT(uint64_t size, uint8_t quotienting_tail_length,
 
 BoltHT::BoltHT(uint64_t size, uint16_t bin_size) : BoltHT(size, 0, bin_size) {}
 
-BoltHT::BoltHT(uint64_t size) : BoltHT(size, 0, 127) {}
+BoltHT::BoltHT(uint64_t size) : BoltHT(size, 0, uint16_t(127)) {}
+
+BoltHT::BoltHT(uint64_t size, bool if_resize, double resize_threshold,
+               utils::PagePool* pool)
+    : BoltHT(size, 0, uint16_t(127), if_resize, resize_threshold, pool) {}
 
 BoltHT::~BoltHT() {
-    munmap(cloud_tab, kCloudNum * kCloudByteLength);
-    munmap(byte_array, kBinNum * kBinSize * kDropletByteLength);
-    munmap(bin_cnt_head, kBinNum << 1);
+    if (page_pool) {
+        page_pool->Release(combined_mem, combined_mem_size);
+    } else {
+        munmap(combined_mem, combined_mem_size);
+    }
 }
 
 bool BoltHT::Insert(uint64_t key, uint64_t value) {
@@ -199,6 +212,10 @@ bool BoltHT::Insert(uint64_t key, uint64_t value) {
         control_info += (result << kControlBoltShift);
         concurrent_version++;
         return result;
+    } else if (crystal_cnt == 0) {
+        // all bolts already
+        concurrent_version++;
+        return false;
     } else {
 
         crystal_end -= kCrystalByteLength;
@@ -233,6 +250,13 @@ bool BoltHT::Insert(uint64_t key, uint64_t value) {
                 concurrent_version++;
                 return true;
             } else {
+                uint8_t* first_tiny_ptr = tiny_ptr + kBoltByteLength;
+                ptab_release(
+                    ptab_query_entry_address(
+                        (cloud_id << kByteShift) |
+                            (last_crystal_trunced_key & kByteMask),
+                        *first_tiny_ptr),
+                    *first_tiny_ptr);
                 reinterpret_cast<uint64_t*>(
                     cloud + crystal_end + kValueOffset)[0] = last_crystal_value;
                 concurrent_version++;
@@ -339,18 +363,13 @@ bool BoltHT::Query(uint64_t key, uint64_t* value_ptr) {
     const uint32_t BBL = kBoltByteLength;     //  1 … 16
     const uint32_t KL = kQuotKeyByteLength;   //  1 …  8
 
-    static thread_local struct {
-        __m256i cry_off;       // {0, CBL, 2·CBL, 3·CBL}
-        __m256i cry_mask_vec;  // mask real key bytes
-        uint64_t cry_mask;
-        __m128i rev_idx16;  // {7,6,5,4,3,2,1,0}
-    } C = [&] {
-        uint64_t offs[4] = {0, CBL, 2ULL * CBL, 3ULL * CBL};
-        const uint64_t km = (KL == 8) ? ~0ULL : ((1ULL << (KL * 8)) - 1ULL);
-        return decltype(C){
-            _mm256_load_si256(reinterpret_cast<const __m256i*>(offs)),
-            _mm256_set1_epi64x(km), km, _mm_set_epi16(0, 1, 2, 3, 4, 5, 6, 7)};
-    }();
+    // per table, not per thread: the tables of a ResizableHT differ in key
+    // length
+    const __m256i cry_off =
+        _mm256_setr_epi64x(0, CBL, 2ULL * CBL, 3ULL * CBL);
+    const uint64_t cry_mask =
+        (KL == 8) ? ~0ULL : ((1ULL << (KL * 8)) - 1ULL);  // real key bytes
+    const __m256i cry_mask_vec = _mm256_set1_epi64x(cry_mask);
 
     // 4ns above
 
@@ -358,11 +377,7 @@ bool BoltHT::Query(uint64_t key, uint64_t* value_ptr) {
     //    ❷  Pre-compute query-key parts
     // ────────────────────────────────────────────
     const uint64_t truncated = key >> kQuotientingTailLength;
-    const __m256i key_vec = _mm256_set1_epi64x(truncated & C.cry_mask);
-
-    const uint8_t query_fp = static_cast<uint8_t>(truncated & kByteMask);
-    const uint64_t bolt_masked_key = (truncated >> kByteShift)
-                                     << kBoltQuotientingLength;
+    const __m256i key_vec = _mm256_set1_epi64x(truncated & cry_mask);
 
     uint64_t cloud_id = hash_cloud_id(key);
 
@@ -401,8 +416,7 @@ retry:
         //     1);
 
         __m256i g = _mm256_i64gather_epi64(
-            reinterpret_cast<const long long*>(base + kKeyOffset), C.cry_off,
-            1);
+            reinterpret_cast<const long long*>(base + kKeyOffset), cry_off, 1);
         // __m256i g = _mm256_load_si256(
         //     reinterpret_cast<const __m256i*>(base + kKeyOffset));
 
@@ -411,14 +425,19 @@ retry:
         // auto cry_mask_vec =
         //     _mm256_set1_epi64x((KL == 8) ? ~0ULL : ((1ULL << (KL * 8)) - 1ULL));
         // g = _mm256_and_si256(g, cry_mask_vec);
-        g = _mm256_and_si256(g, C.cry_mask_vec);
+        g = _mm256_and_si256(g, cry_mask_vec);
 
         // 0-1ns
 
         // *value_ptr = _mm256_extract_epi64(g, 0);
         // return false;
 
+#if defined(__AVX512VL__)
         uint32_t bm = _mm256_cmpeq_epi64_mask(g, key_vec);
+#else
+        uint32_t bm = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(g, key_vec)));
+#endif
 
         // 5ns
 
@@ -453,125 +472,234 @@ retry:
     // return false;
 
     //  ───────────────────────── Bolt probe (2-byte bolts) ───────────────
-    // 44ns for positive
-    // 19ns for negative
-    // if (1) {
-    // 48ns for positive
-    // 23ns for negative
+    // one 32-byte load per 16 bolts, see bolt_window_match
     if (bolt_cnt) {
-        uint8_t* fp_hi =
-            cloud + kBoltOffset - kBoltByteLength + kFingerprintOffset;
-
-        uint32_t remaining = bolt_cnt;  // bolts left to scan
-        uint32_t base_idx = 0;          // index of fp_hi
+        uint8_t* entry;
+        if (find_bolt(cloud, cloud_id, bolt_cnt, truncated, &entry) >= 0) {
+            *value_ptr =
+                *reinterpret_cast<uint64_t*>(entry + kDropletValueOffset);
 
-        const __m128i even_mask16 = _mm_set1_epi16(0x00FF);
-        const uint16_t query_fp16 = static_cast<uint16_t>(query_fp);
-        const __m128i qfp16_vec = _mm_set1_epi16(query_fp16);
+            if ((ver->load() != v0))
+                goto retry;
+            return true;
+        }
+    }
 
-        // 0-2ns
+    //  ───────────────────────────────────────── Miss / version check ─────────
+    if ((ver->load() != v0))
+        goto retry;
+    return false;
+}
 
-        do {
-            const uint32_t batch = remaining >= 8 ? 8 : remaining;
 
-            uint8_t* fp_lo = fp_hi - 7 * kBoltByteLength;
 
-            __m128i bytes =
-                _mm_loadu_si128(reinterpret_cast<const __m128i*>(fp_lo));
+uint32_t BoltHT::BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                            uint32_t entry_num) {
+    uint32_t failed_num = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        if (!Insert(entries[i].first, entries[i].second)) {
+            entries[failed_num++] = entries[i];
+        }
+    }
+    return failed_num;
+}
 
-            __m128i fp16 = _mm_and_si128(bytes, even_mask16);
+bool BoltHT::Update(uint64_t key, uint64_t value) {
+    uint64_t cloud_id = hash_cloud_id(key);
+    uint8_t* cloud = &cloud_tab[(cloud_id << kCloudIdShiftOffset)];
 
-            // 0ns
+    std::atomic<uint8_t>& concurrent_version =
+        *reinterpret_cast<std::atomic<uint8_t>*>(
+            &cloud[kConcurrentVersionOffset]);
 
-            __m128i lala = _mm_set_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while ((expected_version & 1) ||
+             !concurrent_version.compare_exchange_weak(expected_version,
+                                                       expected_version + 1));
 
-            __m128i tmp = _mm_add_epi16(_mm_set1_epi16(base_idx), lala);
-            // __m128i tmp = _mm_add_epi16(_mm_set1_epi16(base_idx), C.rev_idx16);
+    uint8_t control_info = cloud[kControlOffset];
+    uint8_t crystal_cnt = control_info & kControlCrystalMask;
+    uint8_t bolt_cnt = (control_info >> kControlBoltShift);
+    uint64_t truncated_key = key >> kQuotientingTailLength;
 
-            // 9-10ns
+    int crystal_id = find_crystal(cloud, crystal_cnt, truncated_key);
+    if (crystal_id >= 0) {
+        reinterpret_cast<uint64_t*>(cloud + kCrystalOffset +
+                                    crystal_id * kCrystalByteLength +
+                                    kValueOffset)[0] = value;
+        concurrent_version++;
+        return true;
+    }
 
-            __m128i cand = _mm_xor_si128(fp16, tmp);
-            // 0ns
+    uint8_t* entry;
+    if (find_bolt(cloud, cloud_id, bolt_cnt, truncated_key, &entry) >= 0) {
+        *reinterpret_cast<uint64_t*>(entry + kDropletValueOffset) = value;
+        concurrent_version++;
+        return true;
+    }
 
-            uint32_t mask = _mm_cmpeq_epi16_mask(cand, qfp16_vec);
+    concurrent_version++;
+    return false;
+}
 
-            mask &= ~((1u << (8 - batch)) - 1u);
+void BoltHT::Free(uint64_t key) {
+    uint64_t cloud_id = hash_cloud_id(key);
+    uint8_t* cloud = &cloud_tab[(cloud_id << kCloudIdShiftOffset)];
 
-            // 0-1ns
+    std::atomic<uint8_t>& concurrent_version =
+        *reinterpret_cast<std::atomic<uint8_t>*>(
+            &cloud[kConcurrentVersionOffset]);
 
-            while (mask) {
-                // passing this while
-                // 7ns for positive
-                // 5ns for negative
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while ((expected_version & 1) ||
+             !concurrent_version.compare_exchange_weak(expected_version,
+                                                       expected_version + 1));
 
-                int idx = 7 - _tzcnt_u32(mask);
-                mask &= mask - 1u;
+    uint8_t& control_info = cloud[kControlOffset];
+    uint8_t crystal_cnt = control_info & kControlCrystalMask;
+    uint8_t bolt_cnt = (control_info >> kControlBoltShift);
+    uint64_t truncated_key = key >> kQuotientingTailLength;
 
-                // 0-1ns
+    int crystal_id = find_crystal(cloud, crystal_cnt, truncated_key);
+    if (crystal_id >= 0) {
+        uint8_t last_crystal_id = crystal_cnt - 1;
+        if (crystal_id != last_crystal_id) {
+            memcpy(cloud + kCrystalOffset + crystal_id * kCrystalByteLength,
+                   cloud + kCrystalOffset +
+                       last_crystal_id * kCrystalByteLength,
+                   kCrystalByteLength);
+        }
+        control_info--;
+    } else {
+        uint8_t* entry;
+        int bolt_id =
+            find_bolt(cloud, cloud_id, bolt_cnt, truncated_key, &entry);
+        if (bolt_id < 0) {
+            concurrent_version++;
+            return;
+        }
 
-                uint8_t* bolt_ptr =
-                    fp_hi -
-                    (static_cast<uint64_t>(idx) << kBoltByteLengthShift) -
-                    kFingerprintOffset;
-                uint8_t* tiny_ptr = bolt_ptr + kTinyPtrOffset;
+        uint8_t* bolt_ptr = bolt_at(cloud, bolt_id);
+        ptab_release(entry, bolt_ptr[kTinyPtrOffset]);
+
+        // the last bolt takes the place; its fingerprint is xor-ed with its
+        // index, so it is re-encoded for the new one
+        uint8_t last_bolt_id = bolt_cnt - 1;
+        if (bolt_id != last_bolt_id) {
+            uint8_t* last_bolt_ptr = bolt_at(cloud, last_bolt_id);
+            bolt_ptr[kTinyPtrOffset] = last_bolt_ptr[kTinyPtrOffset];
+            bolt_ptr[kFingerprintOffset] = last_bolt_ptr[kFingerprintOffset] ^
+                                           last_bolt_id ^ bolt_id;
+        }
+        control_info -= (1 << kControlBoltShift);
+    }
 
-                uint64_t deref_key = (cloud_id << kByteShift) | query_fp;
+    cloud_lift_bolts(cloud, cloud_id);
+    concurrent_version++;
+}
 
-                // 1ns
+void BoltHT::cloud_lift_bolts(uint8_t* cloud, uint64_t cloud_id) {
+    uint8_t& control_info = cloud[kControlOffset];
 
-                uint8_t* entry = ptab_query_entry_address(deref_key, *tiny_ptr);
+    while (true) {
+        uint8_t crystal_cnt = control_info & kControlCrystalMask;
+        uint8_t bolt_cnt = (control_info >> kControlBoltShift);
+        uint8_t crystal_end =
+            kCrystalOffset + (crystal_cnt * kCrystalByteLength);
+        uint8_t bolt_end = kBoltOffset - (bolt_cnt << kBoltByteLengthShift);
+
+        // the crystal may cover the bolt it replaces
+        if (bolt_cnt == 0 ||
+            crystal_end + kCrystalByteLength > bolt_end + kBoltByteLength) {
+            return;
+        }
 
-                // 1 ns
+        uint8_t last_bolt_id = bolt_cnt - 1;
+        uint8_t* tiny_ptr = bolt_at(cloud, last_bolt_id) + kTinyPtrOffset;
+        uint8_t* entry = bolt_droplet(cloud, cloud_id, last_bolt_id);
+        uint64_t truncated_key = bolt_truncated_key(cloud, last_bolt_id, entry);
+        uint64_t value =
+            *reinterpret_cast<uint64_t*>(entry + kDropletValueOffset);
+        ptab_release(entry, *tiny_ptr);
 
-                uint64_t entry_mk =
-                    (*reinterpret_cast<uint64_t*>(entry + kDropletKeyOffset))
-                    << kBoltQuotientingLength;
+        reinterpret_cast<uint64_t*>(cloud + crystal_end + kKeyOffset)[0] =
+            truncated_key;
+        reinterpret_cast<uint64_t*>(cloud + crystal_end + kValueOffset)[0] =
+            value;
+        control_info = (control_info + 1) - (1 << kControlBoltShift);
+    }
+}
 
-                // 13ns for positive, makes sense, since around 20% items are bolts
-                // 1ns for negative, it accesses some random place in the derefrence table, low lantency comes from the lower possibility of the getting into this branch
+void BoltHT::SetResizeStride(uint64_t stride_num) {
+    resize_stride_size = ceil(1.0 * kCloudNum / (stride_num));
+}
 
-                if (entry_mk == bolt_masked_key) {
-                    // adding the branch only
-                    // 9ns for positive
-                    // 3ns for negative
+bool BoltHT::ResizeMoveStride(uint64_t stride_id, BoltHT* new_ht,
+                              BoltHT* split_ht, PartitionRouter router,
+                              uint64_t split_bit) {
 
-                    *value_ptr = *reinterpret_cast<uint64_t*>(
-                        entry + kDropletValueOffset);
+    uint64_t stride_id_start = stride_id * resize_stride_size;
+    uint64_t stride_id_end = stride_id_start + resize_stride_size;
+    if (stride_id_end > kCloudNum) {
+        stride_id_end = kCloudNum;
+    }
 
-                    // 1-2ns
+    std::pair<uint64_t, uint64_t> batches[2][kBulkInsertBatchSize];
+    uint32_t batch_sizes[2] = {0, 0};
+    BoltHT* targets[2] = {new_ht, split_ht};
+    bool res = true;
+
+    // a splitting resize sends the entries routed to the new partition to
+    // split_ht
+    auto move_entry = [&](uint64_t key, uint64_t value) {
+        uint8_t target = split_ht && (router.Route(key) & split_bit);
+        batches[target][batch_sizes[target]++] = std::make_pair(key, value);
+        if (batch_sizes[target] == kBulkInsertBatchSize) {
+            res &= targets[target]->BulkInsert(batches[target],
+                                               batch_sizes[target]) == 0;
+            batch_sizes[target] = 0;
+        }
+    };
 
-                    if ((ver->load() != v0))
-                        goto retry;
-                    // 0ns
+    for (uint64_t cloud_id = stride_id_start; cloud_id < stride_id_end;
+         cloud_id++) {
+        uint8_t* cloud = &cloud_tab[cloud_id << kCloudIdShiftOffset];
+        uint8_t control_info = cloud[kControlOffset];
+        uint8_t crystal_cnt = control_info & kControlCrystalMask;
+        uint8_t bolt_cnt = (control_info >> kControlBoltShift);
 
-                    return true;
-                }
-            }
+        for (uint8_t i = 0; i < crystal_cnt; i++) {
+            uint8_t* crystal_ptr =
+                cloud + kCrystalOffset + i * kCrystalByteLength;
+            move_entry(
+                hash_key_rebuild(
+                    *reinterpret_cast<uint64_t*>(crystal_ptr + kKeyOffset),
+                    cloud_id),
+                *reinterpret_cast<uint64_t*>(crystal_ptr + kValueOffset));
+        }
 
-            fp_hi -= kBoltByteLength * 8;
-            base_idx += batch;
-            remaining -= batch;
-            // } while (0);
-        } while (remaining);
-        // 6ns for postive not using 0
-        // 2ns for not using 0
+        for (uint8_t i = 0; i < bolt_cnt; i++) {
+            uint8_t* entry = bolt_droplet(cloud, cloud_id, i);
+            move_entry(
+                hash_key_rebuild(bolt_truncated_key(cloud, i, entry), cloud_id),
+                *reinterpret_cast<uint64_t*>(entry + kDropletValueOffset));
+        }
     }
 
-    //  ───────────────────────────────────────── Miss / version check ─────────
-    if ((ver->load() != v0))
-        goto retry;
-    return false;
-}
-
-
-
-bool BoltHT::Update(uint64_t key, uint64_t value) {
+    for (uint8_t target = 0; target < 2; target++) {
+        if (batch_sizes[target]) {
+            res &= targets[target]->BulkInsert(batches[target],
+                                               batch_sizes[target]) == 0;
+        }
+    }
 
-    return 1;
+    return res;
 }
 
-void BoltHT::Free(uint64_t key) {}
-
 void BoltHT::Scan4Stats() {
     uint64_t total_slots = kCloudNum * kCloudByteLength;
     uint64_t used_slots = 0;
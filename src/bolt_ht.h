@@ -19,14 +19,13 @@
 #include <vector>
 #include "common.h"
 #include "utils/cache_line_size.h"
+#include "utils/page_pool.h"
+#include "utils/rank_select.h"
 
 namespace tinyptr {
 
 class BoltHT {
-    friend struct BoltHTCloudLookupInitializer;
-
    public:
-    static uint8_t kCloudLookup[256];
     static constexpr uint8_t kByteMask = 0xFF;
     static constexpr uint8_t kByteShift = 8;
 
@@ -61,6 +60,11 @@ class BoltHT {
     static constexpr uint8_t kControlCrystalMask = (1 << 3) - 1;
     static constexpr uint8_t kControlBoltShift = 3;
 
+    // bolts are scanned in windows of one 32-byte load; the last window is
+    // moved down to start at the cloud
+    static constexpr uint8_t kMaxBoltNum = kBoltOffset >> kBoltByteLengthShift;
+    static constexpr uint8_t kBoltWindowSize = 16;
+
     static constexpr double kCloudOverflowBound = 0.23;
     // expected ratio of used quotienting slots
     const uint64_t kCloudNum;
@@ -69,6 +73,9 @@ class BoltHT {
     const uint64_t kBinNum;
     static constexpr uint8_t kTinyPtrOffset = 0;
     static constexpr uint8_t kFingerprintOffset = 1;
+    // the fingerprint byte of every bolt in a byte mask of a window
+    static constexpr uint32_t kBoltWindowFingerprintMask =
+        0x55555555u << kFingerprintOffset;
     static constexpr uint8_t kKeyOffset = 0;
     const uint8_t kValueOffset;
     static constexpr uint8_t kDropletKeyOffset = 0;
@@ -101,23 +108,43 @@ class BoltHT {
     uint8_t AutoFastDivisionInnerShift(uint64_t divisor);
 
    public:
-    BoltHT(uint64_t size, uint8_t quotienting_tail_length, uint16_t bin_size);
+    // with a pool, the table memory is taken from and returned to it
+    BoltHT(uint64_t size, uint8_t quotienting_tail_length, uint16_t bin_size,
+           bool if_resize = false, double resize_threshold = 1.0,
+           utils::PagePool* pool = nullptr);
     BoltHT(uint64_t size, uint16_t bin_size);
     BoltHT(uint64_t size);
+    // the constructor ResizableHT builds its tables with
+    BoltHT(uint64_t size, bool if_resize, double resize_threshold,
+           utils::PagePool* pool = nullptr);
 
     ~BoltHT();
 
     bool Insert(uint64_t key, uint64_t value);
+    // returns how many entries did not fit; those are moved to the front of
+    // entries, in order
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
     bool Query(uint64_t key, uint64_t* value_ptr);
     bool Update(uint64_t key, uint64_t value);
+    // the last crystal or bolt of the cloud fills the hole, and bolts are
+    // lifted back into crystals as long as there is room for them
     void Free(uint64_t key);
 
     void SetResizeStride(uint64_t stride_num);
-    bool ResizeMoveStride(uint64_t stride_id, BoltHT* new_ht);
+    bool ResizeMoveStride(uint64_t stride_id, BoltHT* new_ht,
+                          BoltHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
+
+    uint64_t GetTableSize() const { return kCloudNum * 4 - 1; }
 
     void Scan4Stats();
 
    protected:
+    utils::PagePool* page_pool;
+    void* combined_mem;
+    uint64_t combined_mem_size;
+
     uint8_t* cloud_tab;
     uint8_t* byte_array;
     uint8_t* bin_cnt_head;
@@ -128,6 +155,8 @@ class BoltHT {
 
     uint64_t resize_stride_size;
 
+    static constexpr uint32_t kBulkInsertBatchSize = 64;
+
    protected:
     __attribute__((always_inline)) inline uint64_t hash_1(uint64_t key) {
         return XXH64(&key, sizeof(uint64_t), kHashSeed1);
@@ -315,6 +344,136 @@ class BoltHT {
         }
     }
 
+    // hands a droplet back to its bin
+    __attribute__((always_inline)) inline void ptab_release(uint8_t* entry,
+                                                            uint8_t tiny_ptr) {
+        uint64_t bin_id = (entry - byte_array) / kBinByteLength;
+
+        while (bin_locks[bin_id].test_and_set(std::memory_order_acquire))
+            ;
+
+        bin_cnt(bin_id)--;
+        uint8_t& head = bin_head(bin_id);
+        uint8_t cur_in_bin_pos = ((uint8_t)(tiny_ptr << 1) >> 1) - 1;
+        entry[kTinyPtrOffset] = head + kBinSize - cur_in_bin_pos;
+        if (entry[kTinyPtrOffset] > kBinSize) {
+            entry[kTinyPtrOffset] -= (kBinSize + 1);
+        }
+        head = cur_in_bin_pos;
+
+        bin_locks[bin_id].clear(std::memory_order_release);
+    }
+
+    __attribute__((always_inline)) inline uint8_t* bolt_at(uint8_t* cloud,
+                                                           uint8_t bolt_id) {
+        return cloud + kBoltOffset - ((bolt_id + 1) << kBoltByteLengthShift);
+    }
+
+    // the droplet a bolt points to
+    __attribute__((always_inline)) inline uint8_t* bolt_droplet(
+        uint8_t* cloud, uint64_t cloud_id, uint8_t bolt_id) {
+        uint8_t* bolt_ptr = bolt_at(cloud, bolt_id);
+        uint8_t fingerprint = bolt_ptr[kFingerprintOffset] ^ bolt_id;
+        return ptab_query_entry_address((cloud_id << kByteShift) | fingerprint,
+                                        bolt_ptr[kTinyPtrOffset]);
+    }
+
+    // the key a bolt stands for, shifted right by kQuotientingTailLength
+    __attribute__((always_inline)) inline uint64_t bolt_truncated_key(
+        uint8_t* cloud, uint8_t bolt_id, uint8_t* entry) {
+        uint8_t fingerprint = bolt_at(cloud, bolt_id)[kFingerprintOffset] ^
+                              bolt_id;
+        uint64_t droplet_key =
+            (*reinterpret_cast<uint64_t*>(entry + kDropletKeyOffset)
+             << kBoltQuotientingLength) >>
+            kBoltQuotientingLength;
+        return (droplet_key << kByteShift) | fingerprint;
+    }
+
+    // the caller holds the cloud's version; -1 if the key is in no crystal
+    __attribute__((always_inline)) inline int find_crystal(
+        uint8_t* cloud, uint8_t crystal_cnt, uint64_t truncated_key) {
+        uint64_t masked_key = truncated_key << kQuotientingTailLength;
+        for (uint8_t i = 0; i < crystal_cnt; i++) {
+            uint8_t* crystal_ptr =
+                cloud + kCrystalOffset + i * kCrystalByteLength;
+            if ((*reinterpret_cast<uint64_t*>(crystal_ptr + kKeyOffset)
+                 << kQuotientingTailLength) == masked_key) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // matches the 16 bolts from first_bolt_id on against a fingerprint with
+    // one load; the bolt first_bolt_id + 15 - j owns bits 2j and 2j + 1 of
+    // the result, of which only the fingerprint bit is kept
+    __attribute__((always_inline)) inline uint32_t bolt_window_match(
+        uint8_t* cloud, uint8_t first_bolt_id, uint8_t fingerprint) {
+        __m256i bolts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+            bolt_at(cloud, first_bolt_id + kBoltWindowSize - 1)));
+        // stored fingerprints are xor-ed with the bolt id, so the ids are
+        // laid over the fingerprint bytes
+        __m256i bolt_ids = _mm256_slli_epi16(
+            _mm256_add_epi16(_mm256_setr_epi16(15, 14, 13, 12, 11, 10, 9, 8, 7,
+                                               6, 5, 4, 3, 2, 1, 0),
+                             _mm256_set1_epi16(first_bolt_id)),
+            kFingerprintOffset * kByteShift);
+        __m256i cand = _mm256_xor_si256(bolts, bolt_ids);
+        __m256i query_fp = _mm256_set1_epi8(fingerprint);
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+        uint32_t mask = _mm256_cmpeq_epi8_mask(cand, query_fp);
+#else
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(cand, query_fp));
+#endif
+        return mask & kBoltWindowFingerprintMask;
+    }
+
+    // -1 if the key is in no bolt; without the cloud's version the caller
+    // checks it afterwards
+    __attribute__((always_inline)) inline int find_bolt(uint8_t* cloud,
+                                                        uint64_t cloud_id,
+                                                        uint8_t bolt_cnt,
+                                                        uint64_t truncated_key,
+                                                        uint8_t** entry_ptr) {
+        uint8_t fingerprint = truncated_key & kByteMask;
+        uint64_t masked_key = (truncated_key >> kByteShift)
+                              << kBoltQuotientingLength;
+        uint64_t deref_key = (cloud_id << kByteShift) | fingerprint;
+
+        for (uint8_t lo = 0; lo < bolt_cnt; lo += kBoltWindowSize) {
+            uint8_t first_bolt_id = lo < kMaxBoltNum - kBoltWindowSize
+                                        ? lo
+                                        : kMaxBoltNum - kBoltWindowSize;
+            uint8_t hi = bolt_cnt < lo + kBoltWindowSize
+                             ? bolt_cnt
+                             : lo + kBoltWindowSize;
+            // only bolts in [lo, hi)
+            uint32_t mask =
+                bolt_window_match(cloud, first_bolt_id, fingerprint) &
+                (~0u << ((first_bolt_id + kBoltWindowSize - hi) << 1)) &
+                (~0u >> ((lo - first_bolt_id) << 1));
+
+            while (mask) {
+                uint8_t bolt_id = first_bolt_id + kBoltWindowSize - 1 -
+                                  (_tzcnt_u32(mask) >> 1);
+                mask &= mask - 1;
+                uint8_t* entry = ptab_query_entry_address(
+                    deref_key, bolt_at(cloud, bolt_id)[kTinyPtrOffset]);
+                if ((*reinterpret_cast<uint64_t*>(entry + kDropletKeyOffset)
+                     << kBoltQuotientingLength) == masked_key) {
+                    *entry_ptr = entry;
+                    return bolt_id;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // moves the last bolts back into crystals while there is room for them,
+    // freeing their droplets; the caller holds the cloud's version
+    void cloud_lift_bolts(uint8_t* cloud, uint64_t cloud_id);
+
     __attribute__((always_inline)) inline void ptab_free(
         uint8_t* pre_tiny_ptr, uintptr_t pre_deref_key,
         uint64_t quotiented_N_reshifted_key) {
@@ -442,22 +601,8 @@ class BoltHT {
 
         // get the cloud_id of the last exhibitor
 
-        uint32_t hide_in_cloud_offset = _tzcnt_u32(
-            _pdep_u32(1u << (item_cnt - exhibitor_num), control_info));
-
-        /*
-        uint8_t hide_in_cloud_offset = 0;
-        uint16_t control_info_before_spilled =
-            control_info >> (hide_in_cloud_offset + 1);
-
-        while (kCloudLookup[control_info_before_spilled & kByteMask] +
-                   kCloudLookup[(control_info_before_spilled >> kByteShift)] >=
-               exhibitor_num) {
-            hide_in_cloud_offset++;
-            control_info_before_spilled =
-                control_info >> (hide_in_cloud_offset + 1);
-        }
-        */
+        uint32_t hide_in_cloud_offset =
+            utils::Select64(control_info, item_cnt - exhibitor_num);
 
         uintptr_t spilled_cloud_id = cloud_offset + hide_in_cloud_offset;
 
@@ -501,22 +646,8 @@ class BoltHT {
 
         // get the cloud_id of the first bolt
 
-        uint32_t raid_in_cloud_offset = _tzcnt_u32(
-            _pdep_u32(1u << (item_cnt - exhibitor_num - 1), control_info));
-
-        /*
-        uint8_t raid_in_cloud_offset = 0;
-        uint16_t control_info_before_spilled =
-            control_info >> (raid_in_cloud_offset + 1);
-
-        while (kCloudLookup[control_info_before_spilled & kByteMask] +
-                   kCloudLookup[(control_info_before_spilled >> kByteShift)] >
-               exhibitor_num) {
-            raid_in_cloud_offset++;
-            control_info_before_spilled =
-                control_info >> (raid_in_cloud_offset + 1);
-        }
-        */
+        uint32_t raid_in_cloud_offset =
+            utils::Select64(control_info, item_cnt - exhibitor_num - 1);
 
         uint8_t* pre_tiny_ptr = exhibitor_ptr + kTinyPtrOffset;
         uintptr_t pre_deref_key = cloud_offset + raid_in_cloud_offset;
@@ -540,17 +671,4 @@ class BoltHT {
     }
 };
 
-struct BoltHTCloudLookupInitializer {
-    BoltHTCloudLookupInitializer() {
-        for (int i = 0; i < 256; ++i) {
-            BoltHT::kCloudLookup[i] = 0;
-            int tmp = i;
-            while (tmp) {
-                BoltHT::kCloudLookup[i]++;
-                tmp -= tmp & (-tmp);
-            }
-        }
-    };
-};
-
 }  // namespace tinyptr
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <sys/cdefs.h>
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -26,7 +27,8 @@ uint8_t ByteArrayChainedHT::AutoQuotTailLength(uint64_t size) {
 
 ByteArrayChainedHT::ByteArrayChainedHT(uint64_t size,
                                        uint8_t quotienting_tail_length,
-                                       uint16_t bin_size)
+                                       uint16_t bin_size, bool if_resize,
+                                       utils::PagePool* pool)
     : kHashSeed1(rand() & ((1 << 16) - 1)),
       kHashSeed2(65536 + rand()),
       kQuotientingTailLength(quotienting_tail_length
@@ -40,7 +42,10 @@ ByteArrayChainedHT::ByteArrayChainedHT(uint64_t size,
       kValueOffset(kTinyPtrOffset + 1),
       kQuotKeyByteLength(kTinyPtrOffset),
       kEntryByteLength(kQuotKeyByteLength + 1 + 8),
-      kBinByteLength(kBinSize * kEntryByteLength) {
+      kBinByteLength(kBinSize * kEntryByteLength),
+      page_pool(pool) {
+
+    max_chain_length = if_resize ? kResizeMaxChainLength : 0;
 
     uint64_t base_tab_size = kBaseTabSize;
     uint64_t byte_array_size = kBinNum * kBinSize * kEntryByteLength;
@@ -59,9 +64,16 @@ ByteArrayChainedHT::ByteArrayChainedHT(uint64_t size,
         base_tab_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
     // Allocate a single aligned block
-    void* combined_mem;
-    combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
-                        MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    combined_size = total_size;
+    if (page_pool) {
+        combined_mem = page_pool->Acquire(total_size);
+    } else if (if_resize) {
+        combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+                            MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    } else {
+        combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+                            MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    }
 
     // Assign pointers to their respective regions
     uint8_t* base =
@@ -109,6 +121,15 @@ ByteArrayChainedHT::ByteArrayChainedHT(uint64_t size,
 ByteArrayChainedHT::ByteArrayChainedHT(uint64_t size, uint16_t bin_size)
     : ByteArrayChainedHT(size, 0, bin_size) {}
 
+ByteArrayChainedHT::~ByteArrayChainedHT() {
+    delete[] play_entry;
+    if (page_pool) {
+        page_pool->Release(combined_mem, combined_size);
+    } else {
+        munmap(combined_mem, combined_size);
+    }
+}
+
 uint64_t ByteArrayChainedHT::limited_base_id(uint64_t key) {
     if (limited_base_cnt < limited_base_entry_num) {
         return limited_base_cnt++;
@@ -165,14 +186,25 @@ void ByteArrayChainedHT::evict_entry_cache_line(uint8_t* entry) {
 }
 
 bool ByteArrayChainedHT::Insert(uint64_t key, uint64_t value) {
+    return insert_in_chain(key, value, max_chain_length);
+}
+
+bool ByteArrayChainedHT::insert_in_chain(uint64_t key, uint64_t value,
+                                         uint32_t max_chain_length) {
 
     uint64_t base_id = hash_1_base_id(key);
     uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+    uint32_t chain_length = 0;
 
     while (*pre_tiny_ptr != 0) {
         uint8_t* entry = ptab_query_entry_address(
             reinterpret_cast<uint64_t>(pre_tiny_ptr), *pre_tiny_ptr);
         pre_tiny_ptr = entry + kTinyPtrOffset;
+        chain_length++;
+    }
+
+    if (max_chain_length && chain_length >= max_chain_length) {
+        return false;
     }
 
     uint8_t* entry =
@@ -199,6 +231,8 @@ bool ByteArrayChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
     key >>= kQuotientingTailLength;
     key <<= kQuotientingTailLength;
 
+    uint8_t* pre_entry = nullptr;
+
     while (*pre_tiny_ptr != 0) {
 
         query_entry_cnt++;
@@ -208,10 +242,15 @@ bool ByteArrayChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
         if ((*reinterpret_cast<uint64_t*>(entry) << kQuotientingTailLength) ==
             key) {
             *value_ptr = *reinterpret_cast<uint64_t*>(entry + kValueOffset);
+            if (adaptive_chains && pre_entry &&
+                (++promote_tick & kPromoteSampleMask) == 0) {
+                swap_payload(pre_entry, entry);
+            }
             // evict_entry_cache_line(entry);
             return true;
         }
         // evict_entry_cache_line(entry);
+        pre_entry = entry;
         pre_tiny_ptr = entry + kTinyPtrOffset;
     }
 
@@ -236,10 +275,156 @@ bool ByteArrayChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
     return false;
 }
 
+void ByteArrayChainedHT::SetAdaptiveChains(bool adaptive) {
+    adaptive_chains = adaptive;
+}
+
+void ByteArrayChainedHT::SetMaxChainLength(uint32_t max_chain_length) {
+    this->max_chain_length = max_chain_length;
+}
+
+uint32_t ByteArrayChainedHT::BulkInsert(
+    std::pair<uint64_t, uint64_t>* entries, uint32_t entry_num) {
+    uint32_t failed_num = 0;
+
+    for (uint32_t i = 0; i < entry_num; i++) {
+        if (!insert_in_chain(entries[i].first, entries[i].second, 0)) {
+            entries[failed_num++] = entries[i];
+        }
+    }
+
+    return failed_num;
+}
+
+void ByteArrayChainedHT::SetResizeStride(uint64_t stride_num) {
+    resize_stride_size = ceil(1.0 * kBaseTabSize / (stride_num));
+}
+
+bool ByteArrayChainedHT::ResizeMoveStride(uint64_t stride_id,
+                                          ByteArrayChainedHT* new_ht,
+                                          ByteArrayChainedHT* split_ht,
+                                          PartitionRouter router,
+                                          uint64_t split_bit) {
+
+    uint64_t start_base_id = stride_id * resize_stride_size;
+    uint64_t end_base_id = start_base_id + resize_stride_size;
+    if (end_base_id > kBaseTabSize) {
+        end_base_id = kBaseTabSize;
+    }
+
+    std::pair<uint64_t, uint64_t> batches[2][kBulkInsertBatchSize];
+    uint32_t batch_sizes[2] = {0, 0};
+    ByteArrayChainedHT* targets[2] = {new_ht, split_ht};
+    bool res = true;
+
+    for (uint64_t base_id = start_base_id; base_id < end_base_id; base_id++) {
+
+        uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+        while (*pre_tiny_ptr != 0) {
+
+            uint8_t* entry = ptab_query_entry_address(
+                reinterpret_cast<uint64_t>(pre_tiny_ptr), *pre_tiny_ptr);
+
+            uint64_t ins_key = hash_key_rebuild(
+                *reinterpret_cast<uint64_t*>(entry), base_id);
+
+            uint8_t target = split_ht && (router.Route(ins_key) & split_bit);
+            batches[target][batch_sizes[target]++] = std::make_pair(
+                ins_key, *reinterpret_cast<uint64_t*>(entry + kValueOffset));
+            if (batch_sizes[target] == kBulkInsertBatchSize) {
+                res &= targets[target]->BulkInsert(
+                           batches[target], batch_sizes[target]) == 0;
+                batch_sizes[target] = 0;
+            }
+
+            pre_tiny_ptr = entry + kTinyPtrOffset;
+        }
+    }
+
+    for (uint8_t target = 0; target < 2; target++) {
+        if (batch_sizes[target]) {
+            res &= targets[target]->BulkInsert(batches[target],
+                                               batch_sizes[target]) == 0;
+        }
+    }
+
+    return res;
+}
+
 void ByteArrayChainedHT::set_chain_length(uint64_t chain_length) {
     this->chain_length = chain_length;
 }
 
+uint32_t ByteArrayChainedHT::MultiQuery(const uint64_t* keys,
+                                        uint32_t key_num, uint64_t* values,
+                                        bool* found) {
+    // one chain walk in flight; entry is the hop prefetched on its last turn,
+    // or null while the base slot is still on its way
+    struct ChainWalk {
+        uint32_t key_id;
+        uint64_t quot_key;
+        uint8_t* pre_tiny_ptr;
+        uint8_t* entry;
+    };
+
+    ChainWalk walks[kMultiQueryWidth];
+    uint32_t walk_num = 0;
+    uint32_t next_key = 0;
+    uint32_t found_num = 0;
+
+    auto start_walk = [&](ChainWalk& walk) {
+        uint64_t key = keys[next_key];
+        walk.key_id = next_key++;
+        walk.quot_key = key >> kQuotientingTailLength << kQuotientingTailLength;
+        walk.pre_tiny_ptr = &base_tab_ptr(hash_1_base_id(key));
+        walk.entry = nullptr;
+        __builtin_prefetch(walk.pre_tiny_ptr, 0, 3);
+    };
+
+    // one hop; true once the walk is over
+    auto step = [&](ChainWalk& walk) {
+        if (walk.entry) {
+            if ((*reinterpret_cast<uint64_t*>(walk.entry)
+                 << kQuotientingTailLength) == walk.quot_key) {
+                values[walk.key_id] =
+                    *reinterpret_cast<uint64_t*>(walk.entry + kValueOffset);
+                found[walk.key_id] = true;
+                found_num++;
+                return true;
+            }
+            walk.pre_tiny_ptr = walk.entry + kTinyPtrOffset;
+        }
+
+        if (*walk.pre_tiny_ptr == 0) {
+            found[walk.key_id] = false;
+            return true;
+        }
+
+        walk.entry = ptab_query_entry_address(
+            reinterpret_cast<uint64_t>(walk.pre_tiny_ptr), *walk.pre_tiny_ptr);
+        __builtin_prefetch(walk.entry, 0, 3);
+        return false;
+    };
+
+    while (walk_num < kMultiQueryWidth && next_key < key_num) {
+        start_walk(walks[walk_num++]);
+    }
+
+    while (walk_num) {
+        for (uint32_t i = 0; i < walk_num;) {
+            if (!step(walks[i])) {
+                i++;
+            } else if (next_key < key_num) {
+                start_walk(walks[i++]);
+            } else {
+                walks[i] = walks[--walk_num];
+            }
+        }
+    }
+
+    return found_num;
+}
+
 bool ByteArrayChainedHT::QueryNoMem(uint64_t key, uint64_t* value_ptr) {
     uint64_t base_id = hash_1_base_id(key);
     uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
@@ -283,7 +468,7 @@ bool ByteArrayChainedHT::Update(uint64_t key, uint64_t value) {
     return false;
 }
 
-void ByteArrayChainedHT::Free(uint64_t key) {
+bool ByteArrayChainedHT::Free(uint64_t key) {
     uint64_t base_id = hash_1_base_id(key);
     uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
     uint8_t* cur_tiny_ptr = nullptr;
@@ -304,7 +489,7 @@ void ByteArrayChainedHT::Free(uint64_t key) {
         }
         cur_tiny_ptr = cur_entry + kTinyPtrOffset;
     } else {
-        return;
+        return false;
     }
 
     while (*cur_tiny_ptr != 0) {
@@ -321,23 +506,28 @@ void ByteArrayChainedHT::Free(uint64_t key) {
     }
 
     if (aiming_entry == nullptr) {
-        return;
+        return false;
     }
 
     uint8_t tmp = aiming_entry[kTinyPtrOffset];
     memcpy(aiming_entry, cur_entry, kEntryByteLength);
     aiming_entry[kTinyPtrOffset] = tmp;
 
-    uint64_t bin_id = (cur_entry - byte_array) / kBinByteLength;
+    release_slot(cur_entry, *pre_tiny_ptr);
+    *pre_tiny_ptr = 0;
+    return true;
+}
+
+void ByteArrayChainedHT::release_slot(uint8_t* entry, uint8_t tiny_ptr) {
+    uint64_t bin_id = (entry - byte_array) / kBinByteLength;
     bin_cnt(bin_id)--;
     uint8_t& head = bin_head(bin_id);
-    uint8_t cur_in_bin_pos = ((uint8_t)((*pre_tiny_ptr) << 1) >> 1) - 1;
-    cur_entry[kTinyPtrOffset] = head + kBinSize - cur_in_bin_pos;
-    if (cur_entry[kTinyPtrOffset] > kBinSize) {
-        cur_entry[kTinyPtrOffset] -= (kBinSize + 1);
+    uint8_t cur_in_bin_pos = ((uint8_t)(tiny_ptr << 1) >> 1) - 1;
+    entry[kTinyPtrOffset] = head + kBinSize - cur_in_bin_pos;
+    if (entry[kTinyPtrOffset] > kBinSize) {
+        entry[kTinyPtrOffset] -= (kBinSize + 1);
     }
     head = cur_in_bin_pos;
-    *pre_tiny_ptr = 0;
 }
 
 double ByteArrayChainedHT::AvgChainLength() {
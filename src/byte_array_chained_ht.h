@@ -6,9 +6,12 @@
 #include <sys/cdefs.h>
 #include <sys/types.h>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <utility>
 #include "common.h"
 #include "utils/cache_line_size.h"
+#include "utils/page_pool.h"
 
 namespace tinyptr {
 
@@ -37,17 +40,21 @@ class ByteArrayChainedHT {
     uint8_t AutoQuotTailLength(uint64_t size);
 
    public:
+    // with a pool, the table memory is taken from and returned to it
     ByteArrayChainedHT(uint64_t size, uint8_t quotienting_tail_length,
-                       uint16_t bin_size);
+                       uint16_t bin_size, bool if_resize = false,
+                       utils::PagePool* pool = nullptr);
     ByteArrayChainedHT(uint64_t size, uint16_t bin_size);
 
+    ~ByteArrayChainedHT();
+
    protected:
     __attribute__((always_inline)) inline uint64_t hash_1(uint64_t key) {
         return XXH64(&key, sizeof(uint64_t), kHashSeed1);
     }
 
     __attribute__((always_inline)) inline uint64_t hash_1_bin(uint64_t key) {
-        return (XXH64(&key, sizeof(uint64_t), kHashSeed1)) % kBinNum;
+        return FastRange(XXH64(&key, sizeof(uint64_t), kHashSeed1), kBinNum);
         // return 0;
     }
 
@@ -58,12 +65,21 @@ class ByteArrayChainedHT {
                kQuotientingTailMask;
     }
 
+    __attribute__((always_inline)) inline uint64_t hash_key_rebuild(
+        uint64_t quotiented_key, uint64_t base_id) {
+        uint64_t tmp = (quotiented_key << kQuotientingTailLength) >>
+                       kQuotientingTailLength;
+        return ((XXH64(&tmp, sizeof(uint64_t), kHashSeed1) ^ base_id) &
+                kQuotientingTailMask) |
+               (tmp << kQuotientingTailLength);
+    }
+
     __attribute__((always_inline)) inline uint64_t hash_2(uint64_t key) {
         return XXH64(&key, sizeof(uint64_t), kHashSeed2);
     }
 
     __attribute__((always_inline)) inline uint64_t hash_2_bin(uint64_t key) {
-        return (XXH64(&key, sizeof(uint64_t), kHashSeed2)) % kBinNum;
+        return FastRange(XXH64(&key, sizeof(uint64_t), kHashSeed2), kBinNum);
         // return 0;
     }
 
@@ -125,12 +141,69 @@ class ByteArrayChainedHT {
 
    protected:
     uint64_t limited_base_id(uint64_t key);
+    // max_chain_length 0 leaves the chain uncapped
+    bool insert_in_chain(uint64_t key, uint64_t value,
+                         uint32_t max_chain_length);
+    // hands the slot tiny_ptr points to back to its bin
+    void release_slot(uint8_t* entry, uint8_t tiny_ptr);
+
+    static constexpr uint32_t kBulkInsertBatchSize = 64;
+    static constexpr uint32_t kResizeMaxChainLength = 16;
+    static constexpr uint32_t kMultiQueryWidth = 16;
+    // one in 2^kPromoteSampleShift hits past the chain head is promoted
+    static constexpr uint32_t kPromoteSampleShift = 4;
+    static constexpr uint32_t kPromoteSampleMask =
+        (1 << kPromoteSampleShift) - 1;
+
+    // swaps the keys and values of two entries; the tiny pointers stay put,
+    // as every slot is placed by the address of the pointer linking to it
+    __attribute__((always_inline)) inline void swap_payload(uint8_t* entry,
+                                                            uint8_t* other) {
+        uint8_t tmp[8];
+        memcpy(tmp, entry, kQuotKeyByteLength);
+        memcpy(entry, other, kQuotKeyByteLength);
+        memcpy(other, tmp, kQuotKeyByteLength);
+        memcpy(tmp, entry + kValueOffset, 8);
+        memcpy(entry + kValueOffset, other + kValueOffset, 8);
+        memcpy(other + kValueOffset, tmp, 8);
+    }
 
    public:
     bool Insert(uint64_t key, uint64_t value);
+    // returns how many entries did not fit, moved to the front of entries;
+    // the chain cap is not applied, so migrated entries are not refused
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
     bool Query(uint64_t key, uint64_t* value_ptr);
+    // looks up key_num keys at once: up to kMultiQueryWidth chain walks take
+    // turns, each prefetching its next hop before yielding, so the misses of
+    // different chains overlap instead of queueing up behind each other
+    // found[i] tells whether keys[i] is there, values[i] then holds its
+    // value; returns how many were found
+    uint32_t MultiQuery(const uint64_t* keys, uint32_t key_num,
+                        uint64_t* values, bool* found);
     bool Update(uint64_t key, uint64_t value);
-    void Free(uint64_t key);
+    // returns whether the key was there
+    bool Free(uint64_t key);
+
+    // with adaptive chains, a sample of the hits past the chain head swap the
+    // entry found with the one before it, so the keys hit most drift to the
+    // front under skewed traffic; off by default, as it turns reads into
+    // writes
+    void SetAdaptiveChains(bool adaptive);
+    // caps every chain at max_chain_length entries, so no lookup walks
+    // further; an insert that would go past it fails instead; 0, the
+    // default, leaves chains unbounded
+    void SetMaxChainLength(uint32_t max_chain_length);
+
+    // only reads this table, so the owner can keep it until every stride
+    // has been moved
+    void SetResizeStride(uint64_t stride_num);
+    bool ResizeMoveStride(uint64_t stride_id, ByteArrayChainedHT* new_ht,
+                          ByteArrayChainedHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
+
+    uint64_t GetTableSize() const { return kBinSize * kBinNum; }
 
     // Experimental Utility Functions
    public:
@@ -141,10 +214,20 @@ class ByteArrayChainedHT {
     uint64_t QueryEntryCnt();
 
    protected:
+    utils::PagePool* page_pool;
+    void* combined_mem;
+    uint64_t combined_size;
+
     uint8_t* byte_array;
     uint8_t* base_tab;
     uint8_t* bin_cnt_head;
 
+    uint64_t resize_stride_size;
+
+    bool adaptive_chains = false;
+    uint32_t promote_tick = 0;
+    uint32_t max_chain_length = 0;
+
    protected:
     uint8_t non_temporal_load_entry_buffer[64];
 
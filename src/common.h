@@ -13,4 +13,27 @@
 
 // General-purpose hash macro - you can change the implementation as needed
 #define HASH_FUNCTION(input, length, seed) XXH3_64bits_withSeed(input, length, seed)
-// #define HASH_FUNCTION(input, length, seed) XXH64(input, length, seed)
\ No newline at end of file
+// #define HASH_FUNCTION(input, length, seed) XXH64(input, length, seed)
+namespace tinyptr {
+
+// maps a hash onto [0, range) with one multiply, the high half of
+// hash * range, instead of a 64-bit division; it takes the high bits of the
+// hash where % takes the low ones
+__attribute__((always_inline)) inline uint64_t FastRange(uint64_t hash,
+                                                         uint64_t range) {
+    return static_cast<uint64_t>((static_cast<__uint128_t>(hash) * range) >>
+                                 64);
+}
+
+// how ResizableHT routes a key to a partition; a resize that splits a
+// partition passes it to ResizeMoveStride to divide the entries
+struct PartitionRouter {
+    uint64_t seed;
+    uint64_t multiplier;
+
+    __attribute__((always_inline)) inline uint64_t Route(uint64_t key) const {
+        return ((key ^ seed) * multiplier) >> 32;
+    }
+};
+
+}  // namespace tinyptr
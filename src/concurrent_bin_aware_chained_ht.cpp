@@ -0,0 +1,516 @@
+#include "concurrent_bin_aware_chained_ht.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace tinyptr {
+
+ConcurrentBinAwareChainedHT::ConcurrentBinAwareChainedHT(
+    uint64_t size, bool if_resize, double resize_threshold,
+    utils::PagePool* pool, uint16_t bin_size, uint8_t double_slot_num)
+    : ConcurrentByteArrayChainedHT(size, 0, bin_size, if_resize,
+                                   resize_threshold, pool),
+      kDoubleSlotSize(double_slot_num),
+      kDoubleSlotNum(double_slot_num >> 1),
+      head_double_slot(new uint8_t[kBinNum]()),
+      split_double_slot(new std::atomic<uint64_t>[kBinNum]()) {
+    // chain pointers keep bit 7 for the base pointer's bin choice
+    assert(kBinSize < (1 << 7));
+    assert(((kDoubleSlotSize & 1) == 0) && kDoubleSlotSize <= kBinSize);
+
+    // the single slots start right after the pairs
+    for (uint64_t i = 0; i < kBinNum; i++) {
+        bin_head(i) = kDoubleSlotSize;
+    }
+}
+
+uint8_t ConcurrentBinAwareChainedHT::pop_single_slot(uint64_t bin_id) {
+    uint8_t& head = bin_head(bin_id);
+    if (head >= kBinSize) {
+        return kBinSize;
+    }
+
+    uint8_t slot = head;
+    uint8_t* entry = byte_array + bin_id * kBinByteLength +
+                     slot * kEntryByteLength;
+    head = head + 1 + entry[kTinyPtrOffset];
+    if (head > kBinSize) {
+        head -= (kBinSize + 1);
+    }
+    bin_cnt(bin_id)++;
+    return slot;
+}
+
+uint8_t ConcurrentBinAwareChainedHT::pop_double_slot(uint64_t bin_id) {
+    uint8_t& head = bin_head_double_slot(bin_id);
+    if (head >= kDoubleSlotNum) {
+        return kBinSize;
+    }
+
+    uint8_t slot = head << 1;
+    uint8_t* entry = byte_array + bin_id * kBinByteLength +
+                     slot * kEntryByteLength;
+    head = head + 1 + entry[kTinyPtrOffset];
+    if (head > kDoubleSlotNum) {
+        head -= (kDoubleSlotNum + 1);
+    }
+    // the second slot is held for the chain as well
+    bin_cnt(bin_id) += 2;
+    return slot;
+}
+
+uint8_t ConcurrentBinAwareChainedHT::pop_slot(uint64_t bin_id) {
+    uint8_t slot = pop_single_slot(bin_id);
+    if (slot != kBinSize) {
+        return slot;
+    }
+
+    slot = pop_double_slot(bin_id);
+    if (slot != kBinSize) {
+        split_double_slot[bin_id].fetch_or(1ULL << (slot >> 1),
+                                           std::memory_order_relaxed);
+        push_slot(bin_id, slot + 1);
+    }
+    return slot;
+}
+
+void ConcurrentBinAwareChainedHT::push_slot(uint64_t bin_id, uint8_t slot) {
+    uint8_t* entry = byte_array + bin_id * kBinByteLength +
+                     slot * kEntryByteLength;
+    bool pair = is_double_slot(bin_id, slot);
+    if (pair && (slot & 1)) {
+        return;
+    }
+
+    uint8_t& head = pair ? bin_head_double_slot(bin_id) : bin_head(bin_id);
+    uint8_t num = pair ? kDoubleSlotNum : kBinSize;
+    uint8_t pos = pair ? slot >> 1 : slot;
+
+    entry[kTinyPtrOffset] = head + num - pos;
+    if (entry[kTinyPtrOffset] > num) {
+        entry[kTinyPtrOffset] -= (num + 1);
+    }
+    head = pos;
+    bin_cnt(bin_id) -= pair ? 2 : 1;
+}
+
+bool ConcurrentBinAwareChainedHT::Insert(uint64_t key, uint64_t value) {
+    return insert_in_chain(hash_1_base_id(key), key, value, max_chain_length);
+}
+
+uint32_t ConcurrentBinAwareChainedHT::BulkInsert(
+    std::pair<uint64_t, uint64_t>* entries, uint32_t entry_num) {
+    uint64_t base_ids[kBulkInsertBatchSize];
+    uint32_t failed_num = 0;
+
+    for (uint32_t batch_start = 0; batch_start < entry_num;
+         batch_start += kBulkInsertBatchSize) {
+        std::pair<uint64_t, uint64_t>* batch = entries + batch_start;
+        uint32_t batch_size =
+            std::min<uint32_t>(kBulkInsertBatchSize, entry_num - batch_start);
+
+        for (uint32_t i = 0; i < batch_size; i++) {
+            base_ids[i] = hash_1_base_id(batch[i].first);
+            _mm_prefetch(&base_tab_ptr(base_ids[i]), _MM_HINT_T0);
+        }
+
+        for (uint32_t i = 0; i < batch_size; i++) {
+            if (!insert_in_chain(base_ids[i], batch[i].first,
+                                 batch[i].second, 0)) {
+                entries[failed_num++] = batch[i];
+            }
+        }
+    }
+
+    return failed_num;
+}
+
+bool ConcurrentBinAwareChainedHT::insert_in_chain(uint64_t base_id,
+                                                  uint64_t key,
+                                                  uint64_t value,
+                                                  uint32_t max_chain_length) {
+    std::atomic<uint8_t>& concurrent_version = version_of(base_id);
+
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while ((expected_version & 1) ||
+             !concurrent_version.compare_exchange_weak(expected_version,
+                                                       expected_version + 1));
+
+    uint8_t* base_tiny_ptr = &base_tab_ptr(base_id);
+    uint8_t* entry = nullptr;
+
+    if (*base_tiny_ptr == 0) {
+        // a new chain picks the less loaded of its two bins, and sticks to it
+        uint64_t base_intptr = reinterpret_cast<uint64_t>(base_tiny_ptr);
+        uint64_t bins[2] = {hash_1_bin(base_intptr), hash_2_bin(base_intptr)};
+
+        uint64_t lock_bin1 = std::min(bins[0], bins[1]);
+        uint64_t lock_bin2 = std::max(bins[0], bins[1]);
+        lock_bin(lock_bin1);
+        if (lock_bin2 != lock_bin1) {
+            lock_bin(lock_bin2);
+        }
+
+        uint8_t flag = bin_cnt(bins[0]) > bin_cnt(bins[1]);
+        uint8_t slot = pop_slot(bins[flag]);
+        if (slot == kBinSize) {
+            flag ^= 1;
+            slot = pop_slot(bins[flag]);
+        }
+
+        if (lock_bin2 != lock_bin1) {
+            unlock_bin(lock_bin2);
+        }
+        unlock_bin(lock_bin1);
+
+        if (slot == kBinSize) {
+            concurrent_version.fetch_add(1);
+            return false;
+        }
+
+        entry = byte_array + bins[flag] * kBinByteLength +
+                slot * kEntryByteLength;
+        // assuming little endian
+        *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
+        entry[kTinyPtrOffset] = 0;
+        *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+        *base_tiny_ptr = (slot + 1) | (flag << 7);
+
+        concurrent_version.fetch_add(1);
+        return true;
+    }
+
+    uint64_t bin_id = base_bin(base_tiny_ptr, *base_tiny_ptr);
+    uint8_t* bin_begin = byte_array + bin_id * kBinByteLength;
+
+    uint8_t* pre_tail_tiny_ptr = nullptr;
+    uint8_t* tail_tiny_ptr = base_tiny_ptr;
+    uint32_t chain_length = 0;
+    while ((*tail_tiny_ptr & kInBinTinyPtrMask) != 0) {
+        pre_tail_tiny_ptr = tail_tiny_ptr;
+        tail_tiny_ptr =
+            bin_entry(bin_begin, *tail_tiny_ptr) + kTinyPtrOffset;
+        chain_length++;
+    }
+
+    if (max_chain_length && chain_length >= max_chain_length) {
+        concurrent_version.fetch_add(1);
+        return false;
+    }
+
+    uint8_t tail_slot = (*pre_tail_tiny_ptr & kInBinTinyPtrMask) - 1;
+
+    bool tail_in_pair = is_double_slot(bin_id, tail_slot);
+    if (tail_in_pair && !(tail_slot & 1)) {
+        // the tail opens a pair, whose second slot is ours already
+        entry = bin_begin + (tail_slot + 1) * kEntryByteLength;
+        *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
+        entry[kTinyPtrOffset] = 0;
+        *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+        *tail_tiny_ptr = tail_slot + 2;
+
+        concurrent_version.fetch_add(1);
+        return true;
+    }
+
+    lock_bin(bin_id);
+
+    uint8_t slot = tail_in_pair ? kBinSize : pop_double_slot(bin_id);
+    if (slot != kBinSize) {
+        // a single tail moves into a free pair, the new entry taking the
+        // pair's second slot
+        uint8_t* tail_entry = tail_tiny_ptr - kTinyPtrOffset;
+        uint8_t* double_slot_begin = bin_begin + slot * kEntryByteLength;
+        memcpy(double_slot_begin, tail_entry, kEntryByteLength);
+        double_slot_begin[kTinyPtrOffset] = slot + 2;
+
+        entry = double_slot_begin + kEntryByteLength;
+        *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
+        entry[kTinyPtrOffset] = 0;
+        *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+
+        *pre_tail_tiny_ptr =
+            (slot + 1) | (*pre_tail_tiny_ptr & kSecondHashMask);
+        push_slot(bin_id, tail_slot);
+    } else {
+        slot = pop_slot(bin_id);
+        if (slot != kBinSize) {
+            entry = bin_begin + slot * kEntryByteLength;
+            *reinterpret_cast<uint64_t*>(entry) =
+                key >> kQuotientingTailLength;
+            entry[kTinyPtrOffset] = 0;
+            *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+            *tail_tiny_ptr = slot + 1;
+        }
+    }
+
+    unlock_bin(bin_id);
+    concurrent_version.fetch_add(1);
+    return slot != kBinSize;
+}
+
+bool ConcurrentBinAwareChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
+    uint64_t base_id = hash_1_base_id(key);
+    uint8_t* base_tiny_ptr = &base_tab_ptr(base_id);
+    std::atomic<uint8_t>& concurrent_version = version_of(base_id);
+
+    // quotienting and shifting back
+    key >>= kQuotientingTailLength;
+    key <<= kQuotientingTailLength;
+
+query_again:
+
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while (expected_version & 1);
+
+    uint8_t tiny_ptr = *base_tiny_ptr;
+    if (tiny_ptr != 0) {
+        uint8_t* bin_begin =
+            byte_array + base_bin(base_tiny_ptr, tiny_ptr) * kBinByteLength;
+        _mm_prefetch(bin_begin, _MM_HINT_T0);
+
+        // a chain never leaves its bin, so a longer walk went through a slot
+        // rewritten under it, and the version check sends it back
+        for (uint16_t hop = 0;
+             (tiny_ptr & kInBinTinyPtrMask) != 0 && hop < kBinSize; hop++) {
+            uint8_t* entry = bin_entry(bin_begin, tiny_ptr);
+            if ((*reinterpret_cast<uint64_t*>(entry)
+                 << kQuotientingTailLength) == key) {
+                *value_ptr = *reinterpret_cast<uint64_t*>(entry + kValueOffset);
+                if (concurrent_version.load() != expected_version) {
+                    goto query_again;
+                }
+                return true;
+            }
+            tiny_ptr = entry[kTinyPtrOffset];
+        }
+    }
+
+    if (concurrent_version.load() != expected_version) {
+        goto query_again;
+    }
+    return false;
+}
+
+bool ConcurrentBinAwareChainedHT::Update(uint64_t key, uint64_t value) {
+    uint64_t base_id = hash_1_base_id(key);
+    uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+    std::atomic<uint8_t>& concurrent_version = version_of(base_id);
+
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while ((expected_version & 1) ||
+             !concurrent_version.compare_exchange_weak(expected_version,
+                                                       expected_version + 1));
+
+    // quotienting
+    key >>= kQuotientingTailLength;
+
+    if (*pre_tiny_ptr != 0) {
+        uint8_t* bin_begin =
+            byte_array +
+            base_bin(pre_tiny_ptr, *pre_tiny_ptr) * kBinByteLength;
+        while ((*pre_tiny_ptr & kInBinTinyPtrMask) != 0) {
+            uint8_t* entry = bin_entry(bin_begin, *pre_tiny_ptr);
+            if (((*reinterpret_cast<uint64_t*>(entry)
+                  << kQuotientingTailLength) >>
+                 kQuotientingTailLength) == key) {
+                *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+                concurrent_version.fetch_add(1);
+                return true;
+            }
+            pre_tiny_ptr = entry + kTinyPtrOffset;
+        }
+    }
+
+    concurrent_version.fetch_add(1);
+    return false;
+}
+
+void ConcurrentBinAwareChainedHT::Free(uint64_t key) {
+    uint64_t base_id = hash_1_base_id(key);
+    uint8_t* base_tiny_ptr = &base_tab_ptr(base_id);
+    std::atomic<uint8_t>& concurrent_version = version_of(base_id);
+
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while ((expected_version & 1) ||
+             !concurrent_version.compare_exchange_weak(expected_version,
+                                                       expected_version + 1));
+
+    if (*base_tiny_ptr == 0) {
+        concurrent_version.fetch_add(1);
+        return;
+    }
+
+    // quotienting
+    key >>= kQuotientingTailLength;
+
+    uint64_t bin_id = base_bin(base_tiny_ptr, *base_tiny_ptr);
+    uint8_t* bin_begin = byte_array + bin_id * kBinByteLength;
+
+    uint8_t* pre_tiny_ptr = nullptr;
+    uint8_t* cur_tiny_ptr = base_tiny_ptr;
+    uint8_t* cur_entry = nullptr;
+    uint8_t* aiming_entry = nullptr;
+
+    while ((*cur_tiny_ptr & kInBinTinyPtrMask) != 0) {
+        pre_tiny_ptr = cur_tiny_ptr;
+        cur_entry = bin_entry(bin_begin, *cur_tiny_ptr);
+        if (((*reinterpret_cast<uint64_t*>(cur_entry)
+              << kQuotientingTailLength) >>
+             kQuotientingTailLength) == key) {
+            aiming_entry = cur_entry;
+        }
+        cur_tiny_ptr = cur_entry + kTinyPtrOffset;
+    }
+
+    if (aiming_entry == nullptr) {
+        concurrent_version.fetch_add(1);
+        return;
+    }
+
+    // the tail fills the hole, so the chain only ever shrinks at its end
+    uint8_t tmp = aiming_entry[kTinyPtrOffset];
+    memcpy(aiming_entry, cur_entry, kEntryByteLength);
+    aiming_entry[kTinyPtrOffset] = tmp;
+
+    uint8_t tail_slot = (*pre_tiny_ptr & kInBinTinyPtrMask) - 1;
+    *pre_tiny_ptr = 0;
+
+    // a freed second slot stays with its first, now the tail
+    if (!is_double_slot(bin_id, tail_slot) || !(tail_slot & 1)) {
+        lock_bin(bin_id);
+        push_slot(bin_id, tail_slot);
+        unlock_bin(bin_id);
+    }
+
+    concurrent_version.fetch_add(1);
+}
+
+bool ConcurrentBinAwareChainedHT::ResizeMoveStride(
+    uint64_t stride_id, ConcurrentBinAwareChainedHT* new_ht,
+    ConcurrentBinAwareChainedHT* split_ht, PartitionRouter router,
+    uint64_t split_bit) {
+
+    uint64_t start_base_id = stride_id * resize_stride_size;
+    uint64_t end_base_id = start_base_id + resize_stride_size;
+    if (end_base_id > kBaseTabSize) {
+        end_base_id = kBaseTabSize;
+    }
+
+    std::pair<uint64_t, uint64_t> batches[2][kBulkInsertBatchSize];
+    uint32_t batch_sizes[2] = {0, 0};
+    ConcurrentBinAwareChainedHT* targets[2] = {new_ht, split_ht};
+    bool res = true;
+
+    for (uint64_t base_id = start_base_id; base_id < end_base_id; base_id++) {
+
+        uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+        if (*pre_tiny_ptr == 0) {
+            continue;
+        }
+        uint8_t* bin_begin =
+            byte_array +
+            base_bin(pre_tiny_ptr, *pre_tiny_ptr) * kBinByteLength;
+
+        while ((*pre_tiny_ptr & kInBinTinyPtrMask) != 0) {
+            uint8_t* entry = bin_entry(bin_begin, *pre_tiny_ptr);
+
+            uint64_t ins_key = hash_key_rebuild(
+                *reinterpret_cast<uint64_t*>(entry), base_id);
+
+            uint8_t target = split_ht && (router.Route(ins_key) & split_bit);
+            batches[target][batch_sizes[target]++] = std::make_pair(
+                ins_key, *reinterpret_cast<uint64_t*>(entry + kValueOffset));
+            if (batch_sizes[target] == kBulkInsertBatchSize) {
+                res &= targets[target]->BulkInsert(
+                           batches[target], batch_sizes[target]) == 0;
+                batch_sizes[target] = 0;
+            }
+
+            pre_tiny_ptr = entry + kTinyPtrOffset;
+        }
+    }
+
+    for (uint8_t target = 0; target < 2; target++) {
+        if (batch_sizes[target]) {
+            res &= targets[target]->BulkInsert(batches[target],
+                                               batch_sizes[target]) == 0;
+        }
+    }
+
+    return res;
+}
+
+double ConcurrentBinAwareChainedHT::AvgChainLength() {
+    double sum = 0;
+    for (uint64_t base_id = 0; base_id < kBaseTabSize; base_id++) {
+        uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+        if (*pre_tiny_ptr == 0) {
+            continue;
+        }
+        uint8_t* bin_begin =
+            byte_array +
+            base_bin(pre_tiny_ptr, *pre_tiny_ptr) * kBinByteLength;
+        while ((*pre_tiny_ptr & kInBinTinyPtrMask) != 0) {
+            sum++;
+            pre_tiny_ptr =
+                bin_entry(bin_begin, *pre_tiny_ptr) + kTinyPtrOffset;
+        }
+    }
+
+    return sum / kBaseTabSize;
+}
+
+uint32_t ConcurrentBinAwareChainedHT::MaxChainLength() {
+    uint32_t max = 0;
+    for (uint64_t base_id = 0; base_id < kBaseTabSize; base_id++) {
+        uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+        if (*pre_tiny_ptr == 0) {
+            continue;
+        }
+        uint8_t* bin_begin =
+            byte_array +
+            base_bin(pre_tiny_ptr, *pre_tiny_ptr) * kBinByteLength;
+        uint32_t cnt = 0;
+        while ((*pre_tiny_ptr & kInBinTinyPtrMask) != 0) {
+            cnt++;
+            pre_tiny_ptr =
+                bin_entry(bin_begin, *pre_tiny_ptr) + kTinyPtrOffset;
+        }
+        max = cnt > max ? cnt : max;
+    }
+
+    return max;
+}
+
+uint64_t ConcurrentBinAwareChainedHT::DoubleSlotCnt() {
+    uint64_t res = 0;
+    for (uint64_t base_id = 0; base_id < kBaseTabSize; base_id++) {
+        uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+        if (*pre_tiny_ptr == 0) {
+            continue;
+        }
+        uint64_t bin_id = base_bin(pre_tiny_ptr, *pre_tiny_ptr);
+        uint8_t* bin_begin = byte_array + bin_id * kBinByteLength;
+        while ((*pre_tiny_ptr & kInBinTinyPtrMask) != 0) {
+            uint8_t slot = (*pre_tiny_ptr & kInBinTinyPtrMask) - 1;
+            res += is_double_slot(bin_id, slot) && !(slot & 1);
+            pre_tiny_ptr =
+                bin_entry(bin_begin, *pre_tiny_ptr) + kTinyPtrOffset;
+        }
+    }
+
+    return res;
+}
+
+}  // namespace tinyptr
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "concurrent_byte_array_chained_ht.h"
+
+namespace tinyptr {
+
+// concurrent BinAwareChainedHT: every entry of a chain lives in the bin its
+// base pointer picked, so one bin prefetch covers the whole walk
+// the first kDoubleSlotSize slots of a bin are double slots, pairs of
+// adjacent slots; a chain growing out of a single slot moves into a pair,
+// and the second slot of a pair stays reserved for the chain while the
+// first is its tail, so the next append needs no slot from the bin
+// once the single slots run out, pairs are split into two singles, and
+// stay split, like BinAwareChainedHT's
+// chain pointers are 1-based slot indexes within the bin; bit 7 of the base
+// pointer picks the second hash's bin
+// all writers of a chain hold its version stripe, as moving a tail into a
+// pair relocates an entry; readers validate the version like the parent's
+class ConcurrentBinAwareChainedHT : public ConcurrentByteArrayChainedHT {
+   public:
+    const uint8_t kDoubleSlotSize;
+    const uint8_t kDoubleSlotNum;
+    const uint8_t kInBinTinyPtrMask = 0x7f;
+    const uint8_t kSecondHashMask = 0x80;
+
+   public:
+    // bin_size is at most 127, double_slot_num even and at most bin_size
+    ConcurrentBinAwareChainedHT(uint64_t size, bool if_resize = false,
+                                double resize_threshold = 1.0,
+                                utils::PagePool* pool = nullptr,
+                                uint16_t bin_size = 127,
+                                uint8_t double_slot_num = 126);
+
+    ~ConcurrentBinAwareChainedHT() = default;
+
+   protected:
+    __attribute__((always_inline)) inline uint8_t& bin_head_double_slot(
+        uint64_t bin_id) {
+        return head_double_slot[bin_id];
+    }
+
+    __attribute__((always_inline)) inline uint64_t base_bin(
+        uint8_t* base_tiny_ptr, uint8_t ptr) {
+        uint64_t key = reinterpret_cast<uint64_t>(base_tiny_ptr);
+        return (ptr & kSecondHashMask) ? hash_2_bin(key) : hash_1_bin(key);
+    }
+
+    __attribute__((always_inline)) inline uint8_t* bin_entry(uint8_t* bin_begin,
+                                                             uint8_t ptr) {
+        return bin_begin +
+               kEntryByteLength * ((ptr & kInBinTinyPtrMask) - 1);
+    }
+
+    // whether the slot is part of a pair that was not split; the bit of a
+    // pair held by a chain does not change under the chain's writer
+    __attribute__((always_inline)) inline bool is_double_slot(uint64_t bin_id,
+                                                              uint8_t slot) {
+        return slot < kDoubleSlotSize &&
+               !((split_double_slot[bin_id].load(std::memory_order_relaxed) >>
+                  (slot >> 1)) &
+                 1);
+    }
+
+    __attribute__((always_inline)) inline void lock_bin(uint64_t bin_id) {
+        while (bin_locks[bin_id].test_and_set(std::memory_order_acquire))
+            ;
+    }
+
+    __attribute__((always_inline)) inline void unlock_bin(uint64_t bin_id) {
+        bin_locks[bin_id].clear(std::memory_order_release);
+    }
+
+    // slot allocation, with the bin's lock held
+    // both lists keep the parent's lazy relative encoding, so untouched
+    // slots are free in order; the pops return kBinSize once empty
+    uint8_t pop_single_slot(uint64_t bin_id);
+    uint8_t pop_double_slot(uint64_t bin_id);
+    // a single slot, or else one half of a pair split for it
+    uint8_t pop_slot(uint64_t bin_id);
+    // hands a tail slot back; the second slot of a pair is not listed, it
+    // goes back with the first
+    void push_slot(uint64_t bin_id, uint8_t slot);
+
+    bool insert_in_chain(uint64_t base_id, uint64_t key, uint64_t value,
+                         uint32_t max_chain_length);
+
+   public:
+    bool Insert(uint64_t key, uint64_t value);
+    // see ConcurrentByteArrayChainedHT::BulkInsert
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
+    bool Query(uint64_t key, uint64_t* value_ptr);
+    bool Update(uint64_t key, uint64_t value);
+    void Free(uint64_t key);
+
+    bool ResizeMoveStride(uint64_t stride_id,
+                          ConcurrentBinAwareChainedHT* new_ht,
+                          ConcurrentBinAwareChainedHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
+
+    double AvgChainLength();
+    uint32_t MaxChainLength();
+    // pairs held by chains, over all bins
+    uint64_t DoubleSlotCnt();
+
+   private:
+    // walk the chains through the parent's addressing
+    using ConcurrentByteArrayChainedHT::ChainLengthHistogram;
+    using ConcurrentByteArrayChainedHT::FillChainLength;
+    using ConcurrentByteArrayChainedHT::MultiQuery;
+    using ConcurrentByteArrayChainedHT::QueryNoMem;
+    using ConcurrentByteArrayChainedHT::SetAdaptiveChains;
+
+   protected:
+    // per bin, the free list of pairs, threaded through their first slots;
+    // the single slots' list keeps the parent's bin_head and takes the
+    // halves of split pairs as well
+    std::unique_ptr<uint8_t[]> head_double_slot;
+    // per bin, a bit per pair, set once it is split
+    std::unique_ptr<std::atomic<uint64_t>[]> split_double_slot;
+};
+
+// the same-bin chaining of SameBinChainedHT: no double slots
+class ConcurrentSameBinChainedHT : public ConcurrentBinAwareChainedHT {
+   public:
+    ConcurrentSameBinChainedHT(uint64_t size, bool if_resize = false,
+                               double resize_threshold = 1.0,
+                               utils::PagePool* pool = nullptr,
+                               uint16_t bin_size = 127)
+        : ConcurrentBinAwareChainedHT(size, if_resize, resize_threshold, pool,
+                                      bin_size, 0) {}
+};
+
+}  // namespace tinyptr
@@ -1,9 +1,11 @@
 #include "concurrent_byte_array_chained_ht.h"
+#include "blast_ht.h"
 #include <emmintrin.h>
 #include <inttypes.h>
 #include <sys/cdefs.h>
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -24,7 +26,7 @@ uint8_t ConcurrentByteArrayChainedHT::AutoQuotTailLength(uint64_t size) {
 
 ConcurrentByteArrayChainedHT::ConcurrentByteArrayChainedHT(
     uint64_t size, uint8_t quotienting_tail_length, uint16_t bin_size,
-    bool if_resize, double resize_threshold)
+    bool if_resize, double resize_threshold, utils::PagePool* pool)
     : kHashSeed1(rand() & ((1 << 16) - 1)),
       kHashSeed2(65536 + rand()),
       kQuotientingTailLength(quotienting_tail_length
@@ -38,7 +40,8 @@ ConcurrentByteArrayChainedHT::ConcurrentByteArrayChainedHT(
       kValueOffset(kTinyPtrOffset + 1),
       kQuotKeyByteLength(kTinyPtrOffset),
       kEntryByteLength(kQuotKeyByteLength + 1 + 8),
-      kBinByteLength(kBinSize * kEntryByteLength) {
+      kBinByteLength(kBinSize * kEntryByteLength),
+      page_pool(pool) {
 
     // Determine the number of threads
     unsigned int num_threads = std::thread::hardware_concurrency();
@@ -62,6 +65,13 @@ ConcurrentByteArrayChainedHT::ConcurrentByteArrayChainedHT(
     for (size_t i = 0; i < base_tab_concurrent_version_size; ++i) {
         base_tab_concurrent_version[i].clear();
     }
+    base_tab_appender_cnt = std::make_unique<std::atomic<uint16_t>[]>(
+        base_tab_concurrent_version_size);
+    for (size_t i = 0; i < base_tab_concurrent_version_size; ++i) {
+        base_tab_appender_cnt[i].store(0, std::memory_order_relaxed);
+    }
+
+    max_chain_length = if_resize ? kResizeMaxChainLength : 0;
 
     uint64_t base_tab_size = kBaseTabSize;
     uint64_t byte_array_size = kBinNum * kBinSize * kEntryByteLength;
@@ -80,7 +90,9 @@ ConcurrentByteArrayChainedHT::ConcurrentByteArrayChainedHT(
         base_tab_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
     // Allocate a single aligned block
-    if (if_resize) {
+    if (page_pool) {
+        combined_mem = page_pool->Acquire(total_size);
+    } else if (if_resize) {
         combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
                             MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
     } else {
@@ -153,8 +165,10 @@ ConcurrentByteArrayChainedHT::ConcurrentByteArrayChainedHT(uint64_t size,
     : ConcurrentByteArrayChainedHT(size, 0, bin_size, if_resize, resize_threshold) {}
 
 ConcurrentByteArrayChainedHT::ConcurrentByteArrayChainedHT(uint64_t size,
-                                                           bool if_resize, double resize_threshold)
-    : ConcurrentByteArrayChainedHT(size, 0, 127, if_resize, resize_threshold) {}
+                                                           bool if_resize, double resize_threshold,
+                                                           utils::PagePool* pool)
+    : ConcurrentByteArrayChainedHT(size, 0, 127, if_resize, resize_threshold,
+                                   pool) {}
 
 ConcurrentByteArrayChainedHT::~ConcurrentByteArrayChainedHT() {
     if (play_entry) {
@@ -178,7 +192,11 @@ ConcurrentByteArrayChainedHT::~ConcurrentByteArrayChainedHT() {
     uint64_t total_size =
         base_tab_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
-    munmap(combined_mem, total_size);
+    if (page_pool) {
+        page_pool->Release(combined_mem, total_size);
+    } else {
+        munmap(combined_mem, total_size);
+    }
 }
 
 uint64_t ConcurrentByteArrayChainedHT::limited_base_id(uint64_t key) {
@@ -238,44 +256,132 @@ void ConcurrentByteArrayChainedHT::evict_entry_cache_line(uint8_t* entry) {
 }
 
 bool ConcurrentByteArrayChainedHT::Insert(uint64_t key, uint64_t value) {
+    return insert_in_chain(hash_1_base_id(key), key, value, max_chain_length);
+}
+
+uint32_t ConcurrentByteArrayChainedHT::BulkInsert(
+    std::pair<uint64_t, uint64_t>* entries, uint32_t entry_num) {
+    uint64_t base_ids[kBulkInsertBatchSize];
+    uint32_t failed_num = 0;
+
+    for (uint32_t batch_start = 0; batch_start < entry_num;
+         batch_start += kBulkInsertBatchSize) {
+        std::pair<uint64_t, uint64_t>* batch = entries + batch_start;
+        uint32_t batch_size =
+            std::min<uint32_t>(kBulkInsertBatchSize, entry_num - batch_start);
+
+        // hash the whole batch up front so the base slot fetches overlap
+        for (uint32_t i = 0; i < batch_size; i++) {
+            base_ids[i] = hash_1_base_id(batch[i].first);
+            _mm_prefetch(&base_tab_ptr(base_ids[i]), _MM_HINT_T0);
+        }
+
+        for (uint32_t i = 0; i < batch_size; i++) {
+            if (!insert_in_chain(base_ids[i], batch[i].first,
+                                 batch[i].second, 0)) {
+                entries[failed_num++] = batch[i];
+            }
+        }
+    }
+
+    return failed_num;
+}
+
+bool ConcurrentByteArrayChainedHT::insert_in_chain(uint64_t base_id,
+                                                   uint64_t key,
+                                                   uint64_t value,
+                                                   uint32_t max_chain_length) {
+    std::atomic<uint8_t>& concurrent_version = version_of(base_id);
+    std::atomic<uint16_t>& appender_cnt = appenders_of(base_id);
+
+    // pairs with the version CAS of an erase: either it sees us or we see it
+    while (true) {
+        appender_cnt.fetch_add(1);
+        if (!(concurrent_version.load() & 1)) {
+            break;
+        }
+        appender_cnt.fetch_sub(1);
+        while (concurrent_version.load() & 1) {
+            _mm_pause();
+        }
+    }
 
-    uint64_t base_id = hash_1_base_id(key);
     uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
 
-    std::atomic<uint8_t>& concurrent_version =
-        *reinterpret_cast<std::atomic<uint8_t>*>(
-            &base_tab_concurrent_version[base_id_to_version_id(base_id)]);
+    // the slot is picked by the address of the tail pointer, so a claim is
+    // only good for the tail it was made for
+    uint8_t* entry = nullptr;
+    uint8_t new_tiny_ptr = 0;
+    uint8_t* claimed_for = nullptr;
+    uint32_t chain_length = 0;
+
+    while (true) {
+        uint8_t tiny_ptr =
+            tiny_ptr_ref(pre_tiny_ptr).load(std::memory_order_acquire);
+
+        if (tiny_ptr != 0) {
+            pre_tiny_ptr = ptab_query_entry_address(
+                               reinterpret_cast<uint64_t>(pre_tiny_ptr),
+                               tiny_ptr) +
+                           kTinyPtrOffset;
+            chain_length++;
+            continue;
+        }
 
-    uint8_t expected_version;
-    do {
-        expected_version = concurrent_version.load();
-    } while ((expected_version & 1) ||
-             !concurrent_version.compare_exchange_weak(expected_version,
-                                                       expected_version + 1));
+        if (max_chain_length && chain_length >= max_chain_length) {
+            if (entry) {
+                release_slot(entry, new_tiny_ptr);
+            }
+            appender_cnt.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
 
-    while (*pre_tiny_ptr != 0) {
-        uint8_t* entry = ptab_query_entry_address(
-            reinterpret_cast<uint64_t>(pre_tiny_ptr), *pre_tiny_ptr);
-        pre_tiny_ptr = entry + kTinyPtrOffset;
+        if (claimed_for != pre_tiny_ptr) {
+            if (entry) {
+                release_slot(entry, new_tiny_ptr);
+            }
+            entry = ptab_insert_entry_address(
+                reinterpret_cast<uint64_t>(pre_tiny_ptr));
+            if (entry == nullptr) {
+                appender_cnt.fetch_sub(1, std::memory_order_release);
+                return false;
+            }
+            new_tiny_ptr = *entry;
+            claimed_for = pre_tiny_ptr;
+
+            // assuming little endian
+            *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
+            entry[kTinyPtrOffset] = 0;
+            *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+        }
+
+        // on failure another append got there first, walk on past it
+        if (tiny_ptr_ref(pre_tiny_ptr)
+                .compare_exchange_strong(tiny_ptr, new_tiny_ptr,
+                                         std::memory_order_release)) {
+            appender_cnt.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
     }
+}
 
-    uint8_t* entry =
-        ptab_insert_entry_address(reinterpret_cast<uint64_t>(pre_tiny_ptr));
+void ConcurrentByteArrayChainedHT::release_slot(uint8_t* entry,
+                                                uint8_t tiny_ptr) {
+    uint64_t bin_id = (entry - byte_array) / kBinByteLength;
 
-    if (entry != nullptr) {
-        *pre_tiny_ptr = *entry;
-        // assuming little endian
-        *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
-        entry[kTinyPtrOffset] = 0;
-        *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
-        // Release the lock
-        concurrent_version.fetch_add(1);
-        return true;
-    } else {
-        // Release the lock
-        concurrent_version.fetch_add(1);
-        return false;
+    while (bin_locks[bin_id].test_and_set(std::memory_order_acquire))
+        ;
+
+    bin_cnt(bin_id)--;
+    uint8_t& head = bin_head(bin_id);
+    uint8_t cur_in_bin_pos = ((uint8_t)(tiny_ptr << 1) >> 1) - 1;
+    entry[kTinyPtrOffset] = head + kBinSize - cur_in_bin_pos;
+    if (entry[kTinyPtrOffset] > kBinSize) {
+        entry[kTinyPtrOffset] -= (kBinSize + 1);
     }
+    head = cur_in_bin_pos;
+
+    bin_locks[bin_id].clear(std::memory_order_release);
 }
 
 bool ConcurrentByteArrayChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
@@ -321,7 +427,7 @@ bool ConcurrentByteArrayChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
 #else
     uint64_t base_id = hash_1_base_id(key);
 
-    uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
+    uint8_t* pre_tiny_ptr;
 
     std::atomic<uint8_t>& concurrent_version =
         *reinterpret_cast<std::atomic<uint8_t>*>(
@@ -329,6 +435,8 @@ bool ConcurrentByteArrayChainedHT::Query(uint64_t key, uint64_t* value_ptr) {
 
 query_again:
 
+    pre_tiny_ptr = &base_tab_ptr(base_id);
+
     uint8_t expected_version;
     do {
         expected_version = concurrent_version.load();
@@ -338,6 +446,8 @@ query_again:
     key >>= kQuotientingTailLength;
     key <<= kQuotientingTailLength;
 
+    uint8_t* pre_entry = nullptr;
+
     while (*pre_tiny_ptr != 0) {
 
         // query_entry_cnt++;
@@ -351,9 +461,18 @@ query_again:
             if (concurrent_version.load() != expected_version) {
                 goto query_again;
             }
+            // a writer since the walk fails the CAS, and so does one busy
+            // on the chain; either way the promotion is just dropped
+            if (adaptive_chains && pre_entry && sample_promotion() &&
+                concurrent_version.compare_exchange_strong(
+                    expected_version, expected_version + 1)) {
+                swap_payload(pre_entry, entry);
+                concurrent_version.fetch_add(1);
+            }
             return true;
         }
         // evict_entry_cache_line(entry);
+        pre_entry = entry;
         pre_tiny_ptr = entry + kTinyPtrOffset;
     }
 
@@ -382,6 +501,104 @@ query_again:
 #endif
 }
 
+uint32_t ConcurrentByteArrayChainedHT::MultiQuery(const uint64_t* keys,
+                                                  uint32_t key_num,
+                                                  uint64_t* values,
+                                                  bool* found) {
+    // one chain walk in flight; entry is the hop prefetched on its last turn,
+    // or null while the base slot and the version are still on their way
+    struct ChainWalk {
+        uint32_t key_id;
+        uint64_t quot_key;
+        uint8_t* base_ptr;
+        uint8_t* pre_tiny_ptr;
+        uint8_t* entry;
+        std::atomic<uint8_t>* version;
+        uint8_t expected_version;
+    };
+
+    ChainWalk walks[kMultiQueryWidth];
+    uint32_t walk_num = 0;
+    uint32_t next_key = 0;
+    uint32_t found_num = 0;
+
+    auto start_walk = [&](ChainWalk& walk) {
+        uint64_t key = keys[next_key];
+        uint64_t base_id = hash_1_base_id(key);
+        walk.key_id = next_key++;
+        walk.quot_key = key >> kQuotientingTailLength << kQuotientingTailLength;
+        walk.base_ptr = &base_tab_ptr(base_id);
+        walk.pre_tiny_ptr = walk.base_ptr;
+        walk.entry = nullptr;
+        walk.version = reinterpret_cast<std::atomic<uint8_t>*>(
+            &base_tab_concurrent_version[base_id_to_version_id(base_id)]);
+        __builtin_prefetch(walk.base_ptr, 0, 3);
+        __builtin_prefetch(walk.version, 0, 3);
+    };
+
+    // a writer got in the way; walk the chain again from the base
+    auto restart = [](ChainWalk& walk) {
+        walk.pre_tiny_ptr = walk.base_ptr;
+        walk.entry = nullptr;
+    };
+
+    // one hop; true once the walk is over
+    auto step = [&](ChainWalk& walk) {
+        if (walk.entry) {
+            if ((*reinterpret_cast<uint64_t*>(walk.entry)
+                 << kQuotientingTailLength) == walk.quot_key) {
+                values[walk.key_id] =
+                    *reinterpret_cast<uint64_t*>(walk.entry + kValueOffset);
+                if (walk.version->load() != walk.expected_version) {
+                    restart(walk);
+                    return false;
+                }
+                found[walk.key_id] = true;
+                found_num++;
+                return true;
+            }
+            walk.pre_tiny_ptr = walk.entry + kTinyPtrOffset;
+        } else {
+            walk.expected_version = walk.version->load();
+            if (walk.expected_version & 1) {
+                return false;
+            }
+        }
+
+        if (*walk.pre_tiny_ptr == 0) {
+            if (walk.version->load() != walk.expected_version) {
+                restart(walk);
+                return false;
+            }
+            found[walk.key_id] = false;
+            return true;
+        }
+
+        walk.entry = ptab_query_entry_address(
+            reinterpret_cast<uint64_t>(walk.pre_tiny_ptr), *walk.pre_tiny_ptr);
+        __builtin_prefetch(walk.entry, 0, 3);
+        return false;
+    };
+
+    while (walk_num < kMultiQueryWidth && next_key < key_num) {
+        start_walk(walks[walk_num++]);
+    }
+
+    while (walk_num) {
+        for (uint32_t i = 0; i < walk_num;) {
+            if (!step(walks[i])) {
+                i++;
+            } else if (next_key < key_num) {
+                start_walk(walks[i++]);
+            } else {
+                walks[i] = walks[--walk_num];
+            }
+        }
+    }
+
+    return found_num;
+}
+
 void ConcurrentByteArrayChainedHT::set_chain_length(uint64_t chain_length) {
     this->chain_length = chain_length;
 }
@@ -459,6 +676,13 @@ void ConcurrentByteArrayChainedHT::Free(uint64_t key) {
              !concurrent_version.compare_exchange_weak(expected_version,
                                                        expected_version + 1));
 
+    // appends that started before we took the version may still link to
+    // the tail we are about to free
+    std::atomic<uint16_t>& appender_cnt = appenders_of(base_id);
+    while (appender_cnt.load(std::memory_order_acquire) != 0) {
+        _mm_pause();
+    }
+
     // quotienting
     key >>= kQuotientingTailLength;
 
@@ -501,15 +725,8 @@ void ConcurrentByteArrayChainedHT::Free(uint64_t key) {
     memcpy(aiming_entry, cur_entry, kEntryByteLength);
     aiming_entry[kTinyPtrOffset] = tmp;
 
-    uint64_t bin_id = (cur_entry - byte_array) / kBinByteLength;
-    bin_cnt(bin_id)--;
-    uint8_t& head = bin_head(bin_id);
-    uint8_t cur_in_bin_pos = ((uint8_t)((*pre_tiny_ptr) << 1) >> 1) - 1;
-    cur_entry[kTinyPtrOffset] = head + kBinSize - cur_in_bin_pos;
-    if (cur_entry[kTinyPtrOffset] > kBinSize) {
-        cur_entry[kTinyPtrOffset] -= (kBinSize + 1);
-    }
-    head = cur_in_bin_pos;
+    // the bin is shared with other chains, whose appends keep claiming slots
+    release_slot(cur_entry, *pre_tiny_ptr);
     *pre_tiny_ptr = 0;
     concurrent_version.fetch_add(1);
 }
@@ -588,18 +805,39 @@ uint64_t ConcurrentByteArrayChainedHT::QueryEntryCnt() {
     return query_entry_cnt;
 }
 
+void ConcurrentByteArrayChainedHT::SetAdaptiveChains(bool adaptive) {
+    adaptive_chains = adaptive;
+}
+
+void ConcurrentByteArrayChainedHT::SetMaxChainLength(
+    uint32_t max_chain_length) {
+    this->max_chain_length = max_chain_length;
+}
+
 void ConcurrentByteArrayChainedHT::SetResizeStride(uint64_t stride_num) {
     resize_stride_size = ceil(1.0 * kBaseTabSize / (stride_num));
 }
 
-bool ConcurrentByteArrayChainedHT::ResizeMoveStride(
-    uint64_t stride_id, ConcurrentByteArrayChainedHT* new_ht) {
+template <typename TargetHT>
+bool ConcurrentByteArrayChainedHT::ResizeMoveStride(uint64_t stride_id,
+                                                    TargetHT* new_ht,
+                                                    TargetHT* split_ht,
+                                                    PartitionRouter router,
+                                                    uint64_t split_bit) {
 
     uint64_t start_base_id = stride_id * resize_stride_size;
     uint64_t end_base_id = start_base_id + resize_stride_size;
     if (end_base_id > kBaseTabSize) {
         end_base_id = kBaseTabSize;
     }
+
+    // entries are collected per destination and handed over a batch at a
+    // time, so the destination can overlap their lookups
+    std::pair<uint64_t, uint64_t> batches[2][kBulkInsertBatchSize];
+    uint32_t batch_sizes[2] = {0, 0};
+    TargetHT* targets[2] = {new_ht, split_ht};
+    bool res = true;
+
     for (uint64_t base_id = start_base_id; base_id < end_base_id; base_id++) {
 
         uint8_t* pre_tiny_ptr = &base_tab_ptr(base_id);
@@ -608,17 +846,38 @@ bool ConcurrentByteArrayChainedHT::ResizeMoveStride(
             uint8_t* entry = ptab_query_entry_address(
                 reinterpret_cast<uint64_t>(pre_tiny_ptr), *pre_tiny_ptr);
 
-            if (!new_ht->Insert(
-                    hash_key_rebuild(*reinterpret_cast<uint64_t*>(entry),
-                                     base_id),
-                    *reinterpret_cast<uint64_t*>(entry + kValueOffset))) {
-                return false;
+            uint64_t ins_key = hash_key_rebuild(
+                *reinterpret_cast<uint64_t*>(entry), base_id);
+
+            // a splitting resize sends the entries routed to the new
+            // partition to split_ht
+            uint8_t target = split_ht && (router.Route(ins_key) & split_bit);
+            batches[target][batch_sizes[target]++] = std::make_pair(
+                ins_key, *reinterpret_cast<uint64_t*>(entry + kValueOffset));
+            if (batch_sizes[target] == kBulkInsertBatchSize) {
+                res &= targets[target]->BulkInsert(
+                           batches[target], batch_sizes[target]) == 0;
+                batch_sizes[target] = 0;
             }
 
             pre_tiny_ptr = entry + kTinyPtrOffset;
         }
     }
-    return true;
+
+    for (uint8_t target = 0; target < 2; target++) {
+        if (batch_sizes[target]) {
+            res &= targets[target]->BulkInsert(batches[target],
+                                               batch_sizes[target]) == 0;
+        }
+    }
+
+    return res;
 }
 
+template bool ConcurrentByteArrayChainedHT::ResizeMoveStride(
+    uint64_t, ConcurrentByteArrayChainedHT*, ConcurrentByteArrayChainedHT*,
+    PartitionRouter, uint64_t);
+template bool ConcurrentByteArrayChainedHT::ResizeMoveStride(
+    uint64_t, BlastHT*, BlastHT*, PartitionRouter, uint64_t);
+
 }  // namespace tinyptr
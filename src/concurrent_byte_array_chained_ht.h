@@ -7,9 +7,13 @@
 #include <sys/types.h>
 #include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
  
 #include "common.h"
 #include "utils/cache_line_size.h"
+#include "utils/page_pool.h"
 
 namespace tinyptr {
 
@@ -38,11 +42,14 @@ class ConcurrentByteArrayChainedHT {
     uint8_t AutoQuotTailLength(uint64_t size);
 
    public:
+    // with a pool, the table memory is taken from and returned to it
     ConcurrentByteArrayChainedHT(uint64_t size, uint8_t quotienting_tail_length,
-                                 uint16_t bin_size, bool if_resize = false, double resize_threshold = 1.0);
+                                 uint16_t bin_size, bool if_resize = false, double resize_threshold = 1.0,
+                                 utils::PagePool* pool = nullptr);
     ConcurrentByteArrayChainedHT(uint64_t size, uint16_t bin_size,
                                  bool if_resize = false, double resize_threshold = 1.0);
-    ConcurrentByteArrayChainedHT(uint64_t size, bool if_resize = false, double resize_threshold = 1.0);
+    ConcurrentByteArrayChainedHT(uint64_t size, bool if_resize = false, double resize_threshold = 1.0,
+                                 utils::PagePool* pool = nullptr);
 
     ~ConcurrentByteArrayChainedHT();
 
@@ -52,7 +59,8 @@ class ConcurrentByteArrayChainedHT {
     }
 
     __attribute__((always_inline)) inline uint64_t hash_1_bin(uint64_t key) {
-        return (HASH_FUNCTION(&key, sizeof(uint64_t), kHashSeed1)) % kBinNum;
+        return FastRange(HASH_FUNCTION(&key, sizeof(uint64_t), kHashSeed1),
+                         kBinNum);
         // return 0;
     }
 
@@ -77,7 +85,8 @@ class ConcurrentByteArrayChainedHT {
     }
 
     __attribute__((always_inline)) inline uint64_t hash_2_bin(uint64_t key) {
-        return (HASH_FUNCTION(&key, sizeof(uint64_t), kHashSeed2)) % kBinNum;
+        return FastRange(HASH_FUNCTION(&key, sizeof(uint64_t), kHashSeed2),
+                         kBinNum);
         // return 0;
     }
 
@@ -188,24 +197,127 @@ class ConcurrentByteArrayChainedHT {
         return base_id % base_tab_concurrent_version_size;
     }
 
+    __attribute__((always_inline)) inline std::atomic<uint8_t>& version_of(
+        uint64_t base_id) {
+        return *reinterpret_cast<std::atomic<uint8_t>*>(
+            &base_tab_concurrent_version[base_id_to_version_id(base_id)]);
+    }
+
+    __attribute__((always_inline)) inline std::atomic<uint16_t>& appenders_of(
+        uint64_t base_id) {
+        return base_tab_appender_cnt[base_id_to_version_id(base_id)];
+    }
+
+    __attribute__((always_inline)) inline std::atomic<uint8_t>& tiny_ptr_ref(
+        uint8_t* tiny_ptr) {
+        return *reinterpret_cast<std::atomic<uint8_t>*>(tiny_ptr);
+    }
+
    protected:
     void random_base_entry_prefetch();
     uint8_t* non_temporal_load_single_entry(uint8_t* entry);
     void evict_entry_cache_line(uint8_t* entry);
 
    protected:
+    utils::PagePool* page_pool;
     void* combined_mem;
     uint64_t limited_base_id(uint64_t key);
 
+    static constexpr uint32_t kBulkInsertBatchSize = 64;
+    static constexpr uint32_t kMultiQueryWidth = 16;
+    // one in 2^kPromoteSampleShift hits past the chain head of a thread is
+    // promoted
+    static constexpr uint32_t kPromoteSampleShift = 4;
+    static constexpr uint32_t kPromoteSampleMask =
+        (1 << kPromoteSampleShift) - 1;
+
+    // swaps the keys and values of two entries; the tiny pointers stay put,
+    // as every slot is placed by the address of the pointer linking to it,
+    // and appends may be linking through them meanwhile
+    __attribute__((always_inline)) inline void swap_payload(uint8_t* entry,
+                                                            uint8_t* other) {
+        uint8_t tmp[8];
+        memcpy(tmp, entry, kQuotKeyByteLength);
+        memcpy(entry, other, kQuotKeyByteLength);
+        memcpy(other, tmp, kQuotKeyByteLength);
+        memcpy(tmp, entry + kValueOffset, 8);
+        memcpy(entry + kValueOffset, other + kValueOffset, 8);
+        memcpy(other + kValueOffset, tmp, 8);
+    }
+
+    __attribute__((always_inline)) inline bool sample_promotion() {
+        static thread_local uint32_t promote_tick = 0;
+        return (++promote_tick & kPromoteSampleMask) == 0;
+    }
+
+    // appends to the chain starting at base_id's slot without taking its
+    // version: the entry is written into a claimed slot and linked with a
+    // single-byte CAS on the tail pointer, so readers see all of it or
+    // nothing and the version stays put
+    // this is reduced locking, not lock-free: claiming the slot still takes
+    // the short spin lock of its bin, whose 2-byte count/head header leaves
+    // no room for an ABA tag, and every append bumps the appender count that
+    // all chains on its version stripe share
+    // erases move the tail entry and free its slot, which a pending CAS could
+    // then hit; so appenders announce themselves on the version stripe and
+    // step aside while it is odd, and an erase waits for the announced ones
+    // to finish after taking the version
+    // fails once the chain holds max_chain_length entries, 0 means no cap;
+    // the CAS links at exactly the depth counted, so the cap holds under
+    // racing appends as well
+    bool insert_in_chain(uint64_t base_id, uint64_t key, uint64_t value,
+                         uint32_t max_chain_length);
+    // hands a slot taken by ptab_insert_entry_address back to its bin
+    void release_slot(uint8_t* entry, uint8_t tiny_ptr);
+
+    // chains of tables built for resizing are capped at this, so a long
+    // chain makes ResizableHT split the partition instead of slowing down
+    // every lookup that lands on it
+    static constexpr uint32_t kResizeMaxChainLength = 16;
+
    public:
     bool Insert(uint64_t key, uint64_t value);
+    // hashes and prefetches a whole batch before inserting it; used by resize
+    // migration and buffered inserts, which have a batch of entries at hand
+    // returns how many entries did not fit; those are moved to the front of
+    // entries, in order
+    // the chain cap is not applied: migrated entries are already in the
+    // table and must not be refused, and a chain a buffered flush pushes past
+    // the cap makes the next Insert on it fail and resize
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
     bool Query(uint64_t key, uint64_t* value_ptr);
+    // looks up key_num keys at once: up to kMultiQueryWidth chain walks take
+    // turns, each prefetching its next hop before yielding, so the misses of
+    // different chains overlap instead of queueing up behind each other
+    // found[i] tells whether keys[i] is there, values[i] then holds its
+    // value; returns how many were found
+    // each walk validates its chain's version like Query does
+    uint32_t MultiQuery(const uint64_t* keys, uint32_t key_num,
+                        uint64_t* values, bool* found);
     bool Update(uint64_t key, uint64_t value);
     void Free(uint64_t key);
 
+    // with adaptive chains, a sample of the hits past the chain head swap the
+    // entry found with the one before it, so the keys hit most drift to the
+    // front under skewed traffic; the swap takes the chain's version only if
+    // it is free and unchanged since the walk, and is skipped otherwise
+    // off by default, as it turns reads into writes; not for tables being
+    // resized either, since ResizeMoveStride walks the chains unlocked
+    void SetAdaptiveChains(bool adaptive);
+    // caps every chain at max_chain_length entries, so no lookup walks
+    // further; an insert that would go past it fails instead, which under
+    // ResizableHT triggers a resize; 0 leaves chains unbounded, the default
+    // for tables not built for resizing
+    void SetMaxChainLength(uint32_t max_chain_length);
+
     void SetResizeStride(uint64_t stride_num);
-    bool ResizeMoveStride(uint64_t stride_id,
-                          ConcurrentByteArrayChainedHT* new_ht);
+    // the destination may be a ConcurrentByteArrayChainedHT or a BlastHT, so
+    // a resize can change a partition's representation
+    template <typename TargetHT>
+    bool ResizeMoveStride(uint64_t stride_id, TargetHT* new_ht,
+                          TargetHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
 
     // Experimental Utility Functions
    public:
@@ -222,6 +334,10 @@ class ConcurrentByteArrayChainedHT {
 
     std::unique_ptr<std::atomic_flag[]> bin_locks;
     std::unique_ptr<std::atomic_flag[]> base_tab_concurrent_version;
+    std::unique_ptr<std::atomic<uint16_t>[]> base_tab_appender_cnt;
+
+    bool adaptive_chains = false;
+    uint32_t max_chain_length;
 
     size_t bin_locks_size;
     size_t base_tab_concurrent_version_size;
@@ -13,9 +13,16 @@
 
 namespace tinyptr {
 
-uint8_t ConcurrentSkulkerHT::kBushLookup[256];
-struct ConcurrentSkulkerHTBushLookupInitializer
-    concurrent_skulker_ht_bush_lookup_initializer;
+#ifdef TINYPTR_CONCURRENT_SKULKER_QUERY_ENTRY_CNT
+static thread_local uint64_t query_entry_cnt = 0;
+
+uint64_t ConcurrentSkulkerHT::QueryEntryCnt() {
+    return query_entry_cnt;
+}
+#define COUNT_QUERY_ENTRY() (query_entry_cnt++)
+#else
+#define COUNT_QUERY_ENTRY()
+#endif
 
 // #define USE_CONCURRENT_VERSION_QUERY
 
@@ -72,7 +79,9 @@ uint8_t ConcurrentSkulkerHT::AutoLockNum(uint64_t thread_num_supported) {
 
 ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size,
                                          uint8_t quotienting_tail_length,
-                                         uint16_t bin_size, bool if_resize, double resize_threshold)
+                                         uint16_t bin_size, bool if_resize, double resize_threshold,
+                                         utils::PagePool* pool,
+                                         bool if_fingerprint)
     : kHashSeed1(rand() & ((1 << 16) - 1)),
       kHashSeed2(65536 + rand()),
       kQuotientingTailLength(quotienting_tail_length
@@ -87,16 +96,20 @@ ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size,
       kBushOverflowBound(0.21),
       kSkulkerRatio((1 - kBushRatio * (1ULL << kQuotientingTailLength) / size) +
                     kBushOverflowBound),
-      kInitExhibitorNum(kBushByteLength / kEntryByteLength),
-      kInitSkulkerNum(kBushByteLength - kInitExhibitorNum * kEntryByteLength -
-                      kControlByteLength - kConcurrentVersionByteLength),
+      kInitExhibitorNum(kFingerprintOffset / kEntryByteLength),
+      kInitSkulkerNum(kFingerprintOffset -
+                      kInitExhibitorNum * kEntryByteLength),
       kBushCapacity(std::min(
-          16, static_cast<int>(floor(kInitExhibitorNum / kBushRatio)))),
+          kFingerprintByteLength ? static_cast<int>(kFingerprintByteLength)
+                                 : 16,
+          static_cast<int>(floor(kInitExhibitorNum / kBushRatio)))),
       kBushNum(((1ULL << kQuotientingTailLength) + kBushCapacity - 1) /
                kBushCapacity),
       kConcurrentVersionOffset(kBushByteLength - kConcurrentVersionByteLength),
       kControlOffset(kConcurrentVersionOffset - kControlByteLength),
-      kSkulkerOffset(kControlOffset - 1),
+      kFingerprintByteLength(if_fingerprint ? kFingerprintLaneByteLength : 0),
+      kFingerprintOffset(kControlOffset - kFingerprintByteLength),
+      kSkulkerOffset(kFingerprintOffset - 1),
       kBinSize(bin_size),
       kBinNum(if_resize ? 
               static_cast<uint64_t>(std::ceil((size * kSkulkerRatio + kBinSize - 1) / kBinSize * resize_threshold)) :
@@ -114,7 +127,8 @@ ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size,
                                AutoFastDivisionInnerShift(kBinNum))},
       kFastDivisionReciprocal{
           (1ULL << kFastDivisionShift[0]) / kBushCapacity + 1,
-          (1ULL << kFastDivisionShift[1]) / kBinNum + 1} {
+          (1ULL << kFastDivisionShift[1]) / kBinNum + 1},
+      page_pool(pool) {
 
     assert(4 * size >= (1ULL << (kQuotientingTailLength)));
     assert(bin_size < 128);
@@ -167,7 +181,7 @@ ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size,
         bush_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
     // Allocate a single aligned block
-    void* combined_mem;
+    combined_size = total_size;
     // if (posix_memalign(&combined_mem, 64, total_size) != 0) {
     //     // Handle allocation failure
     //     abort();
@@ -175,7 +189,9 @@ ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size,
 
     // auto start = std::chrono::high_resolution_clock::now();
 
-    if (if_resize) {
+    if (page_pool) {
+        combined_mem = page_pool->Acquire(total_size);
+    } else if (if_resize) {
         combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
                             MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
     } else {
@@ -270,16 +286,23 @@ ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size,
 }
 
 ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size, uint16_t bin_size,
-                                         bool if_resize, double resize_threshold)
-    : ConcurrentSkulkerHT(size, 0, bin_size, if_resize, resize_threshold) {}
+                                         bool if_resize,
+                                         double resize_threshold,
+                                         bool if_fingerprint)
+    : ConcurrentSkulkerHT(size, 0, bin_size, if_resize, resize_threshold,
+                          nullptr, if_fingerprint) {}
 
-ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size, bool if_resize, double resize_threshold)
-    : ConcurrentSkulkerHT(size, 0, 127, if_resize, resize_threshold) {}
+ConcurrentSkulkerHT::ConcurrentSkulkerHT(uint64_t size, bool if_resize, double resize_threshold,
+                                         utils::PagePool* pool)
+    : ConcurrentSkulkerHT(size, 0, 127, if_resize, resize_threshold, pool) {}
 
 ConcurrentSkulkerHT::~ConcurrentSkulkerHT() {
-    munmap(bush_tab, kBushNum * kBushByteLength);
-    munmap(byte_array, kBinNum * kBinSize * kEntryByteLength);
-    munmap(bin_cnt_head, kBinNum << 1);
+    // the sections share one mapping, so it goes back as a whole
+    if (page_pool) {
+        page_pool->Release(combined_mem, combined_size);
+    } else {
+        munmap(combined_mem, combined_size);
+    }
 }
 
 bool ConcurrentSkulkerHT::Insert(uint64_t key, uint64_t value) {
@@ -319,15 +342,9 @@ bool ConcurrentSkulkerHT::Insert(uint64_t key, uint64_t value) {
         *reinterpret_cast<uint16_t*>(bush + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     if ((control_info >> in_bush_offset) & 1) {
 
@@ -342,6 +359,9 @@ bool ConcurrentSkulkerHT::Insert(uint64_t key, uint64_t value) {
         uintptr_t pre_deref_key = base_id;
 
         bool result = ptab_insert(pre_tiny_ptr, pre_deref_key, key, value);
+        if (result) {
+            fingerprint_add(bush, in_bush_offset, key);
+        }
 
         // Release the lock
         concurrent_version.fetch_add(1);
@@ -448,12 +468,24 @@ bool ConcurrentSkulkerHT::Insert(uint64_t key, uint64_t value) {
             *(uint64_t*)(new_entry + kValueOffset) = value;
         }
 
+        fingerprint_add(bush, in_bush_offset, key);
         control_info |= (1u << in_bush_offset);
         concurrent_version.fetch_add(1);
         return true;
     }
 }
 
+uint32_t ConcurrentSkulkerHT::BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                                         uint32_t entry_num) {
+    uint32_t failed_num = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        if (!Insert(entries[i].first, entries[i].second)) {
+            entries[failed_num++] = entries[i];
+        }
+    }
+    return failed_num;
+}
+
 bool ConcurrentSkulkerHT::Query(uint64_t key, uint64_t* value_ptr) {
 #ifdef USE_LOCK_BASED_VERSION_QUERY
     uint64_t base_id = hash_base_id(key);
@@ -486,18 +518,17 @@ bool ConcurrentSkulkerHT::Query(uint64_t key, uint64_t* value_ptr) {
 
     uint16_t& control_info = *reinterpret_cast<uint16_t*>(
         bush_tab + (bush_id << kBushIdShiftOffset) + kControlOffset);
-    uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-                       kBushLookup[(control_info >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
     uint16_t control_info_before_item = control_info >> in_bush_offset;
     uint8_t before_item_cnt =
-        kBushLookup[control_info_before_item & kByteMask] +
-        kBushLookup[(control_info_before_item >> kByteShift)];
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
     uint8_t exhibitor_num = kInitExhibitorNum - overload_flag;
 
-    if ((control_info >> in_bush_offset) & 1) {
+    if (((control_info >> in_bush_offset) & 1) &&
+        fingerprint_may_hold(bush, in_bush_offset, key)) {
 
         key = key & (~kQuotientingTailMask);
 
@@ -526,6 +557,7 @@ bool ConcurrentSkulkerHT::Query(uint64_t key, uint64_t* value_ptr) {
 
             uint8_t* entry =
                 ptab_query_entry_address(pre_deref_key, *pre_tiny_ptr);
+            COUNT_QUERY_ENTRY();
             if ((*reinterpret_cast<uint64_t*>(entry + kKeyOffset)
                  << kQuotientingTailLength) == key) {
                 *value_ptr = *reinterpret_cast<uint64_t*>(entry + kValueOffset);
@@ -578,14 +610,9 @@ query_again:
         *reinterpret_cast<uint16_t*>(bush + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -596,7 +623,10 @@ query_again:
 
     static uint64_t hit_num = 0;
 
-    if (control_info_before_item & 1) {
+    // the fingerprint sits in the bush, so ruling a missing key out costs no
+    // read beyond the bush itself
+    if ((control_info_before_item & 1) &&
+        fingerprint_may_hold(bush, in_bush_offset, key)) {
 
         key = key & (~kQuotientingTailMask);
 
@@ -644,6 +674,7 @@ query_again:
             // 5-10 ns
             uint8_t* entry =
                 ptab_query_entry_address(pre_deref_key, *pre_tiny_ptr);
+            COUNT_QUERY_ENTRY();
 
             uint64_t entry_key =
                 (*reinterpret_cast<uint64_t*>(entry + kKeyOffset)
@@ -714,14 +745,9 @@ bool ConcurrentSkulkerHT::Update(uint64_t key, uint64_t value) {
         *reinterpret_cast<uint16_t*>(bush + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -799,14 +825,9 @@ void ConcurrentSkulkerHT::Free(uint64_t key) {
         *reinterpret_cast<uint16_t*>(bush + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -847,6 +868,7 @@ void ConcurrentSkulkerHT::Free(uint64_t key) {
                     // }
 
                     control_info &= ~(1u << in_bush_offset);
+                    fingerprint_clear(bush, in_bush_offset);
                     item_cnt--;
                     before_item_cnt--;
 
@@ -888,6 +910,7 @@ void ConcurrentSkulkerHT::Free(uint64_t key) {
 
         if (*pre_tiny_ptr == 0 && before_item_cnt > exhibitor_num) {
             control_info &= ~(1u << in_bush_offset);
+            fingerprint_clear(bush, in_bush_offset);
             item_cnt--;
             before_item_cnt--;
 
@@ -930,8 +953,7 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
         uint8_t* bush = &bush_tab[(bush_id << kBushIdShiftOffset)];
         uint16_t& control_info =
             *reinterpret_cast<uint16_t*>(bush + kControlOffset);
-        uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-                           kBushLookup[(control_info >> kByteShift)];
+        uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
         uint8_t overflow_flag =
             item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -1020,7 +1042,18 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
 */
 
 bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
-                                           ConcurrentSkulkerHT* new_ht) {
+                                           ConcurrentSkulkerHT* new_ht,
+                                           ConcurrentSkulkerHT* split_ht,
+                                           PartitionRouter router,
+                                           uint64_t split_bit) {
+
+    // a splitting resize sends the entries routed to the new partition to
+    // split_ht
+    auto target_ht = [&](uint64_t key) {
+        return (split_ht && (router.Route(key) & split_bit)) ? split_ht
+                                                             : new_ht;
+    };
+
     // auto start_time = std::chrono::high_resolution_clock::now();
 
     uint64_t stride_id_start = stride_id * resize_stride_size;
@@ -1036,8 +1069,7 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
         uint8_t* bush = &bush_tab[(bush_id << kBushIdShiftOffset)];
         uint16_t& control_info =
             *reinterpret_cast<uint16_t*>(bush + kControlOffset);
-        uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-                           kBushLookup[(control_info >> kByteShift)];
+        uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
         uint8_t overflow_flag =
             item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -1059,7 +1091,7 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
                     ins_queue.push(std::make_pair(
                         ins_key,
                         *reinterpret_cast<uint64_t*>(entry + kValueOffset)));
-                    new_ht->prefetch_key(ins_key);
+                    target_ht(ins_key)->prefetch_key(ins_key);
 
                     uintptr_t pre_deref_key = base_id;
                     uint8_t* pre_tiny_ptr = entry + kTinyPtrOffset;
@@ -1074,7 +1106,7 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
                         ins_queue.push(std::make_pair(
                             ins_key, *reinterpret_cast<uint64_t*>(
                                          entry + kValueOffset)));
-                        new_ht->prefetch_key(ins_key);
+                        target_ht(ins_key)->prefetch_key(ins_key);
 
                         pre_tiny_ptr = entry + kTinyPtrOffset;
                         pre_deref_key = reinterpret_cast<uintptr_t>(entry);
@@ -1096,7 +1128,7 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
                         ins_queue.push(std::make_pair(
                             ins_key, *reinterpret_cast<uint64_t*>(
                                          entry + kValueOffset)));
-                        new_ht->prefetch_key(ins_key);
+                        target_ht(ins_key)->prefetch_key(ins_key);
 
                         pre_tiny_ptr = entry + kTinyPtrOffset;
                         pre_deref_key = reinterpret_cast<uintptr_t>(entry);
@@ -1110,7 +1142,8 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
             while (!ins_queue.empty()) {
                 auto ins_pair = ins_queue.front();
                 ins_queue.pop();
-                if (!new_ht->Insert(ins_pair.first, ins_pair.second)) {
+                if (!target_ht(ins_pair.first)
+                         ->Insert(ins_pair.first, ins_pair.second)) {
                     return false;
                 }
             }
@@ -1120,7 +1153,8 @@ bool ConcurrentSkulkerHT::ResizeMoveStride(uint64_t stride_id,
     while (!ins_queue.empty()) {
         auto ins_pair = ins_queue.front();
         ins_queue.pop();
-        if (!new_ht->Insert(ins_pair.first, ins_pair.second)) {
+        if (!target_ht(ins_pair.first)
+                 ->Insert(ins_pair.first, ins_pair.second)) {
             return false;
         }
     }
@@ -18,14 +18,13 @@
 #include <vector>
 #include "common.h"
 #include "utils/cache_line_size.h"
+#include "utils/page_pool.h"
+#include "utils/rank_select.h"
 
 namespace tinyptr {
 
 class ConcurrentSkulkerHT {
-    friend struct ConcurrentSkulkerHTBushLookupInitializer;
-
    public:
-    static uint8_t kBushLookup[256];
     static constexpr uint8_t kByteMask = 0xFF;
     static constexpr uint8_t kByteShift = 8;
 
@@ -38,7 +37,7 @@ class ConcurrentSkulkerHT {
     const uint8_t kEntryByteLength;
 
     // layout
-    // {4*{TP,K,V},{Skulkers},{Control}}
+    // {4*{TP,K,V},{Skulkers},{Fingerprints},{Control}}
 
     // const uint8_t kBushByteLength = utils::kCacheLineSize;
     static constexpr uint8_t kBushByteLength = 64;
@@ -46,8 +45,15 @@ class ConcurrentSkulkerHT {
     // control byte and skulkers grow from the end of the bush
     static constexpr uint8_t kConcurrentVersionByteLength = 1;
     static constexpr uint8_t kControlByteLength = 2;
+    // with the fingerprint lane, every slot of the bush keeps one byte that
+    // is a tiny bloom filter of the keys on it; the lane takes the room of an
+    // exhibitor, and bushes have at most 8 slots instead of 16
+    static constexpr uint8_t kFingerprintLaneByteLength = 8;
+    static constexpr uint64_t kFingerprintMultiplier = 0x9E3779B97F4A7C15ULL;
     const uint8_t kConcurrentVersionOffset;
     const uint8_t kControlOffset;
+    const uint8_t kFingerprintByteLength;
+    const uint8_t kFingerprintOffset;
     const uint8_t kSkulkerOffset;
 
     // expected ratio of used quotienting slots
@@ -92,25 +98,46 @@ class ConcurrentSkulkerHT {
     uint8_t AutoFastDivisionInnerShift(uint64_t divisor);
 
    public:
+    // with a pool, the table memory is taken from and returned to it
+    // if_fingerprint adds the fingerprint lane to every bush, so queries for
+    // missing keys rarely read an exhibitor or follow a tiny pointer
     ConcurrentSkulkerHT(uint64_t size, uint8_t quotienting_tail_length,
-                        uint16_t bin_size, bool if_resize = false, double resize_threshold = 1.0);
+                        uint16_t bin_size, bool if_resize = false, double resize_threshold = 1.0,
+                        utils::PagePool* pool = nullptr,
+                        bool if_fingerprint = false);
     ConcurrentSkulkerHT(uint64_t size, uint16_t bin_size,
-                        bool if_resize = false, double resize_threshold = 1.0);
-    ConcurrentSkulkerHT(uint64_t size, bool if_resize = false, double resize_threshold = 1.0);
+                        bool if_resize = false, double resize_threshold = 1.0,
+                        bool if_fingerprint = false);
+    ConcurrentSkulkerHT(uint64_t size, bool if_resize = false, double resize_threshold = 1.0,
+                        utils::PagePool* pool = nullptr);
 
     ~ConcurrentSkulkerHT();
 
     bool Insert(uint64_t key, uint64_t value);
+    // same contract as BlastHT::BulkInsert, inserting one entry at a time
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
     bool Query(uint64_t key, uint64_t* value_ptr);
     bool Update(uint64_t key, uint64_t value);
     void Free(uint64_t key);
 
+#ifdef TINYPTR_CONCURRENT_SKULKER_QUERY_ENTRY_CNT
+    // tiny pointers the calling thread's queries have followed, over every
+    // table; for tests only, the count is not kept otherwise
+    static uint64_t QueryEntryCnt();
+#endif
+
     void SetResizeStride(uint64_t stride_num);
-    bool ResizeMoveStride(uint64_t stride_id, ConcurrentSkulkerHT* new_ht);
+    bool ResizeMoveStride(uint64_t stride_id, ConcurrentSkulkerHT* new_ht,
+                          ConcurrentSkulkerHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
 
     uint64_t GetTableSize() const { return kBushNum * 4; }
 
    protected:
+    utils::PagePool* page_pool;
+    void* combined_mem;
+    uint64_t combined_size;
     uint8_t* bush_tab;
     uint8_t* byte_array;
     uint8_t* bin_cnt_head;
@@ -163,6 +190,40 @@ class ConcurrentSkulkerHT {
                    kBinNum;
     }
 
+    // two of the 8 bits, drawn from the part of the key that is not
+    // quotiented away; keys on the same slot only differ there
+    __attribute__((always_inline)) inline uint8_t fingerprint(uint64_t key) {
+        uint64_t hash =
+            (key >> kQuotientingTailLength) * kFingerprintMultiplier;
+        return (1u << (hash >> 61)) | (1u << ((hash >> 58) & 7));
+    }
+
+    // false only if the slot's fingerprint rules key out
+    __attribute__((always_inline)) inline bool fingerprint_may_hold(
+        uint8_t* bush, uint64_t in_bush_offset, uint64_t key) {
+        if (!kFingerprintByteLength) {
+            return true;
+        }
+        uint8_t fp = fingerprint(key);
+        return (bush[kFingerprintOffset + in_bush_offset] & fp) == fp;
+    }
+
+    __attribute__((always_inline)) inline void fingerprint_add(
+        uint8_t* bush, uint64_t in_bush_offset, uint64_t key) {
+        if (kFingerprintByteLength) {
+            bush[kFingerprintOffset + in_bush_offset] |= fingerprint(key);
+        }
+    }
+
+    // frees leave the bits of the freed key behind until the slot empties,
+    // which only costs some extra reads
+    __attribute__((always_inline)) inline void fingerprint_clear(
+        uint8_t* bush, uint64_t in_bush_offset) {
+        if (kFingerprintByteLength) {
+            bush[kFingerprintOffset + in_bush_offset] = 0;
+        }
+    }
+
     __attribute__((always_inline)) inline uint8_t& bin_cnt(uint64_t bin_id) {
         return bin_cnt_head[bin_id << 1];
     }
@@ -411,22 +472,8 @@ class ConcurrentSkulkerHT {
 
         // get the base_id of the last exhibitor
 
-        uint32_t hide_in_bush_offset = _tzcnt_u32(
-            _pdep_u32(1u << (item_cnt - exhibitor_num), control_info));
-
-        /*
-        uint8_t hide_in_bush_offset = 0;
-        uint16_t control_info_before_spilled =
-            control_info >> (hide_in_bush_offset + 1);
-
-        while (kBushLookup[control_info_before_spilled & kByteMask] +
-                   kBushLookup[(control_info_before_spilled >> kByteShift)] >=
-               exhibitor_num) {
-            hide_in_bush_offset++;
-            control_info_before_spilled =
-                control_info >> (hide_in_bush_offset + 1);
-        }
-        */
+        uint32_t hide_in_bush_offset =
+            utils::Select64(control_info, item_cnt - exhibitor_num);
 
         uintptr_t spilled_base_id = bush_offset + hide_in_bush_offset;
 
@@ -470,22 +517,8 @@ class ConcurrentSkulkerHT {
 
         // get the base_id of the first skulker
 
-        uint32_t raid_in_bush_offset = _tzcnt_u32(
-            _pdep_u32(1u << (item_cnt - exhibitor_num - 1), control_info));
-
-        /*
-        uint8_t raid_in_bush_offset = 0;
-        uint16_t control_info_before_spilled =
-            control_info >> (raid_in_bush_offset + 1);
-
-        while (kBushLookup[control_info_before_spilled & kByteMask] +
-                   kBushLookup[(control_info_before_spilled >> kByteShift)] >
-               exhibitor_num) {
-            raid_in_bush_offset++;
-            control_info_before_spilled =
-                control_info >> (raid_in_bush_offset + 1);
-        }
-        */
+        uint32_t raid_in_bush_offset =
+            utils::Select64(control_info, item_cnt - exhibitor_num - 1);
 
         uint8_t* pre_tiny_ptr = exhibitor_ptr + kTinyPtrOffset;
         uintptr_t pre_deref_key = bush_offset + raid_in_bush_offset;
@@ -509,17 +542,4 @@ class ConcurrentSkulkerHT {
     }
 };
 
-struct ConcurrentSkulkerHTBushLookupInitializer {
-    ConcurrentSkulkerHTBushLookupInitializer() {
-        for (int i = 0; i < 256; ++i) {
-            ConcurrentSkulkerHT::kBushLookup[i] = 0;
-            int tmp = i;
-            while (tmp) {
-                ConcurrentSkulkerHT::kBushLookup[i]++;
-                tmp -= tmp & (-tmp);
-            }
-        }
-    };
-};
-
 }  // namespace tinyptr
\ No newline at end of file
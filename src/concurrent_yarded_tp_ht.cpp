@@ -0,0 +1,283 @@
+#include "concurrent_yarded_tp_ht.h"
+#include <emmintrin.h>
+#include <cstdint>
+#include <cstring>
+
+namespace tinyptr {
+
+double ConcurrentYardedTPHT::ValidBaseEntryRatio() {
+    return 0.5 * kBinNum * kBinSize / kBaseTabSize + 0.15;
+}
+
+ConcurrentYardedTPHT::ConcurrentYardedTPHT(uint64_t size, uint16_t bin_size)
+    : ConcurrentByteArrayChainedHT(size, 0, bin_size),
+      yarded_base_tab(kBaseTabSize, ValidBaseEntryRatio(), 1) {}
+
+ConcurrentYardedTPHT::ConcurrentYardedTPHT(uint64_t size, bool if_resize,
+                                           double resize_threshold,
+                                           utils::PagePool* pool)
+    : ConcurrentByteArrayChainedHT(size, 0, 127, if_resize, resize_threshold,
+                                   pool),
+      yarded_base_tab(kBaseTabSize, ValidBaseEntryRatio(), 1, pool) {}
+
+bool ConcurrentYardedTPHT::insert_in_chain(uint64_t base_id, uint64_t key,
+                                           uint64_t value,
+                                           uint32_t max_chain_length) {
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+    uint64_t base_key = yarded_base_tab.BaseKey(base_id);
+
+    if (base_tab_ptr == 0) {
+        if (!yarded_base_tab.HasRoom(base_id)) {
+            return false;
+        }
+        uint8_t* entry = ptab_insert_entry_address(base_key);
+        if (entry == nullptr) {
+            return false;
+        }
+        yarded_base_tab.Insert(base_id, *entry);
+        // assuming little endian
+        *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
+        entry[kTinyPtrOffset] = 0;
+        *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+        return true;
+    }
+
+    uint8_t* pre_tiny_ptr = &base_tab_ptr;
+    uint64_t pre_tiny_ptr_key = base_key;
+    uint32_t chain_length = 0;
+
+    while (*pre_tiny_ptr != 0) {
+        uint8_t* entry =
+            ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+        pre_tiny_ptr = entry + kTinyPtrOffset;
+        pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
+        chain_length++;
+    }
+
+    if (max_chain_length && chain_length >= max_chain_length) {
+        return false;
+    }
+
+    uint8_t* entry = ptab_insert_entry_address(pre_tiny_ptr_key);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    uint8_t new_tiny_ptr = *entry;
+    // assuming little endian
+    *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
+    entry[kTinyPtrOffset] = 0;
+    *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+    *pre_tiny_ptr = new_tiny_ptr;
+    return true;
+}
+
+bool ConcurrentYardedTPHT::Insert(uint64_t key, uint64_t value) {
+    uint64_t base_id = hash_1_base_id(key);
+    std::atomic<uint8_t>& concurrent_version = lock_duplex(base_id);
+    bool res = insert_in_chain(base_id, key, value, max_chain_length);
+    concurrent_version.fetch_add(1);
+    return res;
+}
+
+uint32_t ConcurrentYardedTPHT::BulkInsert(
+    std::pair<uint64_t, uint64_t>* entries, uint32_t entry_num) {
+    uint32_t failed_num = 0;
+
+    for (uint32_t i = 0; i < entry_num; i++) {
+        uint64_t base_id = hash_1_base_id(entries[i].first);
+        std::atomic<uint8_t>& concurrent_version = lock_duplex(base_id);
+        bool res = insert_in_chain(base_id, entries[i].first,
+                                   entries[i].second, 0);
+        concurrent_version.fetch_add(1);
+        if (!res) {
+            entries[failed_num++] = entries[i];
+        }
+    }
+
+    return failed_num;
+}
+
+bool ConcurrentYardedTPHT::Query(uint64_t key, uint64_t* value_ptr) {
+    uint64_t base_id = hash_1_base_id(key);
+    uint64_t base_key = yarded_base_tab.BaseKey(base_id);
+    std::atomic<uint8_t>& concurrent_version = duplex_version(base_id);
+
+    // quotienting and shifting back
+    key >>= kQuotientingTailLength;
+    key <<= kQuotientingTailLength;
+
+query_again:
+
+    uint8_t expected_version;
+    do {
+        expected_version = concurrent_version.load();
+    } while (expected_version & 1);
+
+    // a write to the duplex may shift base_id's pointer while we read it, so
+    // a miss is validated too
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+    uint8_t* pre_tiny_ptr = &base_tab_ptr;
+    uint64_t pre_tiny_ptr_key = base_key;
+
+    for (uint32_t hop = 1; *pre_tiny_ptr != 0; hop++) {
+        if (hop % kQueryHopBound == 0 &&
+            concurrent_version.load() != expected_version) {
+            goto query_again;
+        }
+        uint8_t* entry =
+            ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+        if ((*reinterpret_cast<uint64_t*>(entry) << kQuotientingTailLength) ==
+            key) {
+            *value_ptr = *reinterpret_cast<uint64_t*>(entry + kValueOffset);
+            if (concurrent_version.load() != expected_version) {
+                goto query_again;
+            }
+            return true;
+        }
+        pre_tiny_ptr = entry + kTinyPtrOffset;
+        pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
+    }
+
+    if (concurrent_version.load() != expected_version) {
+        goto query_again;
+    }
+    return false;
+}
+
+bool ConcurrentYardedTPHT::Update(uint64_t key, uint64_t value) {
+    uint64_t base_id = hash_1_base_id(key);
+    std::atomic<uint8_t>& concurrent_version = lock_duplex(base_id);
+
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+    uint8_t* pre_tiny_ptr = &base_tab_ptr;
+    uint64_t pre_tiny_ptr_key = yarded_base_tab.BaseKey(base_id);
+
+    // quotienting
+    key >>= kQuotientingTailLength;
+
+    while (*pre_tiny_ptr != 0) {
+        uint8_t* entry =
+            ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+        if (((*reinterpret_cast<uint64_t*>(entry) << kQuotientingTailLength) >>
+             kQuotientingTailLength) == key) {
+            *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+            concurrent_version.fetch_add(1);
+            return true;
+        }
+        pre_tiny_ptr = entry + kTinyPtrOffset;
+        pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
+    }
+
+    concurrent_version.fetch_add(1);
+    return false;
+}
+
+void ConcurrentYardedTPHT::Free(uint64_t key) {
+    uint64_t base_id = hash_1_base_id(key);
+    std::atomic<uint8_t>& concurrent_version = lock_duplex(base_id);
+
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+    if (base_tab_ptr == 0) {
+        concurrent_version.fetch_add(1);
+        return;
+    }
+
+    // quotienting
+    key >>= kQuotientingTailLength;
+
+    // as in YardedTPHT::Free, the last entry fills the hole
+    uint8_t* pre_tiny_ptr = &base_tab_ptr;
+    uint64_t pre_tiny_ptr_key = yarded_base_tab.BaseKey(base_id);
+    uint8_t* cur_entry = nullptr;
+    uint8_t* aiming_entry = nullptr;
+
+    while (true) {
+        cur_entry = ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+        if (((*reinterpret_cast<uint64_t*>(cur_entry)
+              << kQuotientingTailLength) >>
+             kQuotientingTailLength) == key) {
+            aiming_entry = cur_entry;
+        }
+        if (cur_entry[kTinyPtrOffset] == 0) {
+            break;
+        }
+        pre_tiny_ptr = cur_entry + kTinyPtrOffset;
+        pre_tiny_ptr_key = reinterpret_cast<uint64_t>(cur_entry);
+    }
+
+    if (aiming_entry == nullptr) {
+        concurrent_version.fetch_add(1);
+        return;
+    }
+
+    uint8_t tmp = aiming_entry[kTinyPtrOffset];
+    memcpy(aiming_entry, cur_entry, kEntryByteLength);
+    aiming_entry[kTinyPtrOffset] = tmp;
+
+    // the bin is shared with other duplexes, which keep claiming slots
+    release_slot(cur_entry, *pre_tiny_ptr);
+    if (pre_tiny_ptr == &base_tab_ptr) {
+        yarded_base_tab.Erase(base_id);
+    } else {
+        *pre_tiny_ptr = 0;
+    }
+    concurrent_version.fetch_add(1);
+}
+
+bool ConcurrentYardedTPHT::ResizeMoveStride(uint64_t stride_id,
+                                            ConcurrentYardedTPHT* new_ht,
+                                            ConcurrentYardedTPHT* split_ht,
+                                            PartitionRouter router,
+                                            uint64_t split_bit) {
+
+    uint64_t start_base_id = stride_id * resize_stride_size;
+    uint64_t end_base_id = start_base_id + resize_stride_size;
+    if (end_base_id > kBaseTabSize) {
+        end_base_id = kBaseTabSize;
+    }
+
+    std::pair<uint64_t, uint64_t> batches[2][kBulkInsertBatchSize];
+    uint32_t batch_sizes[2] = {0, 0};
+    ConcurrentYardedTPHT* targets[2] = {new_ht, split_ht};
+    bool res = true;
+
+    for (uint64_t base_id = start_base_id; base_id < end_base_id; base_id++) {
+
+        uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+        uint8_t* pre_tiny_ptr = &base_tab_ptr;
+        uint64_t pre_tiny_ptr_key = yarded_base_tab.BaseKey(base_id);
+
+        while (*pre_tiny_ptr != 0) {
+
+            uint8_t* entry =
+                ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+
+            uint64_t ins_key = hash_key_rebuild(
+                *reinterpret_cast<uint64_t*>(entry), base_id);
+
+            uint8_t target = split_ht && (router.Route(ins_key) & split_bit);
+            batches[target][batch_sizes[target]++] = std::make_pair(
+                ins_key, *reinterpret_cast<uint64_t*>(entry + kValueOffset));
+            if (batch_sizes[target] == kBulkInsertBatchSize) {
+                res &= targets[target]->BulkInsert(
+                           batches[target], batch_sizes[target]) == 0;
+                batch_sizes[target] = 0;
+            }
+
+            pre_tiny_ptr = entry + kTinyPtrOffset;
+            pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
+        }
+    }
+
+    for (uint8_t target = 0; target < 2; target++) {
+        if (batch_sizes[target]) {
+            res &= targets[target]->BulkInsert(batches[target],
+                                               batch_sizes[target]) == 0;
+        }
+    }
+
+    return res;
+}
+
+}  // namespace tinyptr
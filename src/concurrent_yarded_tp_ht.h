@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include "concurrent_byte_array_chained_ht.h"
+#include "utils/page_pool.h"
+#include "yarded_base_tab.h"
+
+namespace tinyptr {
+
+// YardedTPHT for concurrent use: the last byte of every duplex line is the
+// version of the duplex
+// inserting or freeing a chain head shifts the pointers of the other chains
+// in the duplex, so every write takes the duplex version, and a lookup
+// retries when the version moved under it, whether it hit or missed
+
+class ConcurrentYardedTPHT : public ConcurrentByteArrayChainedHT {
+
+   protected:
+    double ValidBaseEntryRatio();
+
+   public:
+    ConcurrentYardedTPHT(uint64_t size, uint16_t bin_size);
+    ConcurrentYardedTPHT(uint64_t size, bool if_resize,
+                         double resize_threshold = 1.0,
+                         utils::PagePool* pool = nullptr);
+    ~ConcurrentYardedTPHT() = default;
+
+   protected:
+    __attribute__((always_inline)) inline std::atomic<uint8_t>& duplex_version(
+        uint64_t base_id) {
+        return *reinterpret_cast<std::atomic<uint8_t>*>(
+            yarded_base_tab.Frontyard(yarded_base_tab.DuplexId(base_id)) +
+            utils::kCacheLineSize - 1);
+    }
+
+    __attribute__((always_inline)) inline std::atomic<uint8_t>& lock_duplex(
+        uint64_t base_id) {
+        std::atomic<uint8_t>& concurrent_version = duplex_version(base_id);
+        uint8_t expected_version;
+        do {
+            expected_version = concurrent_version.load();
+        } while ((expected_version & 1) ||
+                 !concurrent_version.compare_exchange_weak(
+                     expected_version, expected_version + 1));
+        return concurrent_version;
+    }
+
+    // hops a lookup takes before it re-checks the duplex version: a torn
+    // pointer read under a writer can lead into a cycle, which the check
+    // breaks, while a chain this long that nobody touched is walked on
+    static constexpr uint32_t kQueryHopBound = 64;
+
+    // the caller holds the duplex of base_id
+    bool insert_in_chain(uint64_t base_id, uint64_t key, uint64_t value,
+                         uint32_t max_chain_length);
+
+   public:
+    bool Insert(uint64_t key, uint64_t value);
+    // returns how many entries did not fit, moved to the front of entries;
+    // the chain cap is not applied, as for ConcurrentByteArrayChainedHT
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
+    bool Query(uint64_t key, uint64_t* value_ptr);
+    bool Update(uint64_t key, uint64_t value);
+    void Free(uint64_t key);
+
+    bool ResizeMoveStride(uint64_t stride_id, ConcurrentYardedTPHT* new_ht,
+                          ConcurrentYardedTPHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
+
+   private:
+    // these walk the parent's flat base_tab, which this table leaves unused
+    using ConcurrentByteArrayChainedHT::AvgChainLength;
+    using ConcurrentByteArrayChainedHT::ChainLengthHistogram;
+    using ConcurrentByteArrayChainedHT::FillChainLength;
+    using ConcurrentByteArrayChainedHT::MaxChainLength;
+    using ConcurrentByteArrayChainedHT::MultiQuery;
+    using ConcurrentByteArrayChainedHT::QueryEntryCnt;
+    using ConcurrentByteArrayChainedHT::QueryNoMem;
+    using ConcurrentByteArrayChainedHT::SetAdaptiveChains;
+
+   protected:
+    YardedBaseTab yarded_base_tab;
+};
+
+}  // namespace tinyptr
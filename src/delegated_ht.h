@@ -0,0 +1,342 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "single_owner_resizable_ht.h"
+#include "utils/spsc_ring.h"
+
+namespace tinyptr {
+
+// shared-nothing front end: every owner thread has a shard to itself, and
+// clients delegate the operations on a key to its owner over a pair of SPSC
+// rings per (client, owner), one for requests and one for responses
+// no shard is ever touched by two threads, so the shards need no versions or
+// locks; an owner pops a batch of requests, prefetches all of their keys,
+// and only then runs them, so their misses overlap
+
+template <typename ShardType>
+class DelegatedHT {
+   public:
+    enum OpType : uint8_t { kInsert = 0, kQuery = 1, kUpdate = 2, kErase = 3 };
+
+    struct Request {
+        uint64_t key;
+        uint64_t value;  // not read by queries and erases
+        OpType op;
+    };
+
+    struct Response {
+        uint64_t value;  // what a query found
+        bool ok;         // erases always succeed
+    };
+
+    static constexpr uint64_t kRingCapacity = 256;
+    static constexpr uint32_t kPipelineDepth = 16;
+    static constexpr uint32_t kIdleSpinLimit = 1 << 10;
+
+    // client_num bounds the handles out at once; each shard starts with
+    // part_num_per_owner partitions of initial_size_per_part
+    // with pin_owners, owner i is pinned to the i-th cpu the process may run
+    // on, so a busy-polling owner keeps its core and its shard stays local
+    DelegatedHT(uint64_t initial_size_per_part, uint32_t owner_num,
+                uint32_t client_num, uint64_t part_num_per_owner = 16,
+                double resize_threshold = 0.7, double resize_factor = 2.0,
+                bool pin_owners = false)
+        : owner_num(owner_num),
+          client_num(client_num),
+          channels(new Channel[uint64_t(client_num) * owner_num]),
+          inflight(new uint32_t[uint64_t(client_num) * owner_num]()),
+          shards(owner_num),
+          stop(false),
+          ready_num(0) {
+        uint64_t seed = rand() & ((1 << 16) - 1);
+        router = {seed, ((seed | 1) << 32) | (rand() | 1)};
+
+        for (uint32_t i = 0; i < client_num; i++) {
+            free_handle.insert(i);
+        }
+
+        std::vector<int> cpus;
+        if (pin_owners) {
+            cpus = allowed_cpus();
+        }
+
+        // each owner builds its own shard, so the shard's memory is first
+        // touched, and placed, by the core that uses it
+        for (uint32_t owner = 0; owner < owner_num; owner++) {
+            owners.emplace_back([=]() {
+                if (!cpus.empty()) {
+                    pin_to_cpu(cpus[owner % cpus.size()]);
+                }
+                shards[owner].reset(new ShardType(
+                    initial_size_per_part, part_num_per_owner,
+                    resize_threshold, resize_factor));
+                ready_num.fetch_add(1);
+                owner_loop(owner);
+            });
+        }
+        while (ready_num.load() < owner_num) {
+            std::this_thread::yield();
+        }
+    }
+
+    ~DelegatedHT() {
+        stop.store(true);
+        for (auto& owner : owners) {
+            owner.join();
+        }
+    }
+
+    DelegatedHT(const DelegatedHT&) = delete;
+    DelegatedHT& operator=(const DelegatedHT&) = delete;
+
+    uint64_t GetHandle() {
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        uint64_t handle = *free_handle.begin();
+        free_handle.erase(handle);
+        return handle;
+    }
+
+    void FreeHandle(uint64_t handle) {
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        free_handle.insert(handle);
+    }
+
+    // runs request_num requests and writes the response to requests[i] to
+    // responses[i]; the requests on one key run in order, those on
+    // different owners in no particular order
+    // returns how many succeeded
+    uint32_t Execute(uint64_t handle, const Request* requests,
+                     uint32_t request_num, Response* responses) {
+        Channel* client_channels = &channels[handle * owner_num];
+        uint32_t* client_inflight = &inflight[handle * owner_num];
+        ResponseSlot batch[kPipelineDepth];
+        uint32_t sent = 0, done = 0, ok_num = 0;
+        uint32_t idle_rounds = 0;
+
+        while (done < request_num) {
+            // hand out requests until one of the rings is full, then drain
+            // the responses, so an owner never waits on us for long
+            while (sent < request_num) {
+                const Request& req = requests[sent];
+                uint32_t owner = owner_of(req.key);
+                if (!client_channels[owner].requests.TryPush(
+                        {req.key, req.value, sent, req.op})) {
+                    break;
+                }
+                client_inflight[owner]++;
+                sent++;
+            }
+
+            uint32_t received = 0;
+            for (uint32_t owner = 0; owner < owner_num; owner++) {
+                if (!client_inflight[owner]) {
+                    continue;
+                }
+                uint32_t num = client_channels[owner].responses.TryPopBatch(
+                    batch, kPipelineDepth);
+                for (uint32_t i = 0; i < num; i++) {
+                    responses[batch[i].tag] = {batch[i].value, batch[i].ok};
+                    ok_num += batch[i].ok;
+                }
+                client_inflight[owner] -= num;
+                received += num;
+            }
+            done += received;
+
+            if (received) {
+                idle_rounds = 0;
+            } else {
+                back_off(idle_rounds);
+            }
+        }
+
+        return ok_num;
+    }
+
+    bool Insert(uint64_t handle, uint64_t key, uint64_t value) {
+        Request req{key, value, kInsert};
+        Response res;
+        return Execute(handle, &req, 1, &res);
+    }
+
+    bool Query(uint64_t handle, uint64_t key, uint64_t* value_ptr) {
+        Request req{key, 0, kQuery};
+        Response res;
+        if (!Execute(handle, &req, 1, &res)) {
+            return false;
+        }
+        *value_ptr = res.value;
+        return true;
+    }
+
+    bool Update(uint64_t handle, uint64_t key, uint64_t value) {
+        Request req{key, value, kUpdate};
+        Response res;
+        return Execute(handle, &req, 1, &res);
+    }
+
+    void Erase(uint64_t handle, uint64_t key) {
+        Request req{key, 0, kErase};
+        Response res;
+        Execute(handle, &req, 1, &res);
+    }
+
+    uint32_t GetOwnerNum() const { return owner_num; }
+
+    // the shards' counters are plain integers; only read this while no
+    // request is in flight
+    uint64_t GetResizeNum() const {
+        uint64_t res = 0;
+        for (auto& shard : shards) {
+            res += shard->GetResizeNum();
+        }
+        return res;
+    }
+
+   private:
+    // the tag is the index of the request in its batch, so the responses
+    // can come back in any order
+    struct RequestSlot {
+        uint64_t key;
+        uint64_t value;
+        uint32_t tag;
+        OpType op;
+    };
+
+    struct ResponseSlot {
+        uint64_t value;
+        uint32_t tag;
+        bool ok;
+    };
+
+    struct Channel {
+        utils::SpscRing<RequestSlot, kRingCapacity> requests;
+        utils::SpscRing<ResponseSlot, kRingCapacity> responses;
+    };
+
+    __attribute__((always_inline)) inline uint32_t owner_of(uint64_t key) {
+        return (router.Route(key) * owner_num) >> 32;
+    }
+
+    static std::vector<int> allowed_cpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set)) {
+            return cpus;
+        }
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    // best effort: an owner left unpinned still works
+    static void pin_to_cpu(int cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    // spins for a while, then gives the core away, in case the thread we
+    // wait for shares it
+    static __attribute__((always_inline)) inline void back_off(
+        uint32_t& idle_rounds) {
+        if (++idle_rounds < kIdleSpinLimit) {
+            _mm_pause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    void owner_loop(uint32_t owner) {
+        ShardType& shard = *shards[owner];
+        RequestSlot batch[kPipelineDepth];
+        uint32_t idle_rounds = 0;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            bool busy = false;
+
+            for (uint32_t client = 0; client < client_num; client++) {
+                Channel& channel =
+                    channels[uint64_t(client) * owner_num + owner];
+                uint32_t num =
+                    channel.requests.TryPopBatch(batch, kPipelineDepth);
+                if (!num) {
+                    continue;
+                }
+                busy = true;
+
+                for (uint32_t i = 0; i < num; i++) {
+                    shard.Prefetch(batch[i].key);
+                }
+
+                for (uint32_t i = 0; i < num; i++) {
+                    ResponseSlot res{0, batch[i].tag, true};
+                    switch (batch[i].op) {
+                        case kInsert:
+                            res.ok = shard.Insert(batch[i].key, batch[i].value);
+                            break;
+                        case kQuery:
+                            res.ok = shard.Query(batch[i].key, &res.value);
+                            break;
+                        case kUpdate:
+                            res.ok = shard.Update(batch[i].key, batch[i].value);
+                            break;
+                        case kErase:
+                            shard.Erase(batch[i].key);
+                            break;
+                    }
+                    // the client drains its responses whenever it cannot
+                    // push, so this only waits for it to catch up
+                    uint32_t full_rounds = 0;
+                    while (!channel.responses.TryPush(res)) {
+                        back_off(full_rounds);
+                    }
+                }
+            }
+
+            if (busy) {
+                idle_rounds = 0;
+            } else {
+                back_off(idle_rounds);
+            }
+        }
+    }
+
+    const uint32_t owner_num;
+    const uint32_t client_num;
+    PartitionRouter router;
+
+    std::unique_ptr<Channel[]> channels;
+    // per (client, owner), requests whose response has not come back; only
+    // touched by the client
+    std::unique_ptr<uint32_t[]> inflight;
+
+    std::vector<std::unique_ptr<ShardType>> shards;
+    std::vector<std::thread> owners;
+    std::atomic<bool> stop;
+    std::atomic<uint32_t> ready_num;
+
+    std::set<uint64_t> free_handle;
+    std::mutex handle_mutex;
+};
+
+using DelegatedBlastHT = DelegatedHT<SingleOwnerBlastHT>;
+
+}  // namespace tinyptr
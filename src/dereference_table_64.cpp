@@ -5,8 +5,8 @@
 namespace tinyptr {
 
 DereferenceTable64::DereferenceTable64(int n) {
-    p_tab = new Po2CTable(n);
-    o_tab = new OverflowTable;
+    p_tab = new Po2CTable<XXHashBinPolicy>(n);
+    o_tab = new OverflowTable(n * kExpectedOverflowRatio);
 }
 
 uint8_t DereferenceTable64::Allocate(uint64_t key, uint64_t value) {
@@ -1,36 +1,41 @@
-#pragma once
-
-#include <cstdint>
-#include <cstddef>
-
-#include "common.h"
-#include "dereference_table.h"
-
-namespace tinyptr {
-
-class Po2CTable;
-class OverflowTable;
-
-class DereferenceTable64 : DereferenceTable {
-
-   public:
-    static constexpr size_t kBinSize = 127;
-    static constexpr uint8_t kNullTinyPtr = 0;
-    static constexpr uint8_t kOverflowTinyPtr = ((1 << 8) - 1);
-
-   public:
-    DereferenceTable64() = delete;
-    DereferenceTable64(int n);
-    ~DereferenceTable64() = default;
-
-    uint8_t Allocate(uint64_t key, uint64_t value);
-    bool Update(uint64_t key, uint8_t ptr, uint64_t value);
-    bool Query(uint64_t key, uint8_t ptr, uint64_t* value_ptr);
-    bool Free(uint64_t key, uint8_t ptr);
-
-   private:
-    Po2CTable* p_tab;
-    OverflowTable* o_tab;
-};
-
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "common.h"
+#include "dereference_table.h"
+
+namespace tinyptr {
+
+struct XXHashBinPolicy;
+template <typename BinHash>
+class Po2CTable;
+class OverflowTable;
+
+class DereferenceTable64 : DereferenceTable {
+
+   public:
+    static constexpr size_t kBinSize = 127;
+    static constexpr uint8_t kNullTinyPtr = 0;
+    static constexpr uint8_t kOverflowTinyPtr = ((1 << 8) - 1);
+    // share of the n keys the overflow table is sized for up front; two
+    // choices of 127-slot bins rarely spill before the table is full
+    static constexpr double kExpectedOverflowRatio = 1.0 / 64;
+
+   public:
+    DereferenceTable64() = delete;
+    DereferenceTable64(int n);
+    ~DereferenceTable64() = default;
+
+    uint8_t Allocate(uint64_t key, uint64_t value);
+    bool Update(uint64_t key, uint8_t ptr, uint64_t value);
+    bool Query(uint64_t key, uint8_t ptr, uint64_t* value_ptr);
+    bool Free(uint64_t key, uint8_t ptr);
+
+   private:
+    Po2CTable<XXHashBinPolicy>* p_tab;
+    OverflowTable* o_tab;
+};
+
 }  // namespace tinyptr
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "hybrid_ht.h"
+#include <algorithm>
+
+namespace tinyptr {
+
+HybridHT::HybridHT(uint64_t size, bool if_resize, double resize_threshold,
+                   utils::PagePool* pool, bool hot)
+    : blast_ht(nullptr), chained_ht(nullptr), access_cnt(0) {
+    if (hot) {
+        blast_ht = new BlastHT(size, if_resize, resize_threshold, pool);
+    } else {
+        chained_ht = new ConcurrentByteArrayChainedHT(size, if_resize,
+                                                      resize_threshold, pool);
+    }
+}
+
+HybridHT::~HybridHT() {
+    delete blast_ht;
+    delete chained_ht;
+}
+
+void HybridHT::SetResizeStride(uint64_t stride_num) {
+    blast_ht ? blast_ht->SetResizeStride(stride_num)
+             : chained_ht->SetResizeStride(stride_num);
+}
+
+bool HybridHT::ResizeMoveStride(uint64_t stride_id, HybridHT* new_ht,
+                                HybridHT* split_ht, PartitionRouter router,
+                                uint64_t split_bit) {
+    if (new_ht->blast_ht) {
+        BlastHT* split_target = split_ht ? split_ht->blast_ht : nullptr;
+        return blast_ht ? blast_ht->ResizeMoveStride(stride_id,
+                                                     new_ht->blast_ht,
+                                                     split_target, router,
+                                                     split_bit)
+                        : chained_ht->ResizeMoveStride(stride_id,
+                                                       new_ht->blast_ht,
+                                                       split_target, router,
+                                                       split_bit);
+    }
+
+    ConcurrentByteArrayChainedHT* split_target =
+        split_ht ? split_ht->chained_ht : nullptr;
+    return blast_ht ? blast_ht->ResizeMoveStride(stride_id, new_ht->chained_ht,
+                                                 split_target, router,
+                                                 split_bit)
+                    : chained_ht->ResizeMoveStride(stride_id,
+                                                   new_ht->chained_ht,
+                                                   split_target, router,
+                                                   split_bit);
+}
+
+bool HybridHT::NextHot(int64_t entry_num) const {
+    uint64_t access_num = access_cnt.load(std::memory_order_relaxed)
+                          << kAccessSampleShift;
+    uint64_t bound = kHotAccessPerEntry * std::max<int64_t>(entry_num, 1);
+    return blast_ht ? access_num * 2 >= bound : access_num >= bound;
+}
+
+}  // namespace tinyptr
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include "blast_ht.h"
+#include "common.h"
+#include "concurrent_byte_array_chained_ht.h"
+#include "utils/page_pool.h"
+
+namespace tinyptr {
+
+// a partition table of ResizableHT that is a BlastHT while its traffic is hot
+// and a ConcurrentByteArrayChainedHT, close to half the bytes per entry, while
+// it is cold
+// a table keeps its representation for life; a resize picks one for the
+// table(s) it builds from the access rate sampled on the old table, and the
+// migration converts the entries on the way
+
+class HybridHT {
+   public:
+    // every 2^kAccessSampleShift-th operation of a thread is counted, on
+    // whichever table it lands
+    static constexpr uint32_t kAccessSampleShift = 6;
+    static constexpr uint32_t kAccessSampleMask =
+        (1 << kAccessSampleShift) - 1;
+    // estimated operations per entry over the life of a table, past which its
+    // successor is hot; a hot table keeps its successor hot down to half that
+    static constexpr uint64_t kHotAccessPerEntry = 8;
+
+   public:
+    HybridHT(uint64_t size, bool if_resize, double resize_threshold = 1.0,
+             utils::PagePool* pool = nullptr, bool hot = false);
+
+    ~HybridHT();
+
+    __attribute__((always_inline)) inline bool Insert(uint64_t key,
+                                                      uint64_t value) {
+        sample_access();
+        return blast_ht ? blast_ht->Insert(key, value)
+                        : chained_ht->Insert(key, value);
+    }
+
+    // not sampled, resize migration would pass for traffic
+    __attribute__((always_inline)) inline uint32_t BulkInsert(
+        std::pair<uint64_t, uint64_t>* entries, uint32_t entry_num) {
+        return blast_ht ? blast_ht->BulkInsert(entries, entry_num)
+                        : chained_ht->BulkInsert(entries, entry_num);
+    }
+
+    __attribute__((always_inline)) inline bool Query(uint64_t key,
+                                                     uint64_t* value_ptr) {
+        sample_access();
+        return blast_ht ? blast_ht->Query(key, value_ptr)
+                        : chained_ht->Query(key, value_ptr);
+    }
+
+    __attribute__((always_inline)) inline bool Update(uint64_t key,
+                                                      uint64_t value) {
+        sample_access();
+        return blast_ht ? blast_ht->Update(key, value)
+                        : chained_ht->Update(key, value);
+    }
+
+    __attribute__((always_inline)) inline void Free(uint64_t key) {
+        sample_access();
+        blast_ht ? blast_ht->Free(key) : chained_ht->Free(key);
+    }
+
+    void SetResizeStride(uint64_t stride_num);
+    // new_ht and split_ht share a representation, which may differ from ours
+    bool ResizeMoveStride(uint64_t stride_id, HybridHT* new_ht,
+                          HybridHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0);
+
+    uint64_t GetTableSize() const {
+        return blast_ht ? blast_ht->GetTableSize() : chained_ht->GetTableSize();
+    }
+
+    bool IsHot() const { return blast_ht != nullptr; }
+
+    // whether the table(s) replacing this one, about entry_num entries in
+    // total, should be hot
+    bool NextHot(int64_t entry_num) const;
+
+   protected:
+    // exactly one of the two is set
+    BlastHT* blast_ht;
+    ConcurrentByteArrayChainedHT* chained_ht;
+
+    std::atomic<uint64_t> access_cnt;
+
+    // a per-thread counter rather than a key hash, so a hot key is sampled
+    // as often as it is accessed
+    __attribute__((always_inline)) inline void sample_access() {
+        static thread_local uint32_t op_cnt = 0;
+        if (__builtin_expect((++op_cnt & kAccessSampleMask) == 0, 0)) {
+            access_cnt.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+}  // namespace tinyptr
@@ -0,0 +1,128 @@
+#include "incremental_skulker_ht.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace tinyptr {
+
+IncrementalSkulkerHT::IncrementalSkulkerHT(uint64_t initial_size,
+                                           double resize_threshold,
+                                           double resize_factor,
+                                           uint64_t migrate_bush_num)
+    : resize_threshold(resize_threshold),
+      resize_factor(resize_factor),
+      migrate_bush_num(migrate_bush_num),
+      cur_ht(new SkulkerHT(initial_size, false, resize_threshold)),
+      cur_size(initial_size),
+      resize_bound(initial_size * resize_threshold) {}
+
+IncrementalSkulkerHT::~IncrementalSkulkerHT() {
+    delete old_ht;
+    delete cur_ht;
+}
+
+void IncrementalSkulkerHT::start_resize() {
+    old_ht = cur_ht;
+    // room for every entry, not only those of the full table
+    cur_size = static_cast<uint64_t>(std::ceil(
+        std::max<double>(cur_size, entry_cnt / resize_threshold) *
+        resize_factor));
+    // bins of the full size: resize_threshold would shrink them, while the
+    // bound below is what keeps the table under it
+    cur_ht = new SkulkerHT(cur_size, true, 1.0);
+    resize_bound = cur_size * resize_threshold;
+
+    stride_num = (old_ht->kBushNum + migrate_bush_num - 1) / migrate_bush_num;
+    next_stride_id = 0;
+    old_ht->SetResizeStride(stride_num);
+    resize_num++;
+}
+
+void IncrementalSkulkerHT::migrate_step() {
+    if (old_ht != nullptr) {
+        // the old table is left as it is, so it answers for the strides not
+        // moved yet
+        old_ht->ResizeMoveStride(next_stride_id++, cur_ht, nullptr, {}, 0,
+                                 &failed_entries);
+        for (auto& entry : failed_entries) {
+            stash[entry.first] = entry.second;
+        }
+        failed_entries.clear();
+        if (next_stride_id == stride_num) {
+            delete old_ht;
+            old_ht = nullptr;
+        }
+    }
+
+    uint64_t retry_num = 0;
+    for (auto iter = stash.begin();
+         iter != stash.end() && retry_num < migrate_bush_num; retry_num++) {
+        if (cur_ht->Insert(iter->first, iter->second)) {
+            iter = stash.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool IncrementalSkulkerHT::Insert(uint64_t key, uint64_t value) {
+    migrate_step();
+
+    // a table is outgrown once its entries pass the bound, or some of them
+    // are left over in the stash; the next resize waits for the running one
+    if (old_ht == nullptr && (entry_cnt >= resize_bound || !stash.empty())) {
+        start_resize();
+    }
+
+    if (!cur_ht->Insert(key, value)) {
+        stash[key] = value;
+    }
+    entry_cnt++;
+    return true;
+}
+
+bool IncrementalSkulkerHT::Query(uint64_t key, uint64_t* value_ptr) {
+    migrate_step();
+    if (cur_ht->Query(key, value_ptr)) {
+        return true;
+    }
+    auto iter = stash.find(key);
+    if (iter != stash.end()) {
+        *value_ptr = iter->second;
+        return true;
+    }
+    return old_ht != nullptr && old_ht->Query(key, value_ptr);
+}
+
+bool IncrementalSkulkerHT::Update(uint64_t key, uint64_t value) {
+    migrate_step();
+    // a key not moved yet is only in the old table, and its new value goes
+    // along when its stride is moved
+    if (cur_ht->Update(key, value)) {
+        return true;
+    }
+    auto iter = stash.find(key);
+    if (iter != stash.end()) {
+        iter->second = value;
+        return true;
+    }
+    return old_ht != nullptr && old_ht->Update(key, value);
+}
+
+void IncrementalSkulkerHT::Free(uint64_t key) {
+    migrate_step();
+
+    uint64_t value;
+    bool found = cur_ht->Query(key, &value);
+    cur_ht->Free(key);
+    found |= stash.erase(key) > 0;
+    // a moved key is in both tables; freed in the old one too, a key not
+    // moved yet will not come back with its stride
+    if (old_ht != nullptr) {
+        found |= old_ht->Query(key, &value);
+        old_ht->Free(key);
+    }
+    entry_cnt -= found;
+}
+
+}  // namespace tinyptr
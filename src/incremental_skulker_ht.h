@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "skulker_ht.h"
+
+namespace tinyptr {
+
+// SkulkerHT that grows by itself, for a single thread
+// once the entries pass resize_threshold of the table, a table
+// resize_factor times larger takes over the inserts, and every operation
+// moves migrate_bush_num bushes of the old table into it; a lookup checks
+// the new table first, so no operation waits for a whole rehash
+// entries that do not fit the new table, moved or inserted, wait in a
+// stash, which every step drains by as many entries into the next table
+
+class IncrementalSkulkerHT {
+   public:
+    IncrementalSkulkerHT(uint64_t initial_size, double resize_threshold = 0.7,
+                         double resize_factor = 2.0,
+                         uint64_t migrate_bush_num = 8);
+    ~IncrementalSkulkerHT();
+
+    bool Insert(uint64_t key, uint64_t value);
+    bool Query(uint64_t key, uint64_t* value_ptr);
+    bool Update(uint64_t key, uint64_t value);
+    void Free(uint64_t key);
+
+    uint64_t GetResizeNum() const { return resize_num; }
+    bool IsResizing() const { return old_ht != nullptr; }
+    uint64_t GetStashSize() const { return stash.size(); }
+
+   protected:
+    void start_resize();
+    // moves the next stride of the old table, dropping it after the last,
+    // and tries up to migrate_bush_num stashed entries again
+    void migrate_step();
+
+   protected:
+    const double resize_threshold;
+    const double resize_factor;
+    const uint64_t migrate_bush_num;
+
+    SkulkerHT* cur_ht;
+    // the table being moved into cur_ht, null when not resizing
+    SkulkerHT* old_ht = nullptr;
+
+    uint64_t cur_size;
+    uint64_t entry_cnt = 0;
+    uint64_t resize_bound;
+
+    uint64_t stride_num = 0;
+    uint64_t next_stride_id = 0;
+
+    // entries in neither table; the copy of a moved one left in the old
+    // table is stale
+    std::unordered_map<uint64_t, uint64_t> stash;
+    std::vector<std::pair<uint64_t, uint64_t>> failed_entries;
+
+    uint64_t resize_num = 0;
+};
+
+}  // namespace tinyptr
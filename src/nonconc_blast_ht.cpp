@@ -102,7 +102,7 @@ NonConcBlastHT::NonConcBlastHT(uint64_t size, uint8_t quotienting_tail_length,
         cloud_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
     // Allocate a single aligned block
-    void* combined_mem;
+    combined_size = total_size;
     // if (posix_memalign(&combined_mem, 64, total_size) != 0) {
     //     // Handle allocation failure
     //     abort();
@@ -134,11 +134,7 @@ NonConcBlastHT::NonConcBlastHT(uint64_t size, uint16_t bin_size, bool if_resize)
 NonConcBlastHT::NonConcBlastHT(uint64_t size, bool if_resize)
     : NonConcBlastHT(size, 0, 127, if_resize) {}
 
-NonConcBlastHT::~NonConcBlastHT() {
-    munmap(cloud_tab, kCloudNum * kCloudByteLength);
-    munmap(byte_array, kBinNum * kBinSize * kEntryByteLength);
-    munmap(bin_cnt_head, kBinNum << 1);
-}
+NonConcBlastHT::~NonConcBlastHT() { munmap(combined_mem, combined_size); }
 
 bool NonConcBlastHT::Insert(uint64_t key, uint64_t value) {
 
@@ -370,7 +366,7 @@ bool NonConcBlastHT::Update(uint64_t key, uint64_t value) {
     return false;
 }
 
-void NonConcBlastHT::Free(uint64_t key) {
+bool NonConcBlastHT::Free(uint64_t key) {
 
     uint64_t truncated_key = key >> kBlastQuotientingLength;
     uint64_t masked_key = truncated_key << kBlastQuotientingLength;
@@ -458,7 +454,7 @@ void NonConcBlastHT::Free(uint64_t key) {
                         control_info -= (1 << kControlTinyPtrShift);
                     }
 
-                    return;
+                    return true;
 
                 } else {
                     uint8_t j = crystal_cnt - 1;
@@ -471,7 +467,7 @@ void NonConcBlastHT::Free(uint64_t key) {
 
                     control_info--;
 
-                    return;
+                    return true;
                 }
             }
         } else {
@@ -522,10 +518,12 @@ void NonConcBlastHT::Free(uint64_t key) {
                     control_info -= (1 << kControlTinyPtrShift);
                 }
 
-                return;
+                return true;
             }
         }
     }
+
+    return false;
 }
 
 void NonConcBlastHT::SetResizeStride(uint64_t stride_num) {
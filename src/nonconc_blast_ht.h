@@ -109,14 +109,20 @@ class NonConcBlastHT {
     bool Insert(uint64_t key, uint64_t value);
     bool Query(uint64_t key, uint64_t* value_ptr);
     bool Update(uint64_t key, uint64_t value);
-    void Free(uint64_t key);
+    // returns whether the key was there
+    bool Free(uint64_t key);
 
     void SetResizeStride(uint64_t stride_num);
     bool ResizeMoveStride(uint64_t stride_id, NonConcBlastHT* new_ht);
 
     void Scan4Stats();
 
+    uint64_t GetTableSize() const { return kCloudNum * 4 - 1; }
+
    protected:
+    void* combined_mem;
+    uint64_t combined_size;
+
     uint8_t* cloud_tab;
     uint8_t* byte_array;
     uint8_t* bin_cnt_head;
@@ -6,7 +6,7 @@ namespace tinyptr {
 
 O2VDereferenceTable64::O2VDereferenceTable64(int n) {
     p_tab = new O2VPo2CTable(n);
-    o_tab = new O2VOverflowTable;
+    o_tab = new O2VOverflowTable(n * kExpectedOverflowRatio);
 }
 
 uint8_t O2VDereferenceTable64::Allocate(uint64_t key, uint64_t value_1,
@@ -18,6 +18,9 @@ class O2VDereferenceTable64 : DereferenceTable {
     static constexpr size_t kBinSize = 127;
     static constexpr uint8_t kNullTinyPtr = 0;
     static constexpr uint8_t kOverflowTinyPtr = ((1 << 8) - 1);
+    // share of the n keys the overflow table is sized for up front; two
+    // choices of 127-slot bins rarely spill before the table is full
+    static constexpr double kExpectedOverflowRatio = 1.0 / 64;
 
    public:
     O2VDereferenceTable64() = delete;
@@ -2,37 +2,46 @@
 
 namespace tinyptr {
 
+O2VOverflowTable::O2VOverflowTable(uint64_t expected_entry_num,
+                                   bool if_concurrent)
+    : tab(expected_entry_num, if_concurrent) {}
+
 uint8_t O2VOverflowTable::Allocate(uint64_t key, uint64_t value_1,
                                    uint64_t value_2) {
-    tab[key] = VV{value_1, value_2};
+    uint64_t values[2] = {value_1, value_2};
+    tab.Insert(key, values, false);
     return ~0;
 }
 
 void O2VOverflowTable::UpdateFirst(uint64_t key, uint64_t value) {
-    tab[key].value_1 = value;
+    tab.Update(key, 0, value);
 }
 
 void O2VOverflowTable::UpdateSecond(uint64_t key, uint64_t value) {
-    tab[key].value_2 = value;
+    tab.Update(key, 1, value);
 }
 
 void O2VOverflowTable::QueryFirst(uint64_t key, uint64_t* value_ptr) {
-    *value_ptr = tab[key].value_1;
+    *value_ptr = QueryFirst(key);
 }
 
 uint64_t O2VOverflowTable::QueryFirst(uint64_t key) {
-    return tab[key].value_1;
+    uint64_t value = 0;
+    tab.Query(key, 0, &value);
+    return value;
 }
 
 void O2VOverflowTable::QuerySecond(uint64_t key, uint64_t* value_ptr) {
-    *value_ptr = tab[key].value_2;
+    *value_ptr = QuerySecond(key);
 }
 
 uint64_t O2VOverflowTable::QuerySecond(uint64_t key) {
-    return tab[key].value_2;
+    uint64_t value = 0;
+    tab.Query(key, 1, &value);
+    return value;
 }
 
 void O2VOverflowTable::Free(uint64_t key) {
-    tab.erase(key);
+    tab.Erase(key);
 }
 }  // namespace tinyptr
\ No newline at end of file
@@ -2,22 +2,19 @@
 
 #include <cstdint>
 #include <cstdlib>
-#include <map>
-#include <unordered_map>
+#include "utils/flat_overflow_map.h"
 
 namespace tinyptr {
 class O2VOverflowTable {
-   private:
-    struct VV {
-        uint64_t value_1, value_2;
-    };
-
    public:
-    O2VOverflowTable() = default;
+    // expected_entry_num sizes the map up front; it grows past it as needed
+    O2VOverflowTable(uint64_t expected_entry_num = 0,
+                     bool if_concurrent = false);
     ~O2VOverflowTable() = default;
 
    public:
     uint8_t Allocate(uint64_t key, uint64_t value_1, uint64_t value_2);
+    // updates of absent keys are dropped, and queries of them return 0
     void UpdateFirst(uint64_t key, uint64_t value);
     void UpdateSecond(uint64_t key, uint64_t value);
     void QueryFirst(uint64_t key, uint64_t* value_ptr);
@@ -27,6 +24,7 @@ class O2VOverflowTable {
     void Free(uint64_t key);
 
    private:
-    std::unordered_map<uint64_t, VV> tab;
+    // value_1, value_2
+    utils::FlatOverflowMap<2> tab;
 };
 }  // namespace tinyptr
\ No newline at end of file
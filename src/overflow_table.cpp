@@ -2,44 +2,28 @@
 
 namespace tinyptr {
 
-bool OverflowTable::allocation_check(uint64_t key) {
-#ifdef TINYPTR_DEREFTAB64_KEY_UNIQUENESS_CHECK
-    return tab.find(key) == tab.end();
-#else
-    return 1;
-#endif
-}
+OverflowTable::OverflowTable(uint64_t expected_entry_num, bool if_concurrent)
+    : tab(expected_entry_num, if_concurrent) {}
 
 // We leave the sanity check of keys' uniqueness to users and promise allocation will success
 uint8_t OverflowTable::Allocate(uint64_t key, uint64_t value) {
-    if (allocation_check(key)) {
-        tab[key] = value;
-        return ~0;
-    }
-    return 0;
+#ifdef TINYPTR_DEREFTAB64_KEY_UNIQUENESS_CHECK
+    bool check_unique = true;
+#else
+    bool check_unique = false;
+#endif
+    return tab.Insert(key, &value, check_unique) ? ~0 : 0;
 }
 
 bool OverflowTable::Update(uint64_t key, uint64_t value) {
-    if (tab.find(key) != tab.end()) {
-        tab[key] = value;
-        return 1;
-    }
-    return 0;
+    return tab.Update(key, 0, value);
 }
 
 bool OverflowTable::Query(uint64_t key, uint64_t* value_ptr) {
-    if (tab.find(key) != tab.end()) {
-        *value_ptr = tab[key];
-        return 1;
-    }
-    return 0;
+    return tab.Query(key, 0, value_ptr);
 }
 
 bool OverflowTable::Free(uint64_t key) {
-    if (tab.find(key) != tab.end()) {
-        tab.erase(key);
-        return 1;
-    }
-    return 0;
+    return tab.Erase(key);
 }
 }  // namespace tinyptr
\ No newline at end of file
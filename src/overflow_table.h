@@ -2,18 +2,15 @@
 
 #include <cstdint>
 #include <cstdlib>
-#include <map>
-#include <unordered_map>
+#include "utils/flat_overflow_map.h"
 
 namespace tinyptr {
 class OverflowTable {
    public:
-    OverflowTable() = default;
+    // expected_entry_num sizes the map up front; it grows past it as needed
+    OverflowTable(uint64_t expected_entry_num = 0, bool if_concurrent = false);
     ~OverflowTable() = default;
 
-   private:
-    bool allocation_check(uint64_t key);
-
    public:
     uint8_t Allocate(uint64_t key, uint64_t value);
     bool Update(uint64_t key, uint64_t value);
@@ -21,6 +18,6 @@ class OverflowTable {
     bool Free(uint64_t key);
 
    private:
-    std::unordered_map<uint64_t, uint64_t> tab;
+    utils::FlatOverflowMap<1> tab;
 };
 }  // namespace tinyptr
\ No newline at end of file
@@ -1,24 +1,76 @@
 #include "po2c_table.h"
+#include <immintrin.h>
 
 namespace tinyptr {
 
-Po2CTable::Bin::Bin() {
+template <typename BinHash>
+Po2CTable<BinHash>::Bin::Bin() {
     for (int i = 0; i < DereferenceTable64::kBinSize; ++i)
         bin[i].key = i + 2;
 }
 
-bool Po2CTable::Bin::full() {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Bin::full() {
     return cnt == DereferenceTable64::kBinSize;
 }
 
-uint8_t Po2CTable::Bin::count() {
+template <typename BinHash>
+uint8_t Po2CTable<BinHash>::Bin::count() {
     return cnt;
 }
 
+// keys sit in the even 64-bit lanes of the pairs, so a vector compare over
+// the pairs as they are, masked to those lanes, scans the keys without
+// splitting them from the values, which would cost Query a second line
+template <typename BinHash>
+uint8_t Po2CTable<BinHash>::Bin::match(uint64_t key) {
+    constexpr int kBinSize = DereferenceTable64::kBinSize;
+#if defined(__AVX512F__)
+    __m512i key_vec = _mm512_set1_epi64(key);
+    for (int i = 0; i < kBinSize; i += 4) {
+        __mmask8 lanes =
+            i + 4 <= kBinSize ? 0xFF : (1 << ((kBinSize - i) << 1)) - 1;
+        __m512i pairs = _mm512_maskz_loadu_epi64(lanes, &bin[i]);
+        uint32_t mask =
+            _mm512_mask_cmpeq_epi64_mask(lanes & 0x55, pairs, key_vec);
+        if (mask) {
+            return i + (_tzcnt_u32(mask) >> 1) + 1;
+        }
+    }
+#elif defined(__AVX2__)
+    __m256i key_vec = _mm256_set1_epi64x(key);
+    int i = 0;
+    for (; i + 2 <= kBinSize; i += 2) {
+        __m256i pairs =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&bin[i]));
+        uint32_t mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+                            _mm256_cmpeq_epi64(pairs, key_vec))) &
+                        0x5;
+        if (mask) {
+            return i + (_tzcnt_u32(mask) >> 1) + 1;
+        }
+    }
+    if (i < kBinSize && bin[i].key == key) {
+        return i + 1;
+    }
+#else
+    for (int i = 0; i < kBinSize; ++i)
+        if (bin[i].key == key)
+            return i + 1;
+#endif
+    return 0;
+}
+
 // 0 for null
 // i+1 for position i
 // there're at most 2 same value in the key field: 1) the pointer of free list 2) the key
-uint8_t Po2CTable::Bin::find(uint64_t key) {
+template <typename BinHash>
+uint8_t Po2CTable<BinHash>::Bin::find(uint64_t key) {
+    // free slots hold a free list pointer, at most kBinSize + 1, in the key
+    // field, so a larger key can only match a live slot
+    if (key > DereferenceTable64::kBinSize + 1)
+        return this->match(key);
+
     uint8_t key_cnt = 0;
     uint8_t key_pos[2];
     // not duplicate key
@@ -43,7 +95,9 @@ uint8_t Po2CTable::Bin::find(uint64_t key) {
     return 0;
 }
 
-bool Po2CTable::Bin::query(uint64_t key, uint8_t ptr, uint64_t* value_ptr) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Bin::query(uint64_t key, uint8_t ptr,
+                                    uint64_t* value_ptr) {
     assert(ptr < (1 << 7));
     assert(ptr);
     --ptr;
@@ -57,7 +111,8 @@ bool Po2CTable::Bin::query(uint64_t key, uint8_t ptr, uint64_t* value_ptr) {
     return 0;
 }
 
-bool Po2CTable::Bin::insert_check(uint64_t key) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Bin::insert_check(uint64_t key) {
 #ifdef TINYPTR_DEREFTAB64_KEY_UNIQUENESS_CHECK
     return !this->find(key);
 #else
@@ -68,7 +123,8 @@ bool Po2CTable::Bin::insert_check(uint64_t key) {
 // 0 for null (duplicate key), note this should hold higher priority than full bin
 // ~0 for full bin
 // i+1 for position i
-uint8_t Po2CTable::Bin::insert(uint64_t key, uint64_t value) {
+template <typename BinHash>
+uint8_t Po2CTable<BinHash>::Bin::insert(uint64_t key, uint64_t value) {
     if (!this->insert_check(key))
         return 0;
 
@@ -84,7 +140,9 @@ uint8_t Po2CTable::Bin::insert(uint64_t key, uint64_t value) {
     return tmp;
 }
 
-bool Po2CTable::Bin::update(uint64_t key, uint8_t ptr, uint64_t value) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Bin::update(uint64_t key, uint8_t ptr,
+                                     uint64_t value) {
     assert(ptr < (1 << 7));
     assert(ptr);
     --ptr;
@@ -97,7 +155,8 @@ bool Po2CTable::Bin::update(uint64_t key, uint8_t ptr, uint64_t value) {
     return 0;
 }
 
-bool Po2CTable::Bin::free(uint64_t key, uint8_t ptr) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Bin::free(uint64_t key, uint8_t ptr) {
     assert(ptr < (1 << 7));
     assert(ptr);
     --ptr;
@@ -112,7 +171,8 @@ bool Po2CTable::Bin::free(uint64_t key, uint8_t ptr) {
     return 0;
 }
 
-Po2CTable::Po2CTable(int n) {
+template <typename BinHash>
+Po2CTable<BinHash>::Po2CTable(int n) {
     bin_num =
         (n + DereferenceTable64::kBinSize - 1) / DereferenceTable64::kBinSize;
     tab = new Bin[bin_num];
@@ -121,14 +181,11 @@ Po2CTable::Po2CTable(int n) {
     while (hash_seed[1] == hash_seed[0])
         hash_seed[1] = rand();
     for (int i = 0; i < 2; ++i)
-        HashBin[i] =
-            std::function<uint64_t(uint64_t)>([=](uint64_t key) -> uint64_t {
-                return SlowXXHash64::hash(&key, sizeof(uint64_t), hash_seed[i]) %
-                       bin_num;
-            });
+        HashBin[i] = BinHash(hash_seed[i], bin_num);
 }
 
-uint8_t Po2CTable::Allocate(uint64_t key, uint64_t value) {
+template <typename BinHash>
+uint8_t Po2CTable<BinHash>::Allocate(uint64_t key, uint64_t value) {
     uint64_t hashbin[2];
     for (int i = 0; i < 2; ++i) {
         hashbin[i] = HashBin[i](key);
@@ -147,7 +204,8 @@ uint8_t Po2CTable::Allocate(uint64_t key, uint64_t value) {
     return ptr;
 }
 
-bool Po2CTable::Update(uint64_t key, uint8_t ptr, uint64_t value) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Update(uint64_t key, uint8_t ptr, uint64_t value) {
     assert(ptr != DereferenceTable64::kOverflowTinyPtr);
     assert(ptr != DereferenceTable64::kNullTinyPtr);
 
@@ -156,7 +214,8 @@ bool Po2CTable::Update(uint64_t key, uint8_t ptr, uint64_t value) {
     return tab[HashBin[flag](key)].update(key, ptr, value);
 }
 
-bool Po2CTable::Query(uint64_t key, uint8_t ptr, uint64_t* value_ptr) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Query(uint64_t key, uint8_t ptr, uint64_t* value_ptr) {
     assert(ptr != DereferenceTable64::kOverflowTinyPtr);
     assert(ptr != DereferenceTable64::kNullTinyPtr);
 
@@ -165,7 +224,8 @@ bool Po2CTable::Query(uint64_t key, uint8_t ptr, uint64_t* value_ptr) {
     return tab[HashBin[flag](key)].query(key, ptr, value_ptr);
 }
 
-bool Po2CTable::Free(uint64_t key, uint8_t ptr) {
+template <typename BinHash>
+bool Po2CTable<BinHash>::Free(uint64_t key, uint8_t ptr) {
     assert(ptr != DereferenceTable64::kOverflowTinyPtr);
     assert(ptr != DereferenceTable64::kNullTinyPtr);
 
@@ -174,4 +234,6 @@ bool Po2CTable::Free(uint64_t key, uint8_t ptr) {
     return tab[HashBin[flag](key)].free(key, ptr);
 }
 
+template class Po2CTable<XXHashBinPolicy>;
+
 }  // namespace tinyptr
\ No newline at end of file
@@ -3,20 +3,41 @@
 #include <bitset>
 #include <cassert>
 #include <cstdlib>
-#include <functional>
 #include <map>
 #include "common.h"
 #include "dereference_table_64.h"
 #include "utils/xxhash64.h"
 
 namespace tinyptr {
+
+// the default bin hash of Po2CTable, a plain type rather than a std::function
+// so the call inlines into every Allocate, Query and Free; another policy
+// only needs the same constructor and call operator, and an explicit
+// instantiation next to the one in po2c_table.cpp
+struct XXHashBinPolicy {
+    XXHashBinPolicy() = default;
+    XXHashBinPolicy(uint64_t seed, uint64_t bin_num)
+        : seed(seed), bin_num(bin_num) {}
+
+    __attribute__((always_inline)) inline uint64_t operator()(
+        uint64_t key) const {
+        return FastRange(HASH_FUNCTION(&key, sizeof(uint64_t), seed), bin_num);
+    }
+
+    uint64_t seed = 0;
+    uint64_t bin_num = 1;
+};
+
+template <typename BinHash = XXHashBinPolicy>
 class Po2CTable {
    private:
     struct KV {
         uint64_t key, value;
     };
 
-    class Bin {
+    // the pairs come first and the bin is cache line aligned, so no pair
+    // straddles two lines and the key scan loads whole vectors
+    class alignas(64) Bin {
        public:
         Bin();
         ~Bin() = default;
@@ -25,6 +46,9 @@ class Po2CTable {
         bool full();
         uint8_t count();
         uint8_t find(uint64_t key);
+        // like find, ignoring the free list: 0, or i+1 for the first slot
+        // whose key field holds key
+        uint8_t match(uint64_t key);
         bool query(uint64_t key, uint8_t ptr, uint64_t* value_ptr);
         bool insert_check(uint64_t key);
         uint8_t insert(uint64_t key, uint64_t value);
@@ -32,9 +56,9 @@ class Po2CTable {
         bool free(uint64_t key, uint8_t ptr);
 
        private:
+        KV bin[DereferenceTable64::kBinSize];
         uint8_t cnt = 0;
         uint8_t head = 1;
-        KV bin[DereferenceTable64::kBinSize];
     };
 
    public:
@@ -50,7 +74,7 @@ class Po2CTable {
     bool Free(uint64_t key, uint8_t ptr);
 
    private:
-    std::function<uint64_t(uint64_t)> HashBin[2];
+    BinHash HashBin[2];
     uint64_t bin_num;
     Bin* tab;
 };
@@ -3,17 +3,29 @@
 #include <sys/types.h>
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "blast_ht.h"
+#include "bolt_ht.h"
+#include "concurrent_bin_aware_chained_ht.h"
 #include "concurrent_byte_array_chained_ht.h"
 #include "concurrent_skulker_ht.h"
+#include "concurrent_yarded_tp_ht.h"
+#include "hybrid_ht.h"
+#include "utils/asymmetric_fence.h"
+#include "utils/event_ring.h"
+#include "utils/page_pool.h"
+#include "utils/spin_park.h"
 
 namespace tinyptr {
 
@@ -30,7 +42,8 @@ class ResizableHT {
 
     // Dynamic hash multiplier - randomized per instance for attack resistance
     uint64_t partition_hash_multiplier;
-    uint64_t partition_mask;  // part_num - 1, for fast bitwise AND
+    uint64_t partition_mask;  // max_part_num - 1, for fast bitwise AND
+    PartitionRouter router;
 
     // Compile-time assertions to ensure compatibility
     static_assert(
@@ -41,15 +54,56 @@ class ResizableHT {
     static_assert((1ULL << kInt64toCacheLineShift) == kCacheLineUint64Count,
                   "Cache line shift must match uint64 count");
 
+    // places where a thread blocks on another thread's progress
+    enum WaitSite : uint8_t {
+        kWaitGrace = 0,         // resizer waits for operations in flight
+        kWaitStageStart = 1,    // helper waits for the resizer to allocate
+        kWaitStrideDone = 2,    // resizer waits for helpers' strides
+        kWaitResizerLeave = 3,  // resizers wait for each other to detach
+        kWaitSiteNum = 4
+    };
+
+    // one finished resize; timestamps are steady_clock nanoseconds
+    struct ResizeRecord {
+        uint64_t part_id;
+        uint64_t split_id;    // the new upper half, or part_id when grown
+        uint64_t entry_num;   // as counted when the resize started
+        uint64_t old_size;
+        uint64_t new_size;    // of each table
+        uint64_t start_ns;    // resizing flag won
+        uint64_t grace_ns;    // in-flight writers drained
+        uint64_t alloc_ns;    // new table(s) ready
+        uint64_t migrate_ns;  // no stride left to claim
+        uint64_t drain_ns;    // every claimed stride finished
+        uint64_t swap_ns;     // new table(s) published, helpers detached
+        uint32_t helper_num;  // threads that joined the owner
+        uint32_t owner_stride_num;
+        uint32_t move_retry_num;  // migrations redone into larger tables
+        bool prepared;  // tables came from the background builder
+        bool forced;    // started by a failed insert rather than the count
+        bool hot;       // new table(s) are BlastHTs, for ResizableHybridHT
+    };
+
+    static constexpr uint64_t kResizeLogSize = 1 << 12;
+
+    // resizes a single insert may force before it reports failure
+    static constexpr uint8_t kInsertResizeRetryNum = 4;
+
+    // entries a handle buffers per partition before InsertBuffered flushes
+    static constexpr uint32_t kInsertBufferSize = 32;
+
    public:
     ResizableHT(uint64_t initial_size_per_part = 40000, uint64_t part_num = 0,
                 uint32_t thread_num = 0, bool if_stagger = false,
-                double resize_threshold = 0.7, double resize_factor = 2.0);
+                double resize_threshold = 0.7, double resize_factor = 2.0,
+                uint64_t max_part_num = 0, double prealloc_ratio = 1.0);
+
+    ~ResizableHT();
 
    protected:
     HTType** partitions;
     HTType** partitions_new;
-    uint64_t part_num;
+    uint64_t part_num;  // partitions at construction
     uint64_t initial_size_per_part;
     double resize_threshold;
     double resize_factor;
@@ -62,48 +116,526 @@ class ResizableHT {
     std::atomic<uint64_t>* part_resizing_thread_num;
     std::atomic<uint64_t>* part_resizing_stage;
     std::atomic<uint64_t>* part_resizing_stride_done;
-    std::atomic<uint64_t>* thread_working_lock;
+    std::atomic<uint64_t>* part_resizing_joined;
+
+    // linear-hashing style splitting: the routing hash picks one of
+    // max_part_num slots, and a partition of depth d owns every slot whose low
+    // d bits equal its id; a resize of a partition below max_part_depth splits
+    // it on bit d into itself and id | (1 << d) instead of growing it
+    uint64_t max_part_num;
+    uint8_t max_part_depth;
+    std::atomic<uint32_t>* part_route;
+    uint8_t* part_depth;
+    uint64_t* part_split_bit;  // bit the running resize splits on, 0 to grow
+    // set by a stride of the running resize whose entries did not all fit
+    std::atomic<bool>* part_move_failed;
+    std::atomic<uint64_t> part_split_num;
     int64_t** thread_part_cnt;
 
+    // per-handle write buffers of InsertBuffered, one per partition id,
+    // allocated on the handle's first buffered insert
+    struct InsertBuffer {
+        uint32_t size;
+        std::pair<uint64_t, uint64_t> entries[kInsertBufferSize];
+    };
+    InsertBuffer** thread_insert_buffer;
+
+    // quiescent-state epochs: a handle announces the global epoch for the
+    // length of an operation and is offline otherwise, so an announced epoch
+    // e means every earlier operation of that handle has finished, and a
+    // handle kept idle holds up nobody; handles blocked inside the resize
+    // protocol are offline as well
+    static constexpr uint64_t kEpochOffline = uint64_t(-1);
+    std::atomic<uint64_t> global_epoch;
+    std::atomic<uint64_t>* thread_epoch;
+
+    // replaced partitions, freed once every handle announced retire_epoch
+    std::vector<std::pair<HTType*, uint64_t>> retired_partitions;
+    std::atomic<uint64_t> retired_partition_num;
+    std::mutex retire_mutex;
+
+    // early warning: once a partition passes prealloc_ratio of its resize
+    // threshold, a background thread builds the table(s) its resize will
+    // need, so the resize itself starts on warm memory; a ratio of 1 or more,
+    // the default, turns this off and starts no thread
+    struct PreparedPartition {
+        uint64_t part_id;
+        uint64_t size;       // of each table
+        uint64_t split_bit;  // 0 when the resize grows a single table
+        HTType* tables[2];
+        bool hot;  // representation, only read for HybridHT
+    };
+    double prealloc_ratio;
+    bool if_prealloc;
+    int64_t* part_prealloc_threshold;
+    std::atomic<bool>* part_prealloc_requested;
+    std::vector<PreparedPartition> prealloc_queue;
+    std::vector<PreparedPartition> prepared_partitions;  // indexed by part id
+    uint64_t prealloc_building;  // part id under construction, or max_part_num
+    bool prealloc_stop;
+    std::mutex prealloc_mutex;
+    std::condition_variable prealloc_cv;
+    std::thread prealloc_thread;
+    std::atomic<uint64_t> prepared_resize_num;
+
+    // always on: a handful of clock reads per resize, none per operation
+    utils::EventRing<ResizeRecord, kResizeLogSize> resize_log;
+    uint64_t construct_ns;
+
+    // every table is allocated from here, and freed partitions return their
+    // memory to it instead of unmapping it
+    utils::PagePool page_pool;
+
+    utils::SpinParkSite wait_sites[kWaitSiteNum];
+
    private:
     std::set<uint64_t> free_handle;
     std::mutex handle_mutex;
 
    public:
     bool Insert(uint64_t handle, uint64_t key, uint64_t value);
+    // parks the entry in the handle's buffer for its partition; a full buffer
+    // goes in with one BulkInsert, so the epoch announcement, the resize
+    // checks and the hashing are paid once per batch and the destination
+    // fetches overlap
+    // buffered entries are invisible to Query, Update and Erase until the
+    // buffer is flushed; QueryBuffered also looks at the handle's own
+    // buffers; returns false when a flush this call triggered lost entries
+    bool InsertBuffered(uint64_t handle, uint64_t key, uint64_t value);
+    // writes out every buffer of the handle; FreeHandle flushes as well
+    bool Flush(uint64_t handle);
+    bool QueryBuffered(uint64_t handle, uint64_t key, uint64_t* value_ptr);
     bool Query(uint64_t handle, uint64_t key, uint64_t* value_ptr);
     bool Update(uint64_t handle, uint64_t key, uint64_t value);
     void Erase(uint64_t handle, uint64_t key);
 
+    utils::SpinParkStats GetWaitStats(WaitSite site) const {
+        return wait_sites[site].Snapshot();
+    }
+
     __attribute__((always_inline)) inline uint64_t GetHandle() {
         std::lock_guard<std::mutex> lock(handle_mutex);
         uint64_t handle = *free_handle.begin();
         free_handle.erase(handle);
-        thread_part_cnt[handle] = new int64_t[part_num + kCacheLineInt64Count];
+        thread_part_cnt[handle] =
+            new int64_t[max_part_num + kCacheLineInt64Count];
         memset(thread_part_cnt[handle], 0,
-               (part_num + kCacheLineInt64Count) * sizeof(int64_t));
+               (max_part_num + kCacheLineInt64Count) * sizeof(int64_t));
         return handle;
     }
 
     __attribute__((always_inline)) inline void FreeHandle(uint64_t handle) {
 
-        for (uint64_t part_id = 0; part_id < part_num; part_id++) {
+        if (thread_insert_buffer[handle]) {
+            Flush(handle);
+            delete[] thread_insert_buffer[handle];
+            thread_insert_buffer[handle] = nullptr;
+        }
+
+        for (uint64_t part_id = 0; part_id < max_part_num; part_id++) {
             uint64_t part_index = part_id << kInt64toCacheLineShift;
             part_cnt[part_index].fetch_add(thread_part_cnt[handle][part_id]);
         }
 
         delete[] thread_part_cnt[handle];
         thread_part_cnt[handle] = nullptr;
+        try_reclaim();
         std::lock_guard<std::mutex> lock(handle_mutex);
         free_handle.insert(handle);
     }
 
+    uint64_t GetPartitionNum() const {
+        return part_num + part_split_num.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetRetiredPartitionNum() const {
+        return retired_partition_num.load(std::memory_order_relaxed);
+    }
+
+    // resizes that found their tables already built in the background
+    uint64_t GetPreparedResizeNum() const {
+        return prepared_resize_num.load(std::memory_order_relaxed);
+    }
+
+    utils::PagePoolStats GetPagePoolStats() { return page_pool.GetStats(); }
+
+    void SetPagePoolCapacity(uint64_t bytes) { page_pool.SetCapacity(bytes); }
+
+    // the newest kResizeLogSize resizes, oldest first
+    std::vector<ResizeRecord> GetResizeLog() const {
+        return resize_log.Snapshot();
+    }
+
+    uint64_t GetResizeNum() const { return resize_log.PushedNum(); }
+
+    // one line per resize, times in microseconds; start is relative to the
+    // construction of the table, the rest are phase durations
+    void DumpResizeLog(std::ostream& out) const {
+        out << "Resize Log: " << GetResizeNum() << " resizes" << std::endl;
+        out << "\tpart\tsplit\tentries\told_size\tnew_size\tstart_us"
+               "\tgrace_us\talloc_us\tmigrate_us\tdrain_us\tswap_us"
+               "\thelpers\towner_strides\tprepared\tforced\thot"
+               "\tmove_retries"
+            << std::endl;
+        for (auto& record : GetResizeLog()) {
+            out << "\t" << record.part_id << "\t" << record.split_id << "\t"
+                << record.entry_num << "\t" << record.old_size << "\t"
+                << record.new_size << "\t"
+                << (record.start_ns - construct_ns) / 1000 << "\t"
+                << (record.grace_ns - record.start_ns) / 1000 << "\t"
+                << (record.alloc_ns - record.grace_ns) / 1000 << "\t"
+                << (record.migrate_ns - record.alloc_ns) / 1000 << "\t"
+                << (record.drain_ns - record.migrate_ns) / 1000 << "\t"
+                << (record.swap_ns - record.drain_ns) / 1000 << "\t"
+                << record.helper_num << "\t" << record.owner_stride_num
+                << "\t" << record.prepared << "\t" << record.forced << "\t"
+                << record.hot << "\t" << record.move_retry_num << std::endl;
+        }
+    }
+
    private:
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
     __attribute__((always_inline)) inline uint64_t get_part_id(uint64_t key) {
         // return XXH64(&key, sizeof(uint64_t), kHashSeed) & (part_num - 1);
-        key ^= kHashSeed;
-        key *= partition_hash_multiplier;
-        return (key >> 32) & partition_mask;
+        return part_route[router.Route(key) & partition_mask].load(
+            std::memory_order_acquire);
+    }
+
+    // the per-operation cost: a load of the shared epoch, which only moves at
+    // resizes, and a store to the handle's own line; the StoreLoad fence
+    // that orders the store before our reads of the routes and partitions is
+    // paid by the resizer, whose heavy fence may find us offline only if we
+    // will see everything it did before it
+    __attribute__((always_inline)) inline void enter_epoch(uint64_t handle) {
+        thread_epoch[handle].store(
+            global_epoch.load(std::memory_order_acquire),
+            std::memory_order_relaxed);
+        utils::AsymmetricLightFence();
+    }
+
+    __attribute__((always_inline)) inline void leave_epoch(uint64_t handle) {
+        go_offline(handle);
+    }
+
+    // an operation's epoch, left on every return
+    struct EpochGuard {
+        EpochGuard(ResizableHT* ht, uint64_t handle) : ht(ht), handle(handle) {
+            ht->enter_epoch(handle);
+        }
+        ~EpochGuard() { ht->leave_epoch(handle); }
+
+        ResizableHT* ht;
+        uint64_t handle;
+    };
+
+    // a handle about to block on other threads must not hold up their grace
+    // periods; it holds no partition reference at these points; grace
+    // waiters nap rather than park, so nobody needs waking
+    __attribute__((always_inline)) inline void go_offline(uint64_t handle) {
+        thread_epoch[handle].store(kEpochOffline, std::memory_order_release);
+    }
+
+    // a grace-period scan that skipped us ran its heavy fence before we
+    // announced, so the resize flag we check next is visible to us
+    void go_online(uint64_t handle) { enter_epoch(handle); }
+
+    // returns the new epoch; once every handle announced it, all operations
+    // that started before the advance have finished
+    uint64_t advance_epoch() { return global_epoch.fetch_add(1) + 1; }
+
+    void wait_grace_period(uint64_t epoch) {
+        utils::AsymmetricHeavyFence();
+        for (uint64_t i = 0; i < thread_num; i++) {
+            utils::SpinNapUntil(
+                thread_epoch[i << kInt64toCacheLineShift],
+                wait_sites[kWaitGrace],
+                [epoch](uint64_t announced) { return announced >= epoch; });
+        }
+    }
+
+    uint64_t min_announced_epoch() {
+        utils::AsymmetricHeavyFence();
+        uint64_t res = kEpochOffline;
+        for (uint64_t i = 0; i < thread_num; i++) {
+            res = std::min(res, thread_epoch[i << kInt64toCacheLineShift].load(
+                                    std::memory_order_acquire));
+        }
+        return res;
+    }
+
+    void retire_partition(HTType* part) {
+        uint64_t epoch = advance_epoch();
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        retired_partitions.emplace_back(part, epoch);
+        retired_partition_num.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // frees retired partitions nobody can still be reading; never blocks,
+    // but fences every running thread, so only FreeHandle and resizes call it
+    void try_reclaim() {
+        if (retired_partition_num.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(retire_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+
+        uint64_t safe_epoch = min_announced_epoch();
+        auto it = std::partition(
+            retired_partitions.begin(), retired_partitions.end(),
+            [safe_epoch](const std::pair<HTType*, uint64_t>& retired) {
+                return retired.second > safe_epoch;
+            });
+        for (auto reclaim = it; reclaim != retired_partitions.end();
+             ++reclaim) {
+            delete reclaim->first;
+        }
+        retired_partition_num.fetch_sub(retired_partitions.end() - it,
+                                        std::memory_order_relaxed);
+        retired_partitions.erase(it, retired_partitions.end());
+    }
+
+    bool flush_buffer(uint64_t handle, uint64_t part_id) {
+        InsertBuffer& buffer = thread_insert_buffer[handle][part_id];
+        if (buffer.size == 0) {
+            return true;
+        }
+
+        uint32_t routed_num, failed_num;
+        {
+            EpochGuard guard(this, handle);
+            check_join_resize(handle, part_id);
+            check_start_resize(handle, part_id);
+
+            // entries a split moved elsewhere since they were buffered go to
+            // the back
+            auto routed_end = std::partition(
+                buffer.entries, buffer.entries + buffer.size,
+                [this, part_id](const std::pair<uint64_t, uint64_t>& entry) {
+                    return get_part_id(entry.first) == part_id;
+                });
+            routed_num = routed_end - buffer.entries;
+
+            failed_num =
+                partitions[part_id]->BulkInsert(buffer.entries, routed_num);
+            thread_part_cnt[handle][part_id] += routed_num - failed_num;
+        }
+
+        // what did not fit, and what moved, takes the regular path, which
+        // resizes on failure
+        bool res = true;
+        for (uint32_t i = 0; i < failed_num; i++) {
+            res &= Insert(handle, buffer.entries[i].first,
+                          buffer.entries[i].second);
+        }
+        for (uint32_t i = routed_num; i < buffer.size; i++) {
+            res &= Insert(handle, buffer.entries[i].first,
+                          buffer.entries[i].second);
+        }
+
+        buffer.size = 0;
+        return res;
+    }
+
+    void set_part_size(uint64_t part_id) {
+        part_size[part_id] = partitions[part_id]->GetTableSize();
+        part_resize_threshold[part_id] =
+            static_cast<int64_t>(part_size[part_id] * resize_threshold);
+        part_prealloc_threshold[part_id] =
+            if_prealloc ? static_cast<int64_t>(part_resize_threshold[part_id] *
+                                               prealloc_ratio)
+                        : INT64_MAX;
+    }
+
+    // the size of the table(s) the next resize of part_id builds, and the bit
+    // it splits on
+    uint64_t next_part_size(uint64_t part_id, uint64_t* split_bit) {
+        uint64_t depth = part_depth[part_id];
+        *split_bit = depth < max_part_depth ? uint64_t(1) << depth : 0;
+        // each half of a split gets about half of the entries, so it keeps
+        // the old size and the work per resize stays bounded
+        return *split_bit ? part_size[part_id]
+                          : uint64_t(part_size[part_id] * resize_factor);
+    }
+
+    // a hybrid partition also needs to be told its representation
+    HTType* new_table(uint64_t size, bool hot) {
+        if constexpr (std::is_same<HTType, HybridHT>::value) {
+            return new HTType(size, true, resize_threshold, &page_pool, hot);
+        } else {
+            return new HTType(size, true, resize_threshold, &page_pool);
+        }
+    }
+
+    // hybrid partitions turn hot or cold at their resizes, from the traffic
+    // the current table has seen
+    bool next_part_hot(uint64_t part_id) {
+        if constexpr (std::is_same<HTType, HybridHT>::value) {
+            return partitions[part_id]->NextHot(
+                part_cnt[part_id << kInt64toCacheLineShift].load());
+        } else {
+            return false;
+        }
+    }
+
+    void build_tables(PreparedPartition& prepared) {
+        prepared.tables[0] = new_table(prepared.size, prepared.hot);
+        prepared.tables[1] = prepared.split_bit
+                                 ? new_table(prepared.size, prepared.hot)
+                                 : nullptr;
+    }
+
+    void request_prealloc(uint64_t part_id) {
+        if (part_prealloc_requested[part_id].load(std::memory_order_relaxed) ||
+            part_prealloc_requested[part_id].exchange(true)) {
+            return;
+        }
+
+        PreparedPartition request{part_id, 0, 0, {nullptr, nullptr}, false};
+        request.size = next_part_size(part_id, &request.split_bit);
+        request.hot = next_part_hot(part_id);
+        {
+            std::lock_guard<std::mutex> lock(prealloc_mutex);
+            prealloc_queue.push_back(request);
+        }
+        // resize owners wait on the same condition
+        prealloc_cv.notify_all();
+    }
+
+    void prealloc_worker() {
+        std::unique_lock<std::mutex> lock(prealloc_mutex);
+        while (true) {
+            prealloc_cv.wait(lock, [this] {
+                return prealloc_stop || !prealloc_queue.empty();
+            });
+            if (prealloc_stop) {
+                return;
+            }
+
+            PreparedPartition prepared = prealloc_queue.front();
+            prealloc_queue.erase(prealloc_queue.begin());
+            prealloc_building = prepared.part_id;
+            lock.unlock();
+
+            build_tables(prepared);
+
+            lock.lock();
+            // a request that raced with a resize may have left stale tables
+            std::swap(prepared_partitions[prepared.part_id], prepared);
+            prealloc_building = max_part_num;
+            prealloc_cv.notify_all();
+
+            lock.unlock();
+            delete prepared.tables[0];
+            delete prepared.tables[1];
+            lock.lock();
+        }
+    }
+
+    // hands the resize the tables prepared for it, or builds them here; a
+    // table the worker is already building is waited for rather than built
+    // twice
+    bool take_prepared(PreparedPartition& wanted) {
+        PreparedPartition prepared{
+            wanted.part_id, 0, 0, {nullptr, nullptr}, false};
+        if (if_prealloc) {
+            std::unique_lock<std::mutex> lock(prealloc_mutex);
+            prealloc_cv.wait(lock, [this, &wanted] {
+                return prealloc_building != wanted.part_id;
+            });
+            prealloc_queue.erase(
+                std::remove_if(prealloc_queue.begin(), prealloc_queue.end(),
+                               [&wanted](const PreparedPartition& request) {
+                                   return request.part_id == wanted.part_id;
+                               }),
+                prealloc_queue.end());
+            std::swap(prepared_partitions[wanted.part_id], prepared);
+        }
+
+        if (prepared.tables[0] && prepared.size == wanted.size &&
+            prepared.split_bit == wanted.split_bit &&
+            prepared.hot == wanted.hot) {
+            wanted.tables[0] = prepared.tables[0];
+            wanted.tables[1] = prepared.tables[1];
+            prepared_resize_num.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        delete prepared.tables[0];
+        delete prepared.tables[1];
+        build_tables(wanted);
+        return false;
+    }
+
+    // a stride that lost entries marks the resize, whose owner redoes it
+    bool move_stride(uint64_t part_id, uint64_t stage) {
+        uint64_t split_bit = part_split_bit[part_id];
+        bool res = partitions[part_id]->ResizeMoveStride(
+            stage, partitions_new[part_id],
+            split_bit ? partitions_new[part_id | split_bit] : nullptr, router,
+            split_bit);
+        if (!res) {
+            part_move_failed[part_id].store(true, std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    // makes the upper half of a finished split reachable; the caller still
+    // swaps in the lower half, after the routes so that a reader who finds
+    // the key missing there sees the new route when it re-checks
+    void publish_split(uint64_t part_id, uint64_t split_bit) {
+        uint64_t split_id = part_id | split_bit;
+        uint64_t part_index = part_id << kInt64toCacheLineShift;
+        uint64_t split_index = split_id << kInt64toCacheLineShift;
+
+        partitions[split_id] = partitions_new[split_id];
+        partitions_new[split_id] = nullptr;
+        set_part_size(split_id);
+
+        // the entries were divided by a hash bit, so is the count
+        int64_t moved_cnt = part_cnt[part_index].load() / 2;
+        part_cnt[split_index].store(moved_cnt);
+        part_cnt[part_index].fetch_sub(moved_cnt);
+
+        part_depth[part_id]++;
+        part_depth[split_id] = part_depth[part_id];
+
+        for (uint64_t slot = split_id; slot < max_part_num;
+             slot += split_bit << 1) {
+            part_route[slot].store(split_id);
+        }
+        part_split_num.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void finish_stride(uint64_t part_index) {
+        if (part_resizing_stride_done[part_index].fetch_add(1) + 1 ==
+            stride_num) {
+            utils::SpinParkNotify(part_resizing_stride_done[part_index],
+                                  wait_sites[kWaitStrideDone]);
+        }
+    }
+
+    // the resize owner holds one count until every helper has detached
+    void release_resizing(uint64_t part_index) {
+        while (true) {
+            utils::SpinParkUntil(part_resizing_thread_num[part_index],
+                                 wait_sites[kWaitResizerLeave],
+                                 [](uint64_t num) { return num == 1; });
+            uint64_t expected = 1;
+            if (part_resizing_thread_num[part_index].compare_exchange_strong(
+                    expected, 0)) {
+                break;
+            }
+        }
+        utils::SpinParkNotify(part_resizing_thread_num[part_index],
+                              wait_sites[kWaitResizerLeave]);
     }
 
     __attribute__((always_inline)) inline void check_join_resize(
@@ -121,25 +653,37 @@ class ResizableHT {
                            .compare_exchange_weak(resizing_thread_num,
                                                   resizing_thread_num + 1)) {
 
-                thread_working_lock[handle].store(uint64_t(-1));
+                go_offline(handle);
+                part_resizing_joined[part_index].fetch_add(
+                    1, std::memory_order_relaxed);
 
                 while (true) {
 
                     uint64_t stage = part_resizing_stage[part_index].load();
 
-                    if (stage > 0 && stage < stride_num) {
+                    if (stage == 0) {
+                        // the owner is still draining and allocating
+                        utils::SpinParkUntil(
+                            part_resizing_stage[part_index],
+                            wait_sites[kWaitStageStart],
+                            [](uint64_t stage) { return stage != 0; });
+                    } else if (stage < stride_num) {
                         if (part_resizing_stage[part_index]
                                 .compare_exchange_weak(stage, stage + 1)) {
 
-                            partitions[part_id]->ResizeMoveStride(
-                                stage, partitions_new[part_id]);
-                            part_resizing_stride_done[part_index]++;
+                            move_stride(part_id, stage);
+                            finish_stride(part_index);
                         }
-                    } else if (stage >= stride_num) {
+                    } else {
                         part_resizing_thread_num[part_index].fetch_sub(1);
-                        while (part_resizing_thread_num[part_index].load() > 0)
-                            ;
-                        thread_working_lock[handle].store(part_id);
+                        utils::SpinParkNotify(
+                            part_resizing_thread_num[part_index],
+                            wait_sites[kWaitResizerLeave]);
+                        utils::SpinParkUntil(
+                            part_resizing_thread_num[part_index],
+                            wait_sites[kWaitResizerLeave],
+                            [](uint64_t num) { return num == 0; });
+                        go_online(handle);
                         break;
                     }
                 }
@@ -147,6 +691,14 @@ class ResizableHT {
         }
     }
 
+    // the epoch we come back with may already belong to the next resize of
+    // this partition, whose grace period then skips us; joining it (as helpers
+    // do on their way out) keeps our insert out of the partition being moved
+    void rejoin_partition(uint64_t handle, uint64_t part_id) {
+        go_online(handle);
+        check_join_resize(handle, part_id);
+    }
+
     __attribute__((always_inline)) inline void check_start_resize(
         uint64_t handle, uint64_t part_id) {
 
@@ -158,138 +710,185 @@ class ResizableHT {
             thread_part_cnt[handle][part_id] = 0;
         }
 
-        if (part_cnt[part_index].load() > part_resize_threshold[part_id]) {
-            uint64_t expected = 0;
-            // std::cerr << "start resize" << std::endl;
-
-            if (part_resizing_thread_num[part_index].compare_exchange_weak(
-                    expected, uint64_t(1))) {
+        int64_t cnt = part_cnt[part_index].load();
+        if (cnt > part_prealloc_threshold[part_id]) {
+            request_prealloc(part_id);
+        }
 
-                if (part_cnt[part_index].load() <=
-                    part_resize_threshold[part_id]) {
-                    part_resizing_stage[part_index].store(stride_num);
+        if (cnt > part_resize_threshold[part_id]) {
+            start_resize(handle, part_id, nullptr);
+        }
+    }
 
-                    uint64_t expected = 1;
-                    while (!part_resizing_thread_num[part_index]
-                                .compare_exchange_weak(expected, 0)) {
-                        expected = 1;
-                    }
+    // resizes part_id once its count passed the threshold, or, given the
+    // table an insert just failed on, unconditionally unless that table has
+    // been replaced meanwhile; returns without waiting when another thread
+    // holds the resizing flag
+    void start_resize(uint64_t handle, uint64_t part_id, HTType* full_part) {
+        uint64_t part_index = part_id << kInt64toCacheLineShift;
+        uint64_t expected = 0;
 
-                    part_resizing_stage[part_index].store(0);
-                    return;
-                }
+        if (part_resizing_thread_num[part_index].compare_exchange_weak(
+                expected, uint64_t(1))) {
 
-                // auto start_time = std::chrono::high_resolution_clock::now();
+            go_offline(handle);
+            ResizeRecord record{};
+            record.start_ns = now_ns();
+            record.forced = full_part != nullptr;
 
-                thread_working_lock[handle].store(uint64_t(-1));
+            // the previous owner leaves the stage at stride_num so that its
+            // late helpers can still detach; only the next owner resets it
+            part_resizing_stage[part_index].store(0);
 
-                for (uint64_t i = 0; i < thread_num; i++) {
-                    while (thread_working_lock[i << kInt64toCacheLineShift]
-                               .load() == part_id)
-                        ;
-                }
+            // someone else got there first
+            if (full_part ? partitions[part_id] != full_part
+                          : part_cnt[part_index].load() <=
+                                part_resize_threshold[part_id]) {
+                part_resizing_stage[part_index].store(stride_num);
+                utils::SpinParkNotify(part_resizing_stage[part_index],
+                                      wait_sites[kWaitStageStart]);
 
-                // std::chrono::high_resolution_clock::time_point my_time[10];
-                // my_time[0] = std::chrono::high_resolution_clock::now();
+                release_resizing(part_index);
 
-                partitions_new[part_id] =
-                    new HTType(uint64_t(part_size[part_id] * resize_factor),
-                               true, resize_threshold);
+                rejoin_partition(handle, part_id);
+                return;
+            }
 
-                // std::cerr << "allocated partitions_new[" << part_id
-                //   << "]: " << partitions_new[part_id] << std::endl;
+            record.part_id = part_id;
+            record.entry_num = part_cnt[part_index].load();
+            record.old_size = part_size[part_id];
+
+            // writers that missed the resizing flag are still in the old
+            // partition until their handle announces the next epoch
+            wait_grace_period(advance_epoch());
+            record.grace_ns = now_ns();
+            // every handle moved past the epochs of earlier retirements
+            try_reclaim();
+
+            PreparedPartition wanted{part_id, 0, 0, {nullptr, nullptr}, false};
+            wanted.size = next_part_size(part_id, &wanted.split_bit);
+            wanted.hot = next_part_hot(part_id);
+            record.prepared = take_prepared(wanted);
+            record.hot = wanted.hot;
+            record.split_id = part_id | wanted.split_bit;
+            record.new_size = wanted.size;
+
+            uint64_t split_bit = wanted.split_bit;
+            part_split_bit[part_id] = split_bit;
+            partitions_new[part_id] = wanted.tables[0];
+            if (split_bit) {
+                partitions_new[part_id | split_bit] = wanted.tables[1];
+            }
 
-                partitions[part_id]->SetResizeStride(stride_num);
+            // std::cerr << "allocated partitions_new[" << part_id
+            //   << "]: " << partitions_new[part_id] << std::endl;
 
-                uint64_t stage = part_resizing_stage[part_index].load();
+            partitions[part_id]->SetResizeStride(stride_num);
+            record.alloc_ns = now_ns();
 
-                // my_time[1] = std::chrono::high_resolution_clock::now();
+            uint64_t stage = part_resizing_stage[part_index].load();
 
-                while (stage < stride_num) {
-                    if (part_resizing_stage[part_index].compare_exchange_weak(
-                            stage, stage + 1)) {
-                        partitions[part_id]->ResizeMoveStride(
-                            stage, partitions_new[part_id]);
-                        part_resizing_stride_done[part_index]++;
+            while (stage < stride_num) {
+                if (part_resizing_stage[part_index].compare_exchange_weak(
+                        stage, stage + 1)) {
+                    if (stage == 0) {
+                        utils::SpinParkNotify(
+                            part_resizing_stage[part_index],
+                            wait_sites[kWaitStageStart]);
                     }
+                    move_stride(part_id, stage);
+                    finish_stride(part_index);
+                    record.owner_stride_num++;
                 }
-
-                // my_time[2] = std::chrono::high_resolution_clock::now();
-
-                while (part_resizing_stride_done[part_index].load() <
-                       stride_num)
-                    ;
-
-                // my_time[3] = std::chrono::high_resolution_clock::now();
-
-                HTType* tmp = partitions[part_id];
-                partitions[part_id] = partitions_new[part_id];
-
-                for (uint64_t i = 0; i < thread_num; i++) {
-                    while (thread_working_lock[i << kInt64toCacheLineShift]
-                               .load() == part_id)
-                        ;
+            }
+            record.migrate_ns = now_ns();
+
+            utils::SpinParkUntil(
+                part_resizing_stride_done[part_index],
+                wait_sites[kWaitStrideDone],
+                [this](uint64_t done) { return done >= stride_num; });
+
+            // writers wait for the resize, so the old table is as it was and
+            // the whole move starts over, into tables twice as large; the
+            // owner does it alone, helpers are on their way out
+            while (part_move_failed[part_id].exchange(false)) {
+                delete partitions_new[part_id];
+                if (split_bit) {
+                    delete partitions_new[part_id | split_bit];
                 }
-
-                // std::cerr << "delete old partitions[" << part_id << "]: " << tmp
-                //           << std::endl;
-
-                delete tmp;
-                partitions_new[part_id] = nullptr;
-
-                // Update part_size with actual table size from GetTableSize()
-                part_size[part_id] = partitions[part_id]->GetTableSize();
-                part_resize_threshold[part_id] =
-                    static_cast<int64_t>(part_size[part_id] * resize_threshold);
-
-                // std::cerr << "part_cnt: " << part_cnt[part_index].load()
-                //           << std::endl;
-                // std::cerr << "part_size: " << part_size[part_id] << std::endl;
-                // std::cerr << "part_resize_threshold: "
-                //           << part_resize_threshold[part_id] << std::endl;
-
-                part_resizing_stride_done[part_index].store(0);
-
-                thread_working_lock[handle].store(part_id);
-
-                // my_time[4] = std::chrono::high_resolution_clock::now();
-
-                uint64_t expected = 1;
-                while (
-                    !part_resizing_thread_num[part_index].compare_exchange_weak(
-                        expected, 0)) {
-                    expected = 1;
+                wanted.size <<= 1;
+                build_tables(wanted);
+                partitions_new[part_id] = wanted.tables[0];
+                if (split_bit) {
+                    partitions_new[part_id | split_bit] = wanted.tables[1];
                 }
 
-                part_resizing_stage[part_index].store(0);
-
-                // my_time[5] = std::chrono::high_resolution_clock::now();
+                for (uint64_t retry_stage = 0; retry_stage < stride_num;
+                     retry_stage++) {
+                    move_stride(part_id, retry_stage);
+                }
+                record.move_retry_num++;
+            }
+            record.new_size = wanted.size;
+            record.drain_ns = now_ns();
 
-                // for (int i = 0; i < 5; i++) {
-                //     std::cerr << "time " << i << ": "
-                //               << std::chrono::duration_cast<
-                //                      std::chrono::milliseconds>(my_time[i + 1] -
-                //                                                 my_time[i])
-                //                      .count()
-                //               << "ms" << std::endl;
-                // }
+            HTType* tmp = partitions[part_id];
+            if (split_bit) {
+                publish_split(part_id, split_bit);
             }
+            partitions[part_id] = partitions_new[part_id];
+
+            // readers may still be in the old partition; it is freed
+            // asynchronously once they have all moved on
+            retire_partition(tmp);
+            partitions_new[part_id] = nullptr;
+
+            // Update part_size with actual table size from GetTableSize()
+            set_part_size(part_id);
+            part_prealloc_requested[part_id].store(false);
+
+            // std::cerr << "part_cnt: " << part_cnt[part_index].load()
+            //           << std::endl;
+            // std::cerr << "part_size: " << part_size[part_id] << std::endl;
+            // std::cerr << "part_resize_threshold: "
+            //           << part_resize_threshold[part_id] << std::endl;
+
+            part_resizing_stride_done[part_index].store(0);
+
+            // helpers that join while we wait for them to detach are
+            // counted towards the next resize of this partition
+            record.helper_num = part_resizing_joined[part_index].exchange(0);
+            release_resizing(part_index);
+            record.swap_ns = now_ns();
+            resize_log.Push(record);
+
+            rejoin_partition(handle, part_id);
+            try_reclaim();
         }
-    };
+    }
 };
 
 template <typename HTType>
 ResizableHT<HTType>::ResizableHT(uint64_t initial_size_per_part_,
                                  uint64_t part_num_, uint32_t thread_num_,
                                  bool if_stagger_, double resize_threshold_,
-                                 double resize_factor_)
+                                 double resize_factor_, uint64_t max_part_num_,
+                                 double prealloc_ratio_)
     : initial_size_per_part(initial_size_per_part_),
       part_num(part_num_),
       thread_num(thread_num_),
       resize_threshold(resize_threshold_),
       resize_factor(resize_factor_),
       if_stagger(if_stagger_),  // Add this initialization
-      kHashSeed(rand() & ((1 << 16) - 1)) {
+      kHashSeed(rand() & ((1 << 16) - 1)),
+      max_part_num(max_part_num_),
+      part_split_num(0),
+      global_epoch(1),
+      retired_partition_num(0),
+      prealloc_ratio(prealloc_ratio_),
+      if_prealloc(prealloc_ratio_ < 1),
+      prealloc_stop(false),
+      prepared_resize_num(0) {
 
     if (thread_num == 0) {
         thread_num = std::max(uint32_t(4),
@@ -309,17 +908,45 @@ ResizableHT<HTType>::ResizableHT(uint64_t initial_size_per_part_,
     }
     part_num = tmp_part_num;
 
+    uint8_t part_depth_init = 0;
+    while ((uint64_t(1) << part_depth_init) < part_num) {
+        part_depth_init++;
+    }
+
+    max_part_depth = part_depth_init;
+    while ((uint64_t(1) << max_part_depth) < max_part_num) {
+        max_part_depth++;
+    }
+    max_part_num = uint64_t(1) << max_part_depth;
+
     // Initialize hash parameters - randomized multiplier for attack resistance
     partition_hash_multiplier =
         kHashSeed | 1;  // Ensure odd number for good distribution
     partition_hash_multiplier = (partition_hash_multiplier << 32) |
                                 (rand() | 1);  // 64-bit odd multiplier
-    partition_mask = part_num - 1;  // Fast bitwise mask for power-of-2
-
-    partitions = new HTType*[part_num];
-    partitions_new = new HTType*[part_num];
-    part_size = new uint64_t[part_num];
-    part_resize_threshold = new int64_t[part_num];
+    partition_mask = max_part_num - 1;  // Fast bitwise mask for power-of-2
+    router = {kHashSeed, partition_hash_multiplier};
+
+    partitions = new HTType*[max_part_num]();
+    partitions_new = new HTType*[max_part_num]();
+    part_size = new uint64_t[max_part_num];
+    part_resize_threshold = new int64_t[max_part_num];
+    part_route = new std::atomic<uint32_t>[max_part_num];
+    part_depth = new uint8_t[max_part_num];
+    part_split_bit = new uint64_t[max_part_num]();
+    part_move_failed = new std::atomic<bool>[max_part_num];
+    part_prealloc_threshold = new int64_t[max_part_num];
+    part_prealloc_requested = new std::atomic<bool>[max_part_num];
+    prepared_partitions.assign(
+        max_part_num, PreparedPartition{0, 0, 0, {nullptr, nullptr}, false});
+    prealloc_building = max_part_num;
+
+    for (uint64_t i = 0; i < max_part_num; i++) {
+        part_route[i] = i & (part_num - 1);
+        part_depth[i] = part_depth_init;
+        part_prealloc_requested[i] = false;
+        part_move_failed[i] = false;
+    }
 
     for (uint64_t i = 0; i < part_num; i++) {
         double frac =
@@ -331,65 +958,199 @@ ResizableHT<HTType>::ResizableHT(uint64_t initial_size_per_part_,
             size_i = initial_size_per_part;
         }
 
-        partitions[i] = new HTType(size_i, true, resize_threshold);
+        partitions[i] = new_table(size_i, false);
 
         // Update part_size with actual table size from GetTableSize()
-        part_size[i] = partitions[i]->GetTableSize();
-        part_resize_threshold[i] =
-            static_cast<int64_t>(part_size[i] * resize_threshold);
+        set_part_size(i);
     }
 
-    part_cnt = new std::atomic<int64_t>[part_num << kInt64toCacheLineShift];
+    part_cnt = new std::atomic<int64_t>[max_part_num << kInt64toCacheLineShift];
     part_resizing_thread_num =
-        new std::atomic<uint64_t>[part_num << kInt64toCacheLineShift];
+        new std::atomic<uint64_t>[max_part_num << kInt64toCacheLineShift];
     part_resizing_stage =
-        new std::atomic<uint64_t>[part_num << kInt64toCacheLineShift];
+        new std::atomic<uint64_t>[max_part_num << kInt64toCacheLineShift];
     part_resizing_stride_done =
-        new std::atomic<uint64_t>[part_num << kInt64toCacheLineShift];
-    thread_working_lock =
+        new std::atomic<uint64_t>[max_part_num << kInt64toCacheLineShift];
+    part_resizing_joined =
+        new std::atomic<uint64_t>[max_part_num << kInt64toCacheLineShift];
+    thread_epoch =
         new std::atomic<uint64_t>[thread_num << kInt64toCacheLineShift];
     thread_part_cnt = new int64_t*[thread_num << kInt64toCacheLineShift];
+    thread_insert_buffer =
+        new InsertBuffer*[thread_num << kInt64toCacheLineShift]();
 
-    for (uint64_t i = 0; i < part_num; i++) {
+    for (uint64_t i = 0; i < max_part_num; i++) {
         part_cnt[i << kInt64toCacheLineShift] = 0;
         part_resizing_thread_num[i << kInt64toCacheLineShift] = 0;
         part_resizing_stride_done[i << kInt64toCacheLineShift] = 0;
         part_resizing_stage[i << kInt64toCacheLineShift] = 0;
+        part_resizing_joined[i << kInt64toCacheLineShift] = 0;
     }
 
     for (uint64_t i = 0; i < thread_num; i++) {
-        thread_working_lock[i << kInt64toCacheLineShift] = uint64_t(-1);
+        thread_epoch[i << kInt64toCacheLineShift] = kEpochOffline;
         free_handle.insert(i << kInt64toCacheLineShift);
     }
+
+    construct_ns = now_ns();
+
+    if (if_prealloc) {
+        prealloc_thread = std::thread(&ResizableHT::prealloc_worker, this);
+    }
+}
+
+template <typename HTType>
+ResizableHT<HTType>::~ResizableHT() {
+    if (prealloc_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(prealloc_mutex);
+            prealloc_stop = true;
+        }
+        prealloc_cv.notify_all();
+        prealloc_thread.join();
+    }
+    for (auto& prepared : prepared_partitions) {
+        delete prepared.tables[0];
+        delete prepared.tables[1];
+    }
+    for (auto& retired : retired_partitions) {
+        delete retired.first;
+    }
+    for (uint64_t i = 0; i < max_part_num; i++) {
+        delete partitions[i];
+    }
+
+    delete[] partitions;
+    delete[] partitions_new;
+    delete[] part_size;
+    delete[] part_resize_threshold;
+    delete[] part_cnt;
+    delete[] part_resizing_thread_num;
+    delete[] part_resizing_stage;
+    delete[] part_resizing_stride_done;
+    delete[] part_resizing_joined;
+    delete[] part_route;
+    delete[] part_depth;
+    delete[] part_split_bit;
+    delete[] part_move_failed;
+    delete[] part_prealloc_threshold;
+    delete[] part_prealloc_requested;
+    delete[] thread_epoch;
+    delete[] thread_part_cnt;
+    delete[] thread_insert_buffer;
 }
 
 template <typename HTType>
 bool ResizableHT<HTType>::Insert(uint64_t handle, uint64_t key,
                                  uint64_t value) {
     uint64_t part_id = get_part_id(key);
-    thread_working_lock[handle].store(part_id);
+    EpochGuard guard(this, handle);
+
+    for (uint8_t retry = 0;; retry++) {
+        // a split may move the key to another partition while we wait inside
+        // the resize protocol
+        while (true) {
+            check_join_resize(handle, part_id);
+            check_start_resize(handle, part_id);
+
+            uint64_t routed_id = get_part_id(key);
+            if (routed_id == part_id) {
+                break;
+            }
+            part_id = routed_id;
+        }
 
-    check_join_resize(handle, part_id);
-    check_start_resize(handle, part_id);
+        HTType* part = partitions[part_id];
+        if (part->Insert(key, value)) {
+            thread_part_cnt[handle][part_id]++;
+            return true;
+        }
+
+        if (retry == kInsertResizeRetryNum) {
+            return false;
+        }
 
-    auto res = partitions[part_id]->Insert(key, value);
-    thread_part_cnt[handle][part_id] += res;
+        // the table filled up (a saturated cloud or bin pair) before the
+        // count reached the threshold; resize it, or let the resize already
+        // under way finish, and try again
+        start_resize(handle, part_id, part);
+        part_id = get_part_id(key);
+    }
+}
+
+template <typename HTType>
+bool ResizableHT<HTType>::InsertBuffered(uint64_t handle, uint64_t key,
+                                         uint64_t value) {
+    if (__builtin_expect(thread_insert_buffer[handle] == nullptr, 0)) {
+        thread_insert_buffer[handle] = new InsertBuffer[max_part_num];
+        for (uint64_t part_id = 0; part_id < max_part_num; part_id++) {
+            thread_insert_buffer[handle][part_id].size = 0;
+        }
+    }
 
-    thread_working_lock[handle].store(uint64_t(-1));
+    uint64_t part_id = get_part_id(key);
+    InsertBuffer& buffer = thread_insert_buffer[handle][part_id];
+    buffer.entries[buffer.size++] = std::make_pair(key, value);
+
+    if (buffer.size == kInsertBufferSize) {
+        return flush_buffer(handle, part_id);
+    }
+    return true;
+}
+
+template <typename HTType>
+bool ResizableHT<HTType>::Flush(uint64_t handle) {
+    if (thread_insert_buffer[handle] == nullptr) {
+        return true;
+    }
+
+    bool res = true;
+    for (uint64_t part_id = 0; part_id < max_part_num; part_id++) {
+        res &= flush_buffer(handle, part_id);
+    }
     return res;
 }
 
+template <typename HTType>
+bool ResizableHT<HTType>::QueryBuffered(uint64_t handle, uint64_t key,
+                                        uint64_t* value_ptr) {
+    if (thread_insert_buffer[handle]) {
+        // the key was buffered under one of the partitions its slot belonged
+        // to; splits only deepen a route, so the deepest one holds the newest
+        // value, and within a buffer the last entry does
+        uint64_t slot = router.Route(key) & partition_mask;
+        for (int depth = max_part_depth; depth >= 0; depth--) {
+            uint64_t part_id = slot & ((uint64_t(1) << depth) - 1);
+            InsertBuffer& buffer = thread_insert_buffer[handle][part_id];
+            for (uint32_t i = buffer.size; i > 0; i--) {
+                if (buffer.entries[i - 1].first == key) {
+                    *value_ptr = buffer.entries[i - 1].second;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return Query(handle, key, value_ptr);
+}
+
 template <typename HTType>
 bool ResizableHT<HTType>::Query(uint64_t handle, uint64_t key,
                                 uint64_t* value_ptr) {
     uint64_t part_id = get_part_id(key);
-    thread_working_lock[handle].store(part_id);
+    EpochGuard guard(this, handle);
 
     // check_join_resize(handle, part_id);
 
     auto res = partitions[part_id]->Query(key, value_ptr);
 
-    thread_working_lock[handle].store(uint64_t(-1));
+    // a split that finished after we routed may have moved the key
+    uint64_t routed_id;
+    while (!res && (routed_id = get_part_id(key)) != part_id) {
+        part_id = routed_id;
+        res = partitions[part_id]->Query(key, value_ptr);
+    }
+
     return res;
 }
 
@@ -397,30 +1158,49 @@ template <typename HTType>
 bool ResizableHT<HTType>::Update(uint64_t handle, uint64_t key,
                                  uint64_t value) {
     uint64_t part_id = get_part_id(key);
-    thread_working_lock[handle].store(part_id);
+    EpochGuard guard(this, handle);
 
-    check_join_resize(handle, part_id);
+    while (true) {
+        check_join_resize(handle, part_id);
+
+        uint64_t routed_id = get_part_id(key);
+        if (routed_id == part_id) {
+            break;
+        }
+        part_id = routed_id;
+    }
 
     auto res = partitions[part_id]->Update(key, value);
 
-    thread_working_lock[handle].store(uint64_t(-1));
     return res;
 }
 
 template <typename HTType>
 void ResizableHT<HTType>::Erase(uint64_t handle, uint64_t key) {
     uint64_t part_id = get_part_id(key);
-    thread_working_lock[handle].store(part_id);
+    EpochGuard guard(this, handle);
 
-    check_join_resize(handle, part_id);
+    while (true) {
+        check_join_resize(handle, part_id);
+
+        uint64_t routed_id = get_part_id(key);
+        if (routed_id == part_id) {
+            break;
+        }
+        part_id = routed_id;
+    }
 
     partitions[part_id]->Free(key);
     thread_part_cnt[handle][part_id]--;
-    thread_working_lock[handle].store(uint64_t(-1));
 }
 
 using ResizableSkulkerHT = ResizableHT<ConcurrentSkulkerHT>;
 using ResizableByteArrayChainedHT = ResizableHT<ConcurrentByteArrayChainedHT>;
 using ResizableBlastHT = ResizableHT<BlastHT>;
+using ResizableHybridHT = ResizableHT<HybridHT>;
+using ResizableYardedTPHT = ResizableHT<ConcurrentYardedTPHT>;
+using ResizableBoltHT = ResizableHT<BoltHT>;
+using ResizableBinAwareChainedHT = ResizableHT<ConcurrentBinAwareChainedHT>;
+using ResizableSameBinChainedHT = ResizableHT<ConcurrentSameBinChainedHT>;
 
 }  // namespace tinyptr
\ No newline at end of file
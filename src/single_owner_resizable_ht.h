@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "byte_array_chained_ht.h"
+#include "common.h"
+#include "nonconc_blast_ht.h"
+#include "skulker_ht.h"
+
+namespace tinyptr {
+
+// how SingleOwnerResizableHT builds, sizes and migrates its tables; the
+// default fits tables built like the ones ResizableHT hosts
+template <typename HTType>
+struct ResizableTablePolicy {
+    static HTType* NewTable(uint64_t size, double resize_threshold) {
+        return new HTType(size, true, resize_threshold);
+    }
+
+    static uint64_t TableSize(const HTType* ht) { return ht->GetTableSize(); }
+
+    // moves every entry of ht to new_ht; ht is only read, so it is intact
+    // if new_ht runs out of room
+    static bool MoveAll(HTType* ht, HTType* new_ht) {
+        ht->SetResizeStride(1);
+        return ht->ResizeMoveStride(0, new_ht);
+    }
+};
+
+// NonConcBlastHT takes no resize threshold
+template <>
+struct ResizableTablePolicy<NonConcBlastHT> {
+    static NonConcBlastHT* NewTable(uint64_t size) {
+        return new NonConcBlastHT(size, true);
+    }
+
+    static uint64_t TableSize(const NonConcBlastHT* ht) {
+        return ht->GetTableSize();
+    }
+
+    static void Prefetch(NonConcBlastHT* ht, uint64_t key) {
+        ht->prefetch_key(key);
+    }
+
+    static bool MoveAll(NonConcBlastHT* ht, NonConcBlastHT* new_ht) {
+        ht->SetResizeStride(1);
+        return ht->ResizeMoveStride(0, new_ht);
+    }
+};
+
+// ByteArrayChainedHT has no size-only constructor for resizing, as the
+// literal bin sizes its callers pass would make it ambiguous; it takes no
+// resize threshold either
+template <>
+struct ResizableTablePolicy<ByteArrayChainedHT> {
+    static ByteArrayChainedHT* NewTable(uint64_t size) {
+        return new ByteArrayChainedHT(size, 0, 127, true);
+    }
+
+    static uint64_t TableSize(const ByteArrayChainedHT* ht) {
+        return ht->GetTableSize();
+    }
+
+    static bool MoveAll(ByteArrayChainedHT* ht, ByteArrayChainedHT* new_ht) {
+        ht->SetResizeStride(1);
+        return ht->ResizeMoveStride(0, new_ht);
+    }
+};
+
+// a policy may leave out the resize threshold of NewTable and the Prefetch
+// hook when its table has no use for them
+template <typename Policy, typename = void>
+struct PolicyTakesResizeThreshold : std::false_type {};
+
+template <typename Policy>
+struct PolicyTakesResizeThreshold<
+    Policy, std::void_t<decltype(Policy::NewTable(uint64_t(0), 0.0))>>
+    : std::true_type {};
+
+template <typename Policy, typename HTType, typename = void>
+struct PolicyHasPrefetch : std::false_type {};
+
+template <typename Policy, typename HTType>
+struct PolicyHasPrefetch<Policy, HTType,
+                         std::void_t<decltype(Policy::Prefetch(
+                             std::declval<HTType*>(), uint64_t(0)))>>
+    : std::true_type {};
+
+// ResizableHT for a table only one thread ever touches, such as one of many
+// per-core shards: no handles, epochs or atomics, the counts are plain
+// integers, and a partition past its threshold is migrated in one go by the
+// insert that finds it there
+template <typename HTType, typename TablePolicy = ResizableTablePolicy<HTType>>
+class SingleOwnerResizableHT {
+   public:
+    static constexpr uint8_t kInsertResizeRetryNum = 4;
+
+    const uint64_t kHashSeed;
+
+    SingleOwnerResizableHT(uint64_t initial_size_per_part = 40000,
+                           uint64_t part_num = 16,
+                           double resize_threshold = 0.7,
+                           double resize_factor = 2.0)
+        : kHashSeed(rand() & ((1 << 16) - 1)),
+          resize_threshold(resize_threshold),
+          resize_factor(resize_factor) {
+        // a table no larger than the old one could never take its entries
+        assert(resize_factor > 1);
+
+        uint64_t tmp_part_num = 1;
+        while (tmp_part_num < part_num) {
+            tmp_part_num <<= 1;
+        }
+        part_mask = tmp_part_num - 1;
+
+        uint64_t multiplier = ((kHashSeed | 1) << 32) | (rand() | 1);
+        router = {kHashSeed, multiplier};
+
+        partitions.resize(tmp_part_num);
+        for (Partition& part : partitions) {
+            part.table = build_table(initial_size_per_part);
+            part.cnt = 0;
+            set_part_size(part);
+        }
+    }
+
+    ~SingleOwnerResizableHT() {
+        for (Partition& part : partitions) {
+            delete part.table;
+        }
+    }
+
+    SingleOwnerResizableHT(const SingleOwnerResizableHT&) = delete;
+    SingleOwnerResizableHT& operator=(const SingleOwnerResizableHT&) = delete;
+
+    bool Insert(uint64_t key, uint64_t value) {
+        Partition& part = get_part(key);
+        if (part.cnt >= part.resize_threshold) {
+            resize(part);
+        }
+
+        for (uint8_t retry = 0;; retry++) {
+            if (part.table->Insert(key, value)) {
+                part.cnt++;
+                return true;
+            }
+            if (retry == kInsertResizeRetryNum) {
+                return false;
+            }
+            // the table filled up before the count reached the threshold
+            resize(part);
+        }
+    }
+
+    bool Query(uint64_t key, uint64_t* value_ptr) {
+        return get_part(key).table->Query(key, value_ptr);
+    }
+
+    bool Update(uint64_t key, uint64_t value) {
+        return get_part(key).table->Update(key, value);
+    }
+
+    // returns whether the key was there; the count only drops if it was
+    bool Erase(uint64_t key) {
+        Partition& part = get_part(key);
+        if (part.table->Free(key)) {
+            part.cnt--;
+            return true;
+        }
+        return false;
+    }
+
+    // lets a caller holding a batch of keys overlap their cache misses
+    __attribute__((always_inline)) inline void Prefetch(uint64_t key) {
+        if constexpr (PolicyHasPrefetch<TablePolicy, HTType>::value) {
+            TablePolicy::Prefetch(get_part(key).table, key);
+        }
+    }
+
+    uint64_t GetResizeNum() const { return resize_num; }
+
+   private:
+    // everything an operation needs about its partition sits together
+    struct Partition {
+        HTType* table;
+        int64_t cnt;
+        int64_t resize_threshold;
+        uint64_t size;
+    };
+
+    __attribute__((always_inline)) inline Partition& get_part(uint64_t key) {
+        return partitions[router.Route(key) & part_mask];
+    }
+
+    HTType* build_table(uint64_t size) {
+        if constexpr (PolicyTakesResizeThreshold<TablePolicy>::value) {
+            return TablePolicy::NewTable(size, resize_threshold);
+        } else {
+            return TablePolicy::NewTable(size);
+        }
+    }
+
+    void set_part_size(Partition& part) {
+        part.size = TablePolicy::TableSize(part.table);
+        part.resize_threshold =
+            static_cast<int64_t>(part.size * resize_threshold);
+    }
+
+    // a new table that cannot take every entry is dropped for one twice as
+    // large, as ResizableHT does
+    void resize(Partition& part) {
+        uint64_t new_size = uint64_t(part.size * resize_factor);
+        HTType* new_table;
+        while (true) {
+            new_table = build_table(new_size);
+            if (TablePolicy::MoveAll(part.table, new_table)) {
+                break;
+            }
+            delete new_table;
+            new_size <<= 1;
+        }
+
+        delete part.table;
+        part.table = new_table;
+        set_part_size(part);
+        resize_num++;
+    }
+
+    double resize_threshold;
+    double resize_factor;
+    uint64_t part_mask;
+    PartitionRouter router;
+    std::vector<Partition> partitions;
+    uint64_t resize_num = 0;
+};
+
+using SingleOwnerSkulkerHT = SingleOwnerResizableHT<SkulkerHT>;
+using SingleOwnerBlastHT = SingleOwnerResizableHT<NonConcBlastHT>;
+using SingleOwnerByteArrayChainedHT =
+    SingleOwnerResizableHT<ByteArrayChainedHT>;
+
+}  // namespace tinyptr
@@ -1,13 +1,11 @@
 #include "skulker_ht.h"
 #include <sys/mman.h>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 
 namespace tinyptr {
 
-uint8_t SkulkerHT::kBushLookup[256];
-struct SkulkerHTBushLookupInitializer skulker_ht_bush_lookup_initializer;
-
 uint8_t SkulkerHT::AutoQuotTailLength(uint64_t size) {
     uint8_t res = 16;
     // making 4 *size > 1 << res > 2 * size
@@ -41,7 +39,8 @@ uint64_t SkulkerHT::GenBaseHashInverse(uint64_t base_hash_factor,
 }
 
 SkulkerHT::SkulkerHT(uint64_t size, uint8_t quotienting_tail_length,
-                     uint16_t bin_size)
+                     uint16_t bin_size, bool if_resize, double resize_threshold,
+                     utils::PagePool* pool)
     : kHashSeed1(rand() & ((1 << 16) - 1)),
       kHashSeed2(65536 + rand()),
       kQuotientingTailLength(quotienting_tail_length
@@ -66,14 +65,18 @@ SkulkerHT::SkulkerHT(uint64_t size, uint8_t quotienting_tail_length,
       kControlOffset(kBushByteLength - kControlByteLength),
       kSkulkerOffset(kControlOffset - 1),
       kBinSize(bin_size),
-      kBinNum((size * kSkulkerRatio + kBinSize - 1) / kBinSize),
+      kBinNum(if_resize ? static_cast<uint64_t>(
+                              std::ceil((size * kSkulkerRatio + kBinSize - 1) /
+                                        kBinSize * resize_threshold))
+                        : (size * kSkulkerRatio + kBinSize - 1) / kBinSize),
       kTinyPtrOffset(0),
       kKeyOffset(1),
       kValueOffset(kKeyOffset + kQuotKeyByteLength),
       kBaseHashFactor(GenBaseHashFactor(kBushCapacity, kQuotientingTailMask)),
       kBaseHashInverse(GenBaseHashInverse(kBaseHashFactor, kQuotientingTailMask,
                                           kQuotientingTailLength)),
-      kFastDivisionReciprocal(kFastDivisionBase / kBushCapacity + 1) {
+      kFastDivisionReciprocal(kFastDivisionBase / kBushCapacity + 1),
+      page_pool(pool) {
 
     assert(4 * size >= (1ULL << (kQuotientingTailLength)));
     assert(bin_size < 128);
@@ -95,10 +98,19 @@ SkulkerHT::SkulkerHT(uint64_t size, uint8_t quotienting_tail_length,
         bush_size_aligned + byte_array_size_aligned + bin_cnt_size_aligned;
 
     // Allocate a single aligned block
-    void* combined_mem;
-
-    combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
-                        MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    combined_size = total_size;
+
+    // a table built while resizing is faulted in as it fills, instead of
+    // stalling the operation that built it
+    if (page_pool) {
+        combined_mem = page_pool->Acquire(total_size);
+    } else if (if_resize) {
+        combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+                            MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    } else {
+        combined_mem = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+                            MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    }
 
     uint8_t* base =
         reinterpret_cast<uint8_t*>(((uintptr_t)(combined_mem) + 63) & ~static_cast<uintptr_t>(63));
@@ -144,6 +156,19 @@ SkulkerHT::SkulkerHT(uint64_t size, uint8_t quotienting_tail_length,
 SkulkerHT::SkulkerHT(uint64_t size, uint16_t bin_size)
     : SkulkerHT(size, 0, bin_size) {}
 
+SkulkerHT::SkulkerHT(uint64_t size, bool if_resize, double resize_threshold,
+                     utils::PagePool* pool)
+    : SkulkerHT(size, 0, uint16_t(127), if_resize, resize_threshold, pool) {}
+
+SkulkerHT::~SkulkerHT() {
+    if (page_pool) {
+        page_pool->Release(combined_mem, combined_size);
+    } else {
+        munmap(combined_mem, combined_size);
+    }
+    delete[] play_entry;
+}
+
 bool SkulkerHT::Insert(uint64_t key, uint64_t value) {
     uint64_t base_id = hash_base_id(key);
 
@@ -163,14 +188,9 @@ bool SkulkerHT::Insert(uint64_t key, uint64_t value) {
         bush_tab + (bush_id << kBushIdShiftOffset) + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     if ((control_info >> in_bush_offset) & 1) {
 
@@ -291,14 +311,9 @@ bool SkulkerHT::Query(uint64_t key, uint64_t* value_ptr) {
         bush_tab + (bush_id << kBushIdShiftOffset) + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -368,14 +383,9 @@ bool SkulkerHT::Update(uint64_t key, uint64_t value) {
         bush_tab + (bush_id << kBushIdShiftOffset) + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -421,7 +431,7 @@ bool SkulkerHT::Update(uint64_t key, uint64_t value) {
     return false;
 }
 
-void SkulkerHT::Free(uint64_t key) {
+bool SkulkerHT::Free(uint64_t key) {
     uint64_t base_id = hash_base_id(key);
 
     // do fast division
@@ -440,14 +450,9 @@ void SkulkerHT::Free(uint64_t key) {
         bush_tab + (bush_id << kBushIdShiftOffset) + kControlOffset);
     uint16_t control_info_before_item = control_info >> in_bush_offset;
 
-    uint8_t item_cnt = uint8_t(_popcnt32(control_info));
-    uint8_t before_item_cnt = uint8_t(_popcnt32(control_info_before_item));
-
-    // uint8_t item_cnt = kBushLookup[control_info & kByteMask] +
-    //                    kBushLookup[(control_info >> kByteShift)];
-    // uint8_t before_item_cnt =
-    //     kBushLookup[control_info_before_item & kByteMask] +
-    //     kBushLookup[(control_info_before_item >> kByteShift)];
+    uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+    uint8_t before_item_cnt =
+        uint8_t(utils::Popcount64(control_info_before_item));
 
     uint8_t overload_flag = item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
 
@@ -497,7 +502,7 @@ void SkulkerHT::Free(uint64_t key) {
                     ptab_lift_to_bush(pre_tiny_ptr, pre_deref_key,
                                       exhibitor_ptr);
                 }
-                return;
+                return true;
             }
         }
 
@@ -510,7 +515,7 @@ void SkulkerHT::Free(uint64_t key) {
 
         uintptr_t pre_deref_key = base_id;
 
-        ptab_free(pre_tiny_ptr, pre_deref_key, key);
+        bool res = ptab_free(pre_tiny_ptr, pre_deref_key, key);
 
         if (*pre_tiny_ptr == 0 && before_item_cnt > exhibitor_num) {
             control_info &= ~(1u << in_bush_offset);
@@ -531,11 +536,106 @@ void SkulkerHT::Free(uint64_t key) {
                                   exhibitor_num, item_cnt);
             }
         }
+        return res;
     }
+
+    return false;
 }
 
 uint64_t SkulkerHT::QueryEntryCnt() {
     return query_entry_cnt;
 }
 
+uint32_t SkulkerHT::BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                               uint32_t entry_num) {
+    uint32_t failed_num = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        if (!Insert(entries[i].first, entries[i].second)) {
+            entries[failed_num++] = entries[i];
+        }
+    }
+    return failed_num;
+}
+
+void SkulkerHT::SetResizeStride(uint64_t stride_num) {
+    resize_stride_size = ceil(1.0 * kBushNum / (stride_num));
+}
+
+bool SkulkerHT::ResizeMoveStride(
+    uint64_t stride_id, SkulkerHT* new_ht, SkulkerHT* split_ht,
+    PartitionRouter router, uint64_t split_bit,
+    std::vector<std::pair<uint64_t, uint64_t>>* failed_entries) {
+
+    uint64_t stride_id_start = stride_id * resize_stride_size;
+    uint64_t stride_id_end = stride_id_start + resize_stride_size;
+    if (stride_id_end > kBushNum) {
+        stride_id_end = kBushNum;
+    }
+
+    // as ConcurrentSkulkerHT::ResizeMoveStride, without the queue: there is
+    // no other writer to overlap the inserts with
+    bool res = true;
+    auto move_entry = [&](uint64_t key, uint64_t value) {
+        SkulkerHT* target_ht =
+            (split_ht && (router.Route(key) & split_bit)) ? split_ht : new_ht;
+        if (!target_ht->Insert(key, value)) {
+            res = false;
+            if (failed_entries) {
+                failed_entries->emplace_back(key, value);
+            }
+        }
+    };
+    auto move_chain = [&](uint8_t* pre_tiny_ptr, uint64_t base_id) {
+        uintptr_t pre_deref_key = base_id;
+        while (*pre_tiny_ptr != 0) {
+            uint8_t* entry =
+                ptab_query_entry_address(pre_deref_key, *pre_tiny_ptr);
+            uint64_t ins_key = hash_key_rebuild(
+                *reinterpret_cast<uint64_t*>(entry + kKeyOffset), base_id);
+            move_entry(ins_key,
+                       *reinterpret_cast<uint64_t*>(entry + kValueOffset));
+            pre_tiny_ptr = entry + kTinyPtrOffset;
+            pre_deref_key = reinterpret_cast<uintptr_t>(entry);
+        }
+    };
+
+    for (uint64_t bush_id = stride_id_start; bush_id < stride_id_end;
+         bush_id++) {
+        uint8_t* bush = &bush_tab[(bush_id << kBushIdShiftOffset)];
+        uint16_t control_info =
+            *reinterpret_cast<uint16_t*>(bush + kControlOffset);
+        uint8_t item_cnt = uint8_t(utils::Popcount64(control_info));
+        uint8_t overload_flag =
+            item_cnt > (kInitSkulkerNum + kInitExhibitorNum);
+
+        uint8_t exhibitor_num = kInitExhibitorNum - overload_flag;
+
+        for (uint8_t in_bush_offset = 0, moved_cnt = 0;
+             in_bush_offset < kBushCapacity; in_bush_offset++) {
+            if (!((control_info >> in_bush_offset) & 1)) {
+                continue;
+            }
+
+            uint64_t base_id = bush_id * kBushCapacity + in_bush_offset;
+
+            if (item_cnt - moved_cnt <= exhibitor_num) {
+                uint8_t* entry =
+                    bush + (item_cnt - moved_cnt - 1) * kEntryByteLength;
+                uint64_t ins_key = hash_key_rebuild(
+                    *reinterpret_cast<uint64_t*>(entry + kKeyOffset), base_id);
+                move_entry(ins_key,
+                           *reinterpret_cast<uint64_t*>(entry + kValueOffset));
+                move_chain(entry + kTinyPtrOffset, base_id);
+            } else {
+                move_chain(bush + kSkulkerOffset -
+                               (item_cnt - exhibitor_num - moved_cnt - 1),
+                           base_id);
+            }
+            moved_cnt++;
+        }
+    }
+
+    return res;
+}
+
 }  // namespace tinyptr
@@ -8,16 +8,17 @@
 #include <cstdint>
 #include <functional>
 #include <iostream>
+#include <utility>
+#include <vector>
 #include "common.h"
 #include "utils/cache_line_size.h"
+#include "utils/page_pool.h"
+#include "utils/rank_select.h"
 
 namespace tinyptr {
 
 class SkulkerHT {
-    friend struct SkulkerHTBushLookupInitializer;
-
    public:
-    static uint8_t kBushLookup[256];
     static const uint8_t kByteMask = 0xFF;
     static const uint8_t kByteShift = 8;
 
@@ -80,9 +81,16 @@ class SkulkerHT {
                                 uint64_t mod_bit_length);
 
    public:
-    SkulkerHT(uint64_t size, uint8_t quotienting_tail_length,
-              uint16_t bin_size);
+    // with a pool, the table memory is taken from and returned to it
+    SkulkerHT(uint64_t size, uint8_t quotienting_tail_length, uint16_t bin_size,
+              bool if_resize = false, double resize_threshold = 1.0,
+              utils::PagePool* pool = nullptr);
     SkulkerHT(uint64_t size, uint16_t bin_size);
+    // the constructor the resizing tables build their tables with
+    SkulkerHT(uint64_t size, bool if_resize, double resize_threshold,
+              utils::PagePool* pool = nullptr);
+
+    ~SkulkerHT();
 
    protected:
     __attribute__((always_inline)) inline uint64_t hash_1(uint64_t key) {
@@ -192,7 +200,7 @@ class SkulkerHT {
         }
     }
 
-    __attribute__((always_inline)) inline void ptab_free(
+    __attribute__((always_inline)) inline bool ptab_free(
         uint8_t* pre_tiny_ptr, uintptr_t pre_deref_key,
         uint64_t quotiented_N_reshifted_key) {
 
@@ -208,7 +216,7 @@ class SkulkerHT {
             }
             cur_tiny_ptr = cur_entry + kTinyPtrOffset;
         } else {
-            return;
+            return false;
         }
 
         while (*cur_tiny_ptr != 0) {
@@ -224,7 +232,7 @@ class SkulkerHT {
         }
 
         if (aiming_entry == nullptr) {
-            return;
+            return false;
         }
 
         uint8_t tmp = aiming_entry[kTinyPtrOffset];
@@ -241,6 +249,7 @@ class SkulkerHT {
         }
         head = cur_in_bin_pos;
         *pre_tiny_ptr = 0;
+        return true;
     }
 
     __attribute__((always_inline)) inline void ptab_lift_to_bush(
@@ -295,18 +304,10 @@ class SkulkerHT {
             *i = *(i + 1);
         }
 
-        // get the base_id of the last exhibitor
-        uint8_t hide_in_bush_offset = 0;
-        uint16_t control_info_before_spilled =
-            control_info >> (hide_in_bush_offset + 1);
-
-        while (kBushLookup[control_info_before_spilled & kByteMask] +
-                   kBushLookup[(control_info_before_spilled >> kByteShift)] >=
-               exhibitor_num) {
-            hide_in_bush_offset++;
-            control_info_before_spilled =
-                control_info >> (hide_in_bush_offset + 1);
-        }
+        // get the base_id of the last exhibitor, the one with exhibitor_num
+        // - 1 items above it
+        uint32_t hide_in_bush_offset =
+            utils::Select64(control_info, item_cnt - exhibitor_num);
 
         uintptr_t spilled_base_id = bush_offset + hide_in_bush_offset;
 
@@ -346,17 +347,8 @@ class SkulkerHT {
         }
 
         // get the base_id of the first skulker
-        uint8_t raid_in_bush_offset = 0;
-        uint16_t control_info_before_spilled =
-            control_info >> (raid_in_bush_offset + 1);
-
-        while (kBushLookup[control_info_before_spilled & kByteMask] +
-                   kBushLookup[(control_info_before_spilled >> kByteShift)] >
-               exhibitor_num) {
-            raid_in_bush_offset++;
-            control_info_before_spilled =
-                control_info >> (raid_in_bush_offset + 1);
-        }
+        uint32_t raid_in_bush_offset =
+            utils::Select64(control_info, item_cnt - exhibitor_num - 1);
 
         uint8_t* pre_tiny_ptr = exhibitor_ptr + kTinyPtrOffset;
         uintptr_t pre_deref_key = bush_offset + raid_in_bush_offset;
@@ -368,11 +360,33 @@ class SkulkerHT {
     bool Insert(uint64_t key, uint64_t value);
     bool Query(uint64_t key, uint64_t* value_ptr);
     bool Update(uint64_t key, uint64_t value);
-    void Free(uint64_t key);
+    // returns whether the key was there
+    bool Free(uint64_t key);
 
     uint64_t QueryEntryCnt();
 
+    // returns how many entries did not fit, moved to the front of entries
+    uint32_t BulkInsert(std::pair<uint64_t, uint64_t>* entries,
+                        uint32_t entry_num);
+
+    // the table stays as it is while its entries are copied out, so it can be
+    // moved a stride at a time between other operations
+    // with failed_entries, the entries that did not fit are appended to it
+    void SetResizeStride(uint64_t stride_num);
+    bool ResizeMoveStride(
+        uint64_t stride_id, SkulkerHT* new_ht, SkulkerHT* split_ht = nullptr,
+        PartitionRouter router = {}, uint64_t split_bit = 0,
+        std::vector<std::pair<uint64_t, uint64_t>>* failed_entries = nullptr);
+
+    uint64_t GetTableSize() const { return kBushNum * 4; }
+
    protected:
+    utils::PagePool* page_pool;
+    void* combined_mem;
+    uint64_t combined_size;
+
+    uint64_t resize_stride_size;
+
     uint8_t* bush_tab;
     uint8_t* byte_array;
     uint8_t* base_tab;
@@ -383,17 +397,4 @@ class SkulkerHT {
     uint64_t query_entry_cnt = 0;
 };
 
-struct SkulkerHTBushLookupInitializer {
-    SkulkerHTBushLookupInitializer() {
-        for (int i = 0; i < 256; ++i) {
-            SkulkerHT::kBushLookup[i] = 0;
-            int tmp = i;
-            while (tmp) {
-                SkulkerHT::kBushLookup[i]++;
-                tmp -= tmp & (-tmp);
-            }
-        }
-    };
-};
-
 }  // namespace tinyptr
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <linux/membarrier.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+namespace utils {
+
+// a StoreLoad fence split between a hot side and a rare side
+// the light fence only stops the compiler; the heavy fence makes every
+// running thread of the process execute a full barrier, so a light-side
+// store followed by a load is ordered against a heavy-side store followed by
+// a load; the heavy side uses an expedited membarrier, or where the kernel
+// lacks it, an mprotect whose TLB shootdown interrupts the same threads
+
+__attribute__((always_inline)) inline void AsymmetricLightFence() {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+class AsymmetricHeavyFenceImpl {
+   public:
+    static AsymmetricHeavyFenceImpl& Get() {
+        static AsymmetricHeavyFenceImpl impl;
+        return impl;
+    }
+
+    void Fence() {
+        if (if_membarrier) {
+            syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mprotect_mutex);
+        // the page has to be dirty for the downgrade to flush every TLB
+        mprotect(dummy_page, 1, PROT_READ | PROT_WRITE);
+        __atomic_add_fetch(dummy_page, 1, __ATOMIC_SEQ_CST);
+        mprotect(dummy_page, 1, PROT_READ);
+    }
+
+   private:
+    AsymmetricHeavyFenceImpl() {
+        long cmds = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0);
+        if_membarrier =
+            cmds > 0 && (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+            syscall(SYS_membarrier,
+                    MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+        if (if_membarrier) {
+            return;
+        }
+
+        void* page = mmap(nullptr, 1, PROT_READ,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (page == MAP_FAILED) {
+            perror("asymmetric fence: mmap");
+            abort();
+        }
+        dummy_page = static_cast<int*>(page);
+        // a page that is never faulted in is never in any TLB
+        mlock(dummy_page, 1);
+    }
+
+    bool if_membarrier;
+    int* dummy_page = nullptr;
+    std::mutex mprotect_mutex;
+};
+
+inline void AsymmetricHeavyFence() { AsymmetricHeavyFenceImpl::Get().Fence(); }
+
+}  // namespace utils
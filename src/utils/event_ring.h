@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace utils {
+
+// lock-free multi-producer ring of fixed-size records, keeping the newest
+// kCapacity of them
+// a writer claims a ticket with one fetch_add and publishes its slot with a
+// sequence number; readers copy a snapshot and drop slots that were being
+// rewritten while they copied them
+
+template <typename Record, uint64_t kCapacity>
+class EventRing {
+    static_assert((kCapacity & (kCapacity - 1)) == 0,
+                  "ring capacity must be a power of 2");
+
+   public:
+    EventRing() : head(0), slots(new Slot[kCapacity]) {
+        for (uint64_t i = 0; i < kCapacity; i++) {
+            slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Push(const Record& record) {
+        uint64_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[ticket & (kCapacity - 1)];
+
+        // odd while the record is being written
+        slot.seq.store(ticket << 1 | 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.seq.store((ticket + 1) << 1, std::memory_order_release);
+    }
+
+    // oldest first
+    std::vector<Record> Snapshot() const {
+        std::vector<Record> res;
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+        res.reserve(end - begin);
+
+        for (uint64_t ticket = begin; ticket < end; ticket++) {
+            const Slot& slot = slots[ticket & (kCapacity - 1)];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != (ticket + 1) << 1) {
+                continue;
+            }
+            Record record = slot.record;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq) {
+                res.push_back(record);
+            }
+        }
+        return res;
+    }
+
+    // every record ever pushed, including overwritten ones
+    uint64_t PushedNum() const { return head.load(std::memory_order_relaxed); }
+
+   private:
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        Record record;
+    };
+
+    std::atomic<uint64_t> head;
+    std::unique_ptr<Slot[]> slots;
+};
+
+}  // namespace utils
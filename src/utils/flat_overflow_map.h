@@ -0,0 +1,346 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace utils {
+
+// flat linear-probing map from 64-bit keys to kValueNum 64-bit values, for
+// the few entries that spill out of a dereference table
+// the capacity is a power of 2, sized up front from the expected number of
+// entries; erased slots become tombstones, and once live slots and
+// tombstones fill 3/4 of the map it is rebuilt, twice as large if over half
+// of it is live, in place otherwise
+// a concurrent map guards each key with one of kStripeNum version stripes,
+// like the chained tables' per-base versions: writers make the stripe odd
+// for the write, readers take no lock and retry if the stripe moved under
+// them; a rebuild takes every stripe, and keeps the arrays it outgrows until
+// the map goes, so a reader still probing one never touches freed memory;
+// they add up to less than the live one
+template <uint8_t kValueNum>
+class FlatOverflowMap {
+   public:
+    static constexpr uint64_t kMinCapacity = 64;
+    static constexpr uint32_t kStripeNum = 64;
+
+    explicit FlatOverflowMap(uint64_t expected_entry_num,
+                             bool if_concurrent = false)
+        : if_concurrent(if_concurrent), size(0), used(0) {
+        uint64_t capacity = kMinCapacity;
+        // at most half full before the first rebuild
+        while (capacity < (expected_entry_num << 1)) {
+            capacity <<= 1;
+        }
+        current.reset(new SlotArray(capacity));
+        slot_array.store(current.get(), std::memory_order_release);
+        for (uint32_t i = 0; i < kStripeNum; i++) {
+            versions[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    FlatOverflowMap(const FlatOverflowMap&) = delete;
+    FlatOverflowMap& operator=(const FlatOverflowMap&) = delete;
+
+    // with check_unique, fails if key is in the map already; otherwise the
+    // caller promises it is not
+    bool Insert(uint64_t key, const uint64_t* values, bool check_unique) {
+        uint64_t hash = mix(key);
+        uint32_t stripe = stripe_of(hash);
+
+    insert_again:
+        lock_stripe(stripe);
+        SlotArray* array = slot_array.load(std::memory_order_acquire);
+
+        // the first tombstone on the way, or the empty slot ending it
+        Slot* target = nullptr;
+        uint8_t target_state = kEmpty;
+        for (uint64_t i = 0; i <= array->mask; i++) {
+            Slot& slot = array->slots[(home_of(hash) + i) & array->mask];
+            uint8_t state = slot.state.load(std::memory_order_acquire);
+            if (state == kFull) {
+                if (check_unique &&
+                    slot.key.load(std::memory_order_relaxed) == key) {
+                    unlock_stripe(stripe);
+                    return false;
+                }
+            } else if (state == kTombstone && !target) {
+                target = &slot;
+                target_state = kTombstone;
+                if (!check_unique) {
+                    break;
+                }
+            } else if (state == kEmpty) {
+                if (!target) {
+                    target = &slot;
+                }
+                break;
+            }
+        }
+
+        // no free slot left, as inserts on other stripes got there first
+        if (!target) {
+            unlock_stripe(stripe);
+            rebuild(array);
+            goto insert_again;
+        }
+
+        // inserts on other stripes may be after the same slot
+        if (!target->state.compare_exchange_strong(target_state, kBusy)) {
+            unlock_stripe(stripe);
+            goto insert_again;
+        }
+
+        target->key.store(key, std::memory_order_relaxed);
+        for (uint8_t i = 0; i < kValueNum; i++) {
+            target->values[i].store(values[i], std::memory_order_relaxed);
+        }
+        target->state.store(kFull, std::memory_order_release);
+
+        size.fetch_add(1, std::memory_order_relaxed);
+        uint64_t used_num =
+            target_state == kEmpty
+                ? used.fetch_add(1, std::memory_order_relaxed) + 1
+                : used.load(std::memory_order_relaxed);
+        unlock_stripe(stripe);
+
+        if ((used_num << 2) > (array->mask + 1) * 3) {
+            rebuild(array);
+        }
+        return true;
+    }
+
+    bool Query(uint64_t key, uint8_t value_id, uint64_t* value_ptr) {
+        uint64_t hash = mix(key);
+        uint32_t stripe = stripe_of(hash);
+        std::atomic<uint8_t>& version = versions[stripe];
+
+    query_again:
+        uint8_t expected_version = 0;
+        if (if_concurrent) {
+            do {
+                expected_version = version.load();
+            } while (expected_version & 1);
+        }
+
+        bool found = false;
+        Slot* slot = find(slot_array.load(std::memory_order_acquire), hash,
+                          key);
+        if (slot) {
+            *value_ptr = slot->values[value_id].load(std::memory_order_relaxed);
+            found = true;
+        }
+
+        if (if_concurrent && version.load() != expected_version) {
+            goto query_again;
+        }
+        return found;
+    }
+
+    bool Update(uint64_t key, uint8_t value_id, uint64_t value) {
+        uint64_t hash = mix(key);
+        uint32_t stripe = stripe_of(hash);
+
+        lock_stripe(stripe);
+        Slot* slot = find(slot_array.load(std::memory_order_acquire), hash,
+                          key);
+        if (slot) {
+            slot->values[value_id].store(value, std::memory_order_relaxed);
+        }
+        unlock_stripe(stripe);
+        return slot != nullptr;
+    }
+
+    bool Erase(uint64_t key) {
+        uint64_t hash = mix(key);
+        uint32_t stripe = stripe_of(hash);
+
+        lock_stripe(stripe);
+        Slot* slot = find(slot_array.load(std::memory_order_acquire), hash,
+                          key);
+        if (slot) {
+            slot->state.store(kTombstone, std::memory_order_release);
+            size.fetch_sub(1, std::memory_order_relaxed);
+        }
+        unlock_stripe(stripe);
+        return slot != nullptr;
+    }
+
+    uint64_t Size() const { return size.load(std::memory_order_relaxed); }
+
+    uint64_t Capacity() const {
+        return slot_array.load(std::memory_order_acquire)->mask + 1;
+    }
+
+   private:
+    enum SlotState : uint8_t {
+        kEmpty = 0,
+        kFull = 1,
+        kTombstone = 2,
+        kBusy = 3  // claimed by an insert, key and values on their way
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> values[kValueNum];
+        std::atomic<uint8_t> state;
+    };
+
+    struct SlotArray {
+        // value-initialized, so every slot starts empty
+        explicit SlotArray(uint64_t capacity)
+            : mask(capacity - 1), slots(new Slot[capacity]()) {}
+
+        const uint64_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    // the murmur3 finalizer; keys reaching the overflow table need not be
+    // hashed already
+    static __attribute__((always_inline)) inline uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // the stripe takes the low bits, the home slot those above
+    static __attribute__((always_inline)) inline uint32_t stripe_of(
+        uint64_t hash) {
+        return hash & (kStripeNum - 1);
+    }
+
+    static __attribute__((always_inline)) inline uint64_t home_of(
+        uint64_t hash) {
+        return hash >> 6;
+    }
+
+    // a walk over a slot array being rewritten may see anything, but is
+    // bounded by the capacity, and the version check throws its result away
+    __attribute__((always_inline)) inline Slot* find(SlotArray* array,
+                                                     uint64_t hash,
+                                                     uint64_t key) {
+        for (uint64_t i = 0; i <= array->mask; i++) {
+            Slot& slot = array->slots[(home_of(hash) + i) & array->mask];
+            uint8_t state = slot.state.load(std::memory_order_acquire);
+            if (state == kEmpty) {
+                return nullptr;
+            }
+            if (state == kFull &&
+                slot.key.load(std::memory_order_relaxed) == key) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    __attribute__((always_inline)) inline void lock_stripe(uint32_t stripe) {
+        if (!if_concurrent) {
+            return;
+        }
+        std::atomic<uint8_t>& version = versions[stripe];
+        uint8_t expected_version;
+        do {
+            expected_version = version.load();
+        } while ((expected_version & 1) ||
+                 !version.compare_exchange_weak(expected_version,
+                                                expected_version + 1));
+    }
+
+    __attribute__((always_inline)) inline void unlock_stripe(uint32_t stripe) {
+        if (if_concurrent) {
+            versions[stripe].fetch_add(1);
+        }
+    }
+
+    // rebuilds seen_array, unless another rebuild replaced it already
+    void rebuild(SlotArray* seen_array) {
+        for (uint32_t i = 0; i < kStripeNum; i++) {
+            lock_stripe(i);
+        }
+
+        SlotArray* array = slot_array.load(std::memory_order_relaxed);
+        if (array == seen_array) {
+            uint64_t capacity = array->mask + 1;
+            uint64_t live_num = size.load(std::memory_order_relaxed);
+
+            std::vector<Slot*> live;
+            live.reserve(live_num);
+            for (uint64_t i = 0; i < capacity; i++) {
+                if (array->slots[i].state.load(std::memory_order_relaxed) ==
+                    kFull) {
+                    live.push_back(&array->slots[i]);
+                }
+            }
+
+            if ((live_num << 1) > capacity) {
+                std::unique_ptr<SlotArray> grown(new SlotArray(capacity << 1));
+                for (Slot* slot : live) {
+                    place(grown.get(), *slot);
+                }
+                slot_array.store(grown.get(), std::memory_order_release);
+                if (if_concurrent) {
+                    retired.push_back(std::move(current));
+                }
+                current = std::move(grown);
+            } else {
+                // only tombstones to clear: the live slots are copied out
+                // and put back from scratch
+                std::unique_ptr<Slot[]> copies(new Slot[live.size()]());
+                for (uint64_t i = 0; i < live.size(); i++) {
+                    copy_slot(copies[i], *live[i]);
+                }
+                for (uint64_t i = 0; i < capacity; i++) {
+                    array->slots[i].state.store(kEmpty,
+                                                std::memory_order_relaxed);
+                }
+                for (uint64_t i = 0; i < live.size(); i++) {
+                    place(array, copies[i]);
+                }
+            }
+            used.store(live.size(), std::memory_order_relaxed);
+        }
+
+        for (uint32_t i = 0; i < kStripeNum; i++) {
+            unlock_stripe(i);
+        }
+    }
+
+    static void copy_slot(Slot& dst, const Slot& src) {
+        dst.key.store(src.key.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+        for (uint8_t i = 0; i < kValueNum; i++) {
+            dst.values[i].store(src.values[i].load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+        }
+        dst.state.store(kFull, std::memory_order_release);
+    }
+
+    // with every stripe held and no tombstone in array
+    static void place(SlotArray* array, const Slot& src) {
+        uint64_t hash = mix(src.key.load(std::memory_order_relaxed));
+        for (uint64_t i = home_of(hash);; i++) {
+            Slot& slot = array->slots[i & array->mask];
+            if (slot.state.load(std::memory_order_relaxed) == kEmpty) {
+                copy_slot(slot, src);
+                return;
+            }
+        }
+    }
+
+    const bool if_concurrent;
+    std::atomic<SlotArray*> slot_array;
+    std::unique_ptr<SlotArray> current;
+    std::vector<std::unique_ptr<SlotArray>> retired;
+
+    std::atomic<uint64_t> size;
+    // full slots and tombstones
+    std::atomic<uint64_t> used;
+
+    std::atomic<uint8_t> versions[kStripeNum];
+};
+
+}  // namespace utils
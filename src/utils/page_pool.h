@@ -0,0 +1,137 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace utils {
+
+// cache of pre-faulted anonymous mappings, keyed by size class
+// tables built for a resize draw their memory from here and hand it back when
+// they are freed, so the next table of a similar size skips mmap and the page
+// faults; a recycled block is zeroed with a plain memset, which is far cheaper
+// than faulting fresh pages in
+// sizes are rounded up to one of eight classes per power of two, so tables a
+// few percent apart share blocks for at most an eighth of slack
+
+struct PagePoolStats {
+    uint64_t map_cnt;       // blocks freshly mapped
+    uint64_t reuse_cnt;     // blocks served from the cache
+    uint64_t cached_bytes;  // bytes currently held
+};
+
+class PagePool {
+   public:
+    static constexpr uint64_t kDefaultCapacity = 1ULL << 30;
+    static constexpr uint64_t kPageSize = 4096;
+    static constexpr uint8_t kSizeClassShift = 3;
+
+    explicit PagePool(uint64_t capacity = kDefaultCapacity)
+        : capacity(capacity), cached_bytes(0), map_cnt(0), reuse_cnt(0) {}
+
+    ~PagePool() { Trim(); }
+
+    PagePool(const PagePool&) = delete;
+    PagePool& operator=(const PagePool&) = delete;
+
+    // zeroed and pre-faulted; a failed mapping ends the process, as the
+    // tables have no way to report it
+    void* Acquire(uint64_t wanted_size) {
+        uint64_t size = size_class(wanted_size);
+        void* mem = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+                if (it->second == size) {
+                    mem = it->first;
+                    blocks.erase(it);
+                    cached_bytes -= size;
+                    break;
+                }
+            }
+        }
+
+        if (mem) {
+            // the tail past wanted_size is never written by the table
+            memset(mem, 0, wanted_size);
+            reuse_cnt.fetch_add(1, std::memory_order_relaxed);
+            return mem;
+        }
+
+        map_cnt.fetch_add(1, std::memory_order_relaxed);
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+        if (mem == MAP_FAILED) {
+            perror("PagePool::Acquire mmap");
+            exit(EXIT_FAILURE);
+        }
+        return mem;
+    }
+
+    // size is the one given to Acquire; O(1) unless the cache overflows; the
+    // oldest blocks go first, which under a growing table are the smallest and
+    // least likely to be asked for again
+    void Release(void* mem, uint64_t size) {
+        size = size_class(size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks.emplace_back(mem, size);
+            cached_bytes += size;
+        }
+        shrink_to(capacity);
+    }
+
+    void Trim() { shrink_to(0); }
+
+    void SetCapacity(uint64_t bytes) {
+        capacity = bytes;
+        shrink_to(bytes);
+    }
+
+    PagePoolStats GetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return {map_cnt.load(std::memory_order_relaxed),
+                reuse_cnt.load(std::memory_order_relaxed), cached_bytes};
+    }
+
+   private:
+    static uint64_t size_class(uint64_t size) {
+        if (size <= kPageSize) {
+            return kPageSize;
+        }
+        uint64_t step = (uint64_t(1) << (63 - __builtin_clzll(size))) >>
+                        kSizeClassShift;
+        step = step < kPageSize ? kPageSize : step;
+        return (size + step - 1) & ~(step - 1);
+    }
+
+    void shrink_to(uint64_t limit) {
+        std::deque<std::pair<void*, uint64_t>> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (cached_bytes > limit) {
+                evicted.push_back(blocks.front());
+                cached_bytes -= blocks.front().second;
+                blocks.pop_front();
+            }
+        }
+        for (auto& block : evicted) {
+            munmap(block.first, block.second);
+        }
+    }
+
+    std::atomic<uint64_t> capacity;
+    uint64_t cached_bytes;
+    std::atomic<uint64_t> map_cnt;
+    std::atomic<uint64_t> reuse_cnt;
+    std::deque<std::pair<void*, uint64_t>> blocks;
+    std::mutex mutex;
+};
+
+}  // namespace utils
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <immintrin.h>
+#include <cstdint>
+
+namespace utils {
+
+// branch-free rank and select over 64-bit words, as used to address the
+// slots of bushes, bolt clouds and frontyards from their occupancy bits
+// rank counts the set bits below a position; select finds the position of
+// the set bit of a given rank, counting from 0 at the low end
+// BMI2 builds use BZHI and PDEP; elsewhere, and where PDEP is microcoded
+// (AMD before Zen 3, build with TINYPTR_SLOW_PDEP), the broadword versions
+// are used instead
+
+static constexpr uint64_t kOnesStep8 = 0x0101010101010101ULL;
+static constexpr uint64_t kMsbsStep8 = 0x80ULL * kOnesStep8;
+
+__attribute__((always_inline)) inline uint32_t Popcount64(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+// pos in [0, 64]
+__attribute__((always_inline)) inline uint32_t Rank64Broadword(uint64_t bits,
+                                                               uint32_t pos) {
+    // pos == 64 would shift out of range, so it sets the mask instead
+    uint64_t mask = ((1ULL << (pos & 63)) - 1) | (0 - uint64_t(pos >> 6));
+    return Popcount64(bits & mask);
+}
+
+// rank must be below the popcount of bits
+// the bytes' prefix popcounts pick the byte holding the bit, and the same
+// comparison over the bits of that byte, spread one per byte, picks the bit
+__attribute__((always_inline)) inline uint32_t Select64Broadword(
+    uint64_t bits, uint32_t rank) {
+    uint64_t sums = bits - ((bits >> 1) & 0x5555555555555555ULL);
+    sums = (sums & 0x3333333333333333ULL) +
+           ((sums >> 2) & 0x3333333333333333ULL);
+    sums = ((sums + (sums >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * kOnesStep8;
+
+    // the number of bytes whose prefix count is at most rank
+    uint64_t rank_step8 = rank * kOnesStep8;
+    uint32_t place =
+        Popcount64(((rank_step8 | kMsbsStep8) - sums) & kMsbsStep8) << 3;
+    uint32_t byte_rank = rank - (((sums << 8) >> place) & 0xFF);
+
+    uint64_t byte_spread =
+        (((bits >> place) & 0xFF) * kOnesStep8) & 0x8040201008040201ULL;
+    // one bit per byte: whether the byte is nonzero
+    byte_spread =
+        ((byte_spread | ((byte_spread | kMsbsStep8) - kOnesStep8)) &
+         kMsbsStep8) >>
+        7;
+    uint64_t bit_sums = byte_spread * kOnesStep8;
+    return place + Popcount64((((byte_rank * kOnesStep8) | kMsbsStep8) -
+                               bit_sums) &
+                              kMsbsStep8);
+}
+
+__attribute__((always_inline)) inline uint32_t Rank64(uint64_t bits,
+                                                      uint32_t pos) {
+#if defined(__BMI2__)
+    // BZHI keeps the whole word for pos == 64
+    return Popcount64(_bzhi_u64(bits, pos));
+#else
+    return Rank64Broadword(bits, pos);
+#endif
+}
+
+// rank over the 128 bits lo, hi; pos in [0, 128]
+__attribute__((always_inline)) inline uint32_t Rank128(uint64_t lo,
+                                                       uint64_t hi,
+                                                       uint32_t pos) {
+    uint32_t hi_pos = pos < 64 ? 0 : pos - 64;
+    uint32_t lo_pos = pos < 64 ? pos : 64;
+    return Rank64(lo, lo_pos) + Rank64(hi, hi_pos);
+}
+
+__attribute__((always_inline)) inline uint32_t Select64(uint64_t bits,
+                                                        uint32_t rank) {
+#if defined(__BMI2__) && !defined(TINYPTR_SLOW_PDEP)
+    return _tzcnt_u64(_pdep_u64(1ULL << rank, bits));
+#else
+    return Select64Broadword(bits, rank);
+#endif
+}
+
+}  // namespace utils
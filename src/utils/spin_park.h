@@ -0,0 +1,117 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+namespace utils {
+
+// spin-then-park waiting on a 64-bit atomic word
+// waiters spin with pause for a bounded number of rounds, then park on the
+// low 32 bits of the word with a raw futex; writers that move the word out of
+// a waited-on state call SpinParkNotify, which only enters the kernel when
+// someone at the same site is actually parked
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "futex parking waits on the low half of a 64-bit word");
+
+static constexpr uint32_t kSpinParkSpinLimit = 1 << 10;
+
+struct SpinParkStats {
+    uint64_t spin_exit_cnt;  // waits resolved while spinning
+    uint64_t park_cnt;       // futex sleeps entered
+    uint64_t wake_cnt;       // futex wake calls issued
+};
+
+struct alignas(64) SpinParkSite {
+    std::atomic<uint64_t> spin_exit_cnt{0};
+    std::atomic<uint64_t> park_cnt{0};
+    std::atomic<uint64_t> wake_cnt{0};
+    std::atomic<uint32_t> parked{0};
+
+    SpinParkStats Snapshot() const {
+        return {spin_exit_cnt.load(std::memory_order_relaxed),
+                park_cnt.load(std::memory_order_relaxed),
+                wake_cnt.load(std::memory_order_relaxed)};
+    }
+};
+
+__attribute__((always_inline)) inline uint32_t* futex_word(
+    std::atomic<uint64_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+// returns the first observed value satisfying pred
+template <typename Pred>
+inline uint64_t SpinParkUntil(std::atomic<uint64_t>& word, SpinParkSite& site,
+                              Pred pred) {
+    uint64_t observed = word.load();
+    for (uint32_t i = 0; i < kSpinParkSpinLimit; i++) {
+        if (pred(observed)) {
+            if (i) {
+                site.spin_exit_cnt.fetch_add(1, std::memory_order_relaxed);
+            }
+            return observed;
+        }
+        _mm_pause();
+        observed = word.load();
+    }
+
+    while (!pred(observed)) {
+        site.parked.fetch_add(1);
+        site.park_cnt.fetch_add(1, std::memory_order_relaxed);
+        // the kernel re-checks the word, so a change after our load (and
+        // before a notifier saw parked != 0) makes this return immediately
+        syscall(SYS_futex, futex_word(word), FUTEX_WAIT_PRIVATE,
+                static_cast<uint32_t>(observed), nullptr, nullptr, 0);
+        site.parked.fetch_sub(1);
+        observed = word.load();
+    }
+    return observed;
+}
+
+// for words whose writers are too hot to call SpinParkNotify: past the spin
+// phase the waiter naps for kSpinNapNs at a time and looks again
+static constexpr long kSpinNapNs = 20000;
+
+template <typename Pred>
+inline uint64_t SpinNapUntil(std::atomic<uint64_t>& word, SpinParkSite& site,
+                             Pred pred) {
+    uint64_t observed = word.load();
+    for (uint32_t i = 0; i < kSpinParkSpinLimit; i++) {
+        if (pred(observed)) {
+            if (i) {
+                site.spin_exit_cnt.fetch_add(1, std::memory_order_relaxed);
+            }
+            return observed;
+        }
+        _mm_pause();
+        observed = word.load();
+    }
+
+    const struct timespec nap = {0, kSpinNapNs};
+    while (!pred(observed)) {
+        site.park_cnt.fetch_add(1, std::memory_order_relaxed);
+        syscall(SYS_futex, futex_word(word), FUTEX_WAIT_PRIVATE,
+                static_cast<uint32_t>(observed), &nap, nullptr, 0);
+        observed = word.load();
+    }
+    return observed;
+}
+
+// must follow the (seq_cst) store or RMW that changed the word
+__attribute__((always_inline)) inline void SpinParkNotify(
+    std::atomic<uint64_t>& word, SpinParkSite& site) {
+    if (__builtin_expect(site.parked.load() != 0, 0)) {
+        site.wake_cnt.fetch_add(1, std::memory_order_relaxed);
+        syscall(SYS_futex, futex_word(word), FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+    }
+}
+
+}  // namespace utils
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace utils {
+
+// lock-free ring between exactly one producer and one consumer
+// each side owns its index on a cache line of its own and keeps a cached copy
+// of the other side's, so it only reads the other line when the ring looks
+// full (or empty) from the copy; no read-modify-write is ever issued
+
+template <typename T, uint64_t kCapacity>
+class SpscRing {
+    static_assert((kCapacity & (kCapacity - 1)) == 0,
+                  "ring capacity must be a power of 2");
+
+   public:
+    SpscRing() : tail(0), cached_head(0), head(0), cached_tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer side
+    bool TryPush(const T& item) {
+        uint64_t cur_tail = tail.load(std::memory_order_relaxed);
+        if (cur_tail - cached_head == kCapacity) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (cur_tail - cached_head == kCapacity) {
+                return false;
+            }
+        }
+        slots[cur_tail & (kCapacity - 1)] = item;
+        tail.store(cur_tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; pops up to max_num items into out, and publishes the
+    // freed slots once for the whole batch
+    uint32_t TryPopBatch(T* out, uint32_t max_num) {
+        uint64_t cur_head = head.load(std::memory_order_relaxed);
+        if (cached_tail == cur_head) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (cached_tail == cur_head) {
+                return 0;
+            }
+        }
+        uint32_t num = cached_tail - cur_head < max_num
+                           ? static_cast<uint32_t>(cached_tail - cur_head)
+                           : max_num;
+        for (uint32_t i = 0; i < num; i++) {
+            out[i] = slots[(cur_head + i) & (kCapacity - 1)];
+        }
+        head.store(cur_head + num, std::memory_order_release);
+        return num;
+    }
+
+    bool TryPop(T& item) { return TryPopBatch(&item, 1) == 1; }
+
+   private:
+    alignas(64) std::atomic<uint64_t> tail;
+    uint64_t cached_head;
+    alignas(64) std::atomic<uint64_t> head;
+    uint64_t cached_tail;
+    alignas(64) T slots[kCapacity];
+};
+
+}  // namespace utils
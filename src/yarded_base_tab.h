@@ -0,0 +1,218 @@
+#pragma once
+
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "utils/cache_line_size.h"
+#include "utils/page_pool.h"
+#include "utils/rank_select.h"
+
+namespace tinyptr {
+
+// the base table of the yarded tables: base slots are grouped into duplexes of
+// kBaseDuplexSize, and only the non-empty ones take a byte
+// each duplex owns a cache line, a bitmap of its non-empty slots followed by
+// their tiny pointers in slot order (the frontyard); the ranks that do not fit
+// spill into a small per-duplex backyard, and a duplex with both full takes
+// no more chains
+// the owner may keep the last reserved_bytes of every line for itself
+
+class YardedBaseTab {
+   public:
+    const uint8_t kBaseDuplexSize;
+    const uint8_t kBaseDuplexEncodingBytes;
+    const uint8_t kFrontyardOffset;
+    const uint8_t kFrontyardSize;
+    const uint8_t kBackyardSize;
+    const uint64_t kYardNum;
+
+   protected:
+    // about as many slots as the frontyard holds at the expected share of
+    // non-empty ones; at least 64, so the bitmap covers a whole word, and at
+    // most 113, so it fits two
+    static uint8_t AutoDuplexSize(double valid_base_entry_ratio,
+                                  uint8_t reserved_bytes) {
+        uint32_t line_size = utils::kCacheLineSize - reserved_bytes;
+        uint32_t max_duplex_size = (16 * line_size - 7) / 9;
+        uint32_t res = std::ceil(line_size / (1.0 / 8 + valid_base_entry_ratio));
+        return std::max<uint32_t>(64, std::min(max_duplex_size, res));
+    }
+
+    // a few standard deviations of the number of non-empty slots, which
+    // keeps the backyard well under a byte per slot
+    static uint8_t AutoBackyardSize(uint8_t duplex_size,
+                                    uint8_t frontyard_size) {
+        return std::min<uint32_t>(duplex_size - frontyard_size,
+                                  std::ceil(2 * std::sqrt(duplex_size)));
+    }
+
+   public:
+    YardedBaseTab(uint64_t base_num, double valid_base_entry_ratio,
+                  uint8_t reserved_bytes = 0, utils::PagePool* pool = nullptr)
+        : kBaseDuplexSize(
+              AutoDuplexSize(valid_base_entry_ratio, reserved_bytes)),
+          kBaseDuplexEncodingBytes((kBaseDuplexSize + 7) / 8),
+          kFrontyardOffset(kBaseDuplexEncodingBytes),
+          kFrontyardSize(utils::kCacheLineSize - kBaseDuplexEncodingBytes -
+                         reserved_bytes),
+          kBackyardSize(AutoBackyardSize(kBaseDuplexSize, kFrontyardSize)),
+          kYardNum((base_num + kBaseDuplexSize - 1) / kBaseDuplexSize),
+          page_pool(pool) {
+        mem_size = (utils::kCacheLineSize + kBackyardSize) * kYardNum;
+        if (page_pool) {
+            frontyard_tab_ptr =
+                reinterpret_cast<uint8_t*>(page_pool->Acquire(mem_size));
+        } else {
+            frontyard_tab_ptr = reinterpret_cast<uint8_t*>(
+                mmap(NULL, mem_size, PROT_READ | PROT_WRITE,
+                     MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0));
+        }
+        backyard_tab_ptr = frontyard_tab_ptr + kYardNum * utils::kCacheLineSize;
+    }
+
+    ~YardedBaseTab() {
+        if (page_pool) {
+            page_pool->Release(frontyard_tab_ptr, mem_size);
+        } else {
+            munmap(frontyard_tab_ptr, mem_size);
+        }
+    }
+
+    YardedBaseTab(const YardedBaseTab&) = delete;
+    YardedBaseTab& operator=(const YardedBaseTab&) = delete;
+
+    __attribute__((always_inline)) inline uint64_t DuplexId(uint64_t base_id) {
+        return base_id / kBaseDuplexSize;
+    }
+
+    __attribute__((always_inline)) inline uint8_t* Frontyard(
+        uint64_t duplex_id) {
+        return frontyard_tab_ptr + duplex_id * utils::kCacheLineSize;
+    }
+
+    // stands in for the address of base_id's pointer when placing the first
+    // entry of its chain, as the pointer itself moves around the duplex
+    __attribute__((always_inline)) inline uint64_t BaseKey(uint64_t base_id) {
+        return reinterpret_cast<uint64_t>(frontyard_tab_ptr) + base_id;
+    }
+
+    // 0 if base_id's chain is empty
+    __attribute__((always_inline)) inline uint8_t Get(uint64_t base_id) {
+        uint64_t duplex_id = DuplexId(base_id);
+        uint8_t in_duplex_id = base_id - duplex_id * kBaseDuplexSize;
+        uint8_t* frontyard_ptr = Frontyard(duplex_id);
+
+        if (!((frontyard_ptr[in_duplex_id >> 3] >> (in_duplex_id & 7)) & 1)) {
+            return 0;
+        }
+        return *yard_pos(duplex_id, rank(frontyard_ptr, in_duplex_id));
+    }
+
+    // whether the duplex of base_id can take another chain
+    __attribute__((always_inline)) inline bool HasRoom(uint64_t base_id) {
+        uint64_t duplex_id = DuplexId(base_id);
+        return rank(Frontyard(duplex_id), kBaseDuplexSize) <
+               kFrontyardSize + kBackyardSize;
+    }
+
+    // base_id's chain must be empty and its duplex have room
+    __attribute__((always_inline)) inline void Insert(uint64_t base_id,
+                                                      uint8_t ptr) {
+        uint64_t duplex_id = DuplexId(base_id);
+        uint8_t in_duplex_id = base_id - duplex_id * kBaseDuplexSize;
+        uint8_t* frontyard_ptr = Frontyard(duplex_id);
+        uint8_t* backyard_ptr = backyard_tab_ptr + duplex_id * kBackyardSize;
+        uint8_t* front = frontyard_ptr + kFrontyardOffset;
+
+        uint8_t pos = rank(frontyard_ptr, in_duplex_id);
+        uint8_t cnt = rank(frontyard_ptr, kBaseDuplexSize);
+
+        // the frontyard and the backyard make up one array of cnt ranks; the
+        // ranks from pos on move up by one, the last of the frontyard
+        // spilling into the backyard
+        if (cnt >= kFrontyardSize) {
+            uint8_t lo = std::max(pos, kFrontyardSize);
+            memmove(backyard_ptr + lo - kFrontyardSize + 1,
+                    backyard_ptr + lo - kFrontyardSize, cnt - lo);
+            if (pos < kFrontyardSize) {
+                backyard_ptr[0] = front[kFrontyardSize - 1];
+            }
+        }
+        if (pos < kFrontyardSize) {
+            uint8_t hi = std::min<uint8_t>(cnt, kFrontyardSize - 1);
+            memmove(front + pos + 1, front + pos, hi - pos);
+        }
+
+        *yard_pos(duplex_id, pos) = ptr;
+        frontyard_ptr[in_duplex_id >> 3] |= 1 << (in_duplex_id & 7);
+    }
+
+    // base_id's chain must not be empty
+    __attribute__((always_inline)) inline void Set(uint64_t base_id,
+                                                   uint8_t ptr) {
+        uint64_t duplex_id = DuplexId(base_id);
+        uint8_t in_duplex_id = base_id - duplex_id * kBaseDuplexSize;
+        *yard_pos(duplex_id, rank(Frontyard(duplex_id), in_duplex_id)) = ptr;
+    }
+
+    // base_id's chain must not be empty
+    __attribute__((always_inline)) inline void Erase(uint64_t base_id) {
+        uint64_t duplex_id = DuplexId(base_id);
+        uint8_t in_duplex_id = base_id - duplex_id * kBaseDuplexSize;
+        uint8_t* frontyard_ptr = Frontyard(duplex_id);
+        uint8_t* backyard_ptr = backyard_tab_ptr + duplex_id * kBackyardSize;
+        uint8_t* front = frontyard_ptr + kFrontyardOffset;
+
+        uint8_t pos = rank(frontyard_ptr, in_duplex_id);
+        uint8_t cnt = rank(frontyard_ptr, kBaseDuplexSize);
+
+        // the reverse of Insert: the ranks past pos move down by one, the
+        // first of the backyard coming back to the frontyard
+        if (pos < kFrontyardSize) {
+            uint8_t hi = std::min(cnt, kFrontyardSize);
+            memmove(front + pos, front + pos + 1, hi - pos - 1);
+            if (cnt > kFrontyardSize) {
+                front[kFrontyardSize - 1] = backyard_ptr[0];
+            }
+        }
+        if (cnt > kFrontyardSize) {
+            uint8_t lo = std::max(pos, kFrontyardSize);
+            memmove(backyard_ptr + lo - kFrontyardSize,
+                    backyard_ptr + lo - kFrontyardSize + 1, cnt - 1 - lo);
+        }
+
+        *yard_pos(duplex_id, cnt - 1) = 0;
+        frontyard_ptr[in_duplex_id >> 3] &= ~(1 << (in_duplex_id & 7));
+    }
+
+    uint64_t GetByteSize() const { return mem_size; }
+
+   protected:
+    // the number of non-empty slots before in_duplex_id
+    __attribute__((always_inline)) inline uint8_t rank(uint8_t* frontyard_ptr,
+                                                       uint8_t in_duplex_id) {
+        return utils::Rank128(*reinterpret_cast<uint64_t*>(frontyard_ptr),
+                              *reinterpret_cast<uint64_t*>(frontyard_ptr + 8),
+                              in_duplex_id);
+    }
+
+    __attribute__((always_inline)) inline uint8_t* yard_pos(uint64_t duplex_id,
+                                                            uint8_t pos) {
+        if (pos < kFrontyardSize) {
+            return Frontyard(duplex_id) + kFrontyardOffset + pos;
+        }
+        return backyard_tab_ptr + duplex_id * kBackyardSize + pos -
+               kFrontyardSize;
+    }
+
+   protected:
+    utils::PagePool* page_pool;
+    uint64_t mem_size;
+    uint8_t* frontyard_tab_ptr;
+    uint8_t* backyard_tab_ptr;
+};
+
+}  // namespace tinyptr
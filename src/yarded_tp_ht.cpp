@@ -1,62 +1,30 @@
 #include "yarded_tp_ht.h"
-#include <bitset>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
-#include <type_traits>
-#include "cmath"
-#include "utils/cache_line_size.h"
 
 namespace tinyptr {
 
-uint8_t YardedTPHT::AutoBaseBinsize() {
-    double valid_base_entry_ratio =
-        0.5 * kBinNum * kBinSize / kBaseTabSize + 0.15;
-
-    // 113 when cache line size is 64
-    uint8_t max_base_bin_size = (16 * utils::kCacheLineSize - 7) / 9;
-    uint8_t res = std::min(
-        max_base_bin_size,
-        static_cast<uint8_t>(std::ceil(utils::kCacheLineSize /
-                                       (1.0 / 8 + valid_base_entry_ratio))));
-    return res;
+double YardedTPHT::ValidBaseEntryRatio() {
+    return 0.5 * kBinNum * kBinSize / kBaseTabSize + 0.15;
 }
 
 YardedTPHT::YardedTPHT(uint64_t size, uint16_t bin_size)
     : ByteArrayChainedHT(size, bin_size),
-      kBaseDuplexSize(AutoBaseBinsize()),
-      kBaseDuplexEncodingBytes((kBaseDuplexSize + 7) / 8),
-      kFrontyardSize(utils::kCacheLineSize - kBaseDuplexEncodingBytes),
-      kBackyardSize(kBaseDuplexEncodingBytes - kFrontyardSize),
-      kFrontyardOffset(kBaseDuplexEncodingBytes),
-      kYardNum((kBaseTabSize + kBaseDuplexSize - 1) / kFrontyardSize) {
-
-    int result = posix_memalign(reinterpret_cast<void**>(&frontyard_tab_ptr),
-                                utils::kCacheLineSize,
-                                (utils::kCacheLineSize + kBackyardSize) * kYardNum);
-    if (result != 0) {
-        throw std::runtime_error("posix_memalign failed");
-    }
-    memset(frontyard_tab_ptr, 0,
-           (utils::kCacheLineSize + kBackyardSize) * kYardNum);
-    backyard_tab_ptr = frontyard_tab_ptr + kYardNum * utils::kCacheLineSize;
-
-    // freopen("/home/xt253/TinyPtr/results/yarded_tp_ht.txt", "w", stdout);
-
-    // std::cout << "kBaseDuplexSize: " << int(kBaseDuplexSize) << std::endl;
-    // exit(0);
-}
+      yarded_base_tab(kBaseTabSize, ValidBaseEntryRatio()) {}
 
 bool YardedTPHT::Insert(uint64_t key, uint64_t value) {
     uint64_t base_id = hash_1_base_id(key);
-    uint8_t base_tab_ptr = get_base_tab_ptr(base_id);
-    uint64_t base_key = get_base_key(base_id);
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+    uint64_t base_key = yarded_base_tab.BaseKey(base_id);
 
     if (base_tab_ptr == 0) {
+        if (!yarded_base_tab.HasRoom(base_id)) {
+            return false;
+        }
         uint8_t* entry = ptab_insert_entry_address(base_key);
         if (entry != nullptr) {
-            set_base_tab_ptr(base_id, *entry);
-            print_duplex(base_id, "Insert");
+            yarded_base_tab.Insert(base_id, *entry);
             // assuming little endian
             *reinterpret_cast<uint64_t*>(entry) = key >> kQuotientingTailLength;
             entry[kTinyPtrOffset] = 0;
@@ -70,21 +38,18 @@ bool YardedTPHT::Insert(uint64_t key, uint64_t value) {
     // the base_tab_ptr is not null so will not be written later
     uint8_t* pre_tiny_ptr = &base_tab_ptr;
     uint64_t pre_tiny_ptr_key = base_key;
-
-    int cnt = 0;
+    uint32_t chain_length = 0;
 
     while (*pre_tiny_ptr != 0) {
-        // cnt++;
-        // if (cnt > 10) {
-        //     exit(0);
-        // }
-        // std::cout << "pre_tiny_ptr: " << int(*pre_tiny_ptr) << std::endl;
-        // std::cout << "pre_tiny_ptr_key: " << pre_tiny_ptr_key << std::endl;
-
         uint8_t* entry =
             ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
         pre_tiny_ptr = entry + kTinyPtrOffset;
         pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
+        chain_length++;
+    }
+
+    if (max_chain_length && chain_length >= max_chain_length) {
+        return false;
     }
 
     uint8_t* entry = ptab_insert_entry_address(pre_tiny_ptr_key);
@@ -104,15 +69,15 @@ bool YardedTPHT::Insert(uint64_t key, uint64_t value) {
 bool YardedTPHT::Query(uint64_t key, uint64_t* value_ptr) {
 
     uint64_t base_id = hash_1_base_id(key);
-    // uint8_t base_tab_ptr = get_base_tab_ptr(base_id);
-    uint8_t base_tab_ptr = get_base_tab_ptr_for_cachegrind(base_id);
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
 
     if (base_tab_ptr == 0) {
         return false;
     }
 
     uint8_t* pre_tiny_ptr = &base_tab_ptr;
-    uint64_t pre_tiny_ptr_key = get_base_key(base_id);
+    uint64_t pre_tiny_ptr_key = yarded_base_tab.BaseKey(base_id);
+    uint8_t* pre_entry = nullptr;
 
     // quotienting and shifting back
     key >>= kQuotientingTailLength;
@@ -127,8 +92,13 @@ bool YardedTPHT::Query(uint64_t key, uint64_t* value_ptr) {
         if ((*reinterpret_cast<uint64_t*>(entry) << kQuotientingTailLength) ==
             key) {
             *value_ptr = *reinterpret_cast<uint64_t*>(entry + kValueOffset);
+            if (adaptive_chains && pre_entry &&
+                (++promote_tick & kPromoteSampleMask) == 0) {
+                swap_payload(pre_entry, entry);
+            }
             return true;
         }
+        pre_entry = entry;
         pre_tiny_ptr = entry + kTinyPtrOffset;
         pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
     }
@@ -136,4 +106,78 @@ bool YardedTPHT::Query(uint64_t key, uint64_t* value_ptr) {
     return false;
 }
 
+bool YardedTPHT::Update(uint64_t key, uint64_t value) {
+    uint64_t base_id = hash_1_base_id(key);
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+
+    uint8_t* pre_tiny_ptr = &base_tab_ptr;
+    uint64_t pre_tiny_ptr_key = yarded_base_tab.BaseKey(base_id);
+
+    // quotienting
+    key >>= kQuotientingTailLength;
+
+    while (*pre_tiny_ptr != 0) {
+        uint8_t* entry =
+            ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+        if (((*reinterpret_cast<uint64_t*>(entry) << kQuotientingTailLength) >>
+             kQuotientingTailLength) == key) {
+            *reinterpret_cast<uint64_t*>(entry + kValueOffset) = value;
+            return true;
+        }
+        pre_tiny_ptr = entry + kTinyPtrOffset;
+        pre_tiny_ptr_key = reinterpret_cast<uint64_t>(entry);
+    }
+
+    return false;
+}
+
+void YardedTPHT::Free(uint64_t key) {
+    uint64_t base_id = hash_1_base_id(key);
+    uint8_t base_tab_ptr = yarded_base_tab.Get(base_id);
+
+    if (base_tab_ptr == 0) {
+        return;
+    }
+
+    // quotienting
+    key >>= kQuotientingTailLength;
+
+    // the last entry of the chain fills the hole left by the freed one, and
+    // its slot is given back; pre_tiny_ptr ends up linking to it, pointing at
+    // base_tab_ptr if it is the only one
+    uint8_t* pre_tiny_ptr = &base_tab_ptr;
+    uint64_t pre_tiny_ptr_key = yarded_base_tab.BaseKey(base_id);
+    uint8_t* cur_entry = nullptr;
+    uint8_t* aiming_entry = nullptr;
+
+    while (true) {
+        cur_entry = ptab_query_entry_address(pre_tiny_ptr_key, *pre_tiny_ptr);
+        if (((*reinterpret_cast<uint64_t*>(cur_entry)
+              << kQuotientingTailLength) >>
+             kQuotientingTailLength) == key) {
+            aiming_entry = cur_entry;
+        }
+        if (cur_entry[kTinyPtrOffset] == 0) {
+            break;
+        }
+        pre_tiny_ptr = cur_entry + kTinyPtrOffset;
+        pre_tiny_ptr_key = reinterpret_cast<uint64_t>(cur_entry);
+    }
+
+    if (aiming_entry == nullptr) {
+        return;
+    }
+
+    uint8_t tmp = aiming_entry[kTinyPtrOffset];
+    memcpy(aiming_entry, cur_entry, kEntryByteLength);
+    aiming_entry[kTinyPtrOffset] = tmp;
+
+    release_slot(cur_entry, *pre_tiny_ptr);
+    if (pre_tiny_ptr == &base_tab_ptr) {
+        yarded_base_tab.Erase(base_id);
+    } else {
+        *pre_tiny_ptr = 0;
+    }
+}
+
 }  // namespace tinyptr
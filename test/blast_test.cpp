@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
@@ -190,6 +191,31 @@ TEST(BlastHT_TESTSUITE, StdMapCompliance) {
     }
 }
 
+TEST(BlastHT_TESTSUITE, BulkInsert) {
+    srand(233);
+
+    int n = 1 << 20;
+    BlastHT blast_ht(n * 2, true);
+
+    vector<pair<uint64_t, uint64_t>> data(n);
+    for (int i = 0; i < n; ++i) {
+        data[i] = {my_int_rand(), my_value_rand()};
+    }
+    sort(data.begin(), data.end());
+    data.erase(unique(data.begin(), data.end(),
+                      [](const pair<uint64_t, uint64_t>& a,
+                         const pair<uint64_t, uint64_t>& b) {
+                          return a.first == b.first;
+                      }),
+               data.end());
+
+    // leave a partial batch at the end
+    data.resize(data.size() - 1);
+
+    ASSERT_EQ(blast_ht.BulkInsert(data.data(), data.size()), 0u);
+    concurrent_query(blast_ht, data, 0, data.size());
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <vector>
 #include "bolt_ht.h"
+#include "resizable_ht.h"
+#include "update_free_ht_test.h"
 #include "utils/rng.h"
 
 rng::rng64 rng64(123456789);
@@ -146,6 +148,18 @@ TEST(BoltHT_TESTSUITE, ParallelInsertQuery) {
         << "ms" << std::endl;
 }
 
+TEST(BoltHT_TESTSUITE, StdMapCompliance) {
+    srand(233);
+    // as many keys as entries, so clouds keep trading crystals for bolts
+    BoltHT bolt_ht(1 << 15, uint16_t(127));
+    StdMapCompliance(bolt_ht);
+}
+
+TEST(BoltHT_TESTSUITE, ResizableInsertUpdateFree) {
+    srand(233);
+    ResizableInsertUpdateFree<ResizableBoltHT>();
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -3,8 +3,10 @@
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 #include "byte_array_chained_ht.h"
 
 using namespace tinyptr;
@@ -68,6 +70,122 @@ TEST(ByteArrayChainedHT_TESTSUITE, StdMapCompliance) {
     }
 }
 
+TEST(ByteArrayChainedHT_TESTSUITE, MultiQuery) {
+    srand(233);
+
+    // few base slots, so the chains run several entries long
+    int n = 1 << 16;
+    tinyptr::ByteArrayChainedHT chained_ht(n, 12, 127);
+
+    std::map<uint64_t, uint64_t> lala;
+    std::vector<uint64_t> keys;
+    for (int i = 0; i < n; i++) {
+        uint64_t key = my_int_rand(), val = my_value_rand();
+        if (lala.find(key) == lala.end() && chained_ht.Insert(key, val)) {
+            lala[key] = val;
+        }
+        // every other key looked up is absent
+        keys.push_back(key);
+        keys.push_back(my_int_rand() ^ 1);
+    }
+
+    std::vector<uint64_t> values(keys.size());
+    std::unique_ptr<bool[]> found(new bool[keys.size()]);
+    uint32_t found_num = chained_ht.MultiQuery(keys.data(), keys.size(),
+                                               values.data(), found.get());
+
+    uint32_t expected_num = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        uint64_t val = 0;
+        bool res = chained_ht.Query(keys[i], &val);
+        ASSERT_EQ(found[i], res);
+        if (res) {
+            ASSERT_EQ(values[i], val);
+            expected_num++;
+        }
+    }
+    ASSERT_EQ(found_num, expected_num);
+}
+
+TEST(ByteArrayChainedHT_TESTSUITE, AdaptiveChains) {
+    srand(233);
+
+    // few base slots, so the chains run several entries long
+    int n = 1 << 16;
+    tinyptr::ByteArrayChainedHT chained_ht(n, 12, 127);
+    chained_ht.SetAdaptiveChains(true);
+
+    std::map<uint64_t, uint64_t> lala;
+    for (int i = 0; i < n; i++) {
+        uint64_t key = my_int_rand(), val = my_value_rand();
+        if (lala.find(key) == lala.end() && chained_ht.Insert(key, val)) {
+            lala[key] = val;
+        }
+    }
+
+    // the key at the end of the longest walk
+    uint64_t hot_key = 0, hot_hops = 0, val = 0;
+    for (auto& [key, value] : lala) {
+        uint64_t hops = chained_ht.QueryEntryCnt();
+        ASSERT_TRUE(chained_ht.Query(key, &val));
+        hops = chained_ht.QueryEntryCnt() - hops;
+        if (hops > hot_hops) {
+            hot_key = key, hot_hops = hops;
+        }
+    }
+    ASSERT_GT(hot_hops, 1u);
+
+    for (int i = 0; i < 1 << 12; i++) {
+        ASSERT_TRUE(chained_ht.Query(hot_key, &val));
+        ASSERT_EQ(val, lala[hot_key]);
+    }
+    uint64_t hops = chained_ht.QueryEntryCnt();
+    ASSERT_TRUE(chained_ht.Query(hot_key, &val));
+    ASSERT_EQ(chained_ht.QueryEntryCnt() - hops, 1u);
+
+    // the swaps moved entries around without losing any
+    for (auto& [key, value] : lala) {
+        ASSERT_TRUE(chained_ht.Query(key, &val));
+        ASSERT_EQ(val, value);
+        ASSERT_TRUE(chained_ht.Update(key, value + 1));
+    }
+    for (auto& [key, value] : lala) {
+        chained_ht.Free(key);
+        ASSERT_FALSE(chained_ht.Query(key, &val));
+    }
+}
+
+TEST(ByteArrayChainedHT_TESTSUITE, MaxChainLength) {
+    srand(233);
+
+    // far more keys than base slots, so the cap is hit all the time
+    int n = 1 << 16;
+    tinyptr::ByteArrayChainedHT chained_ht(n, 12, 127);
+    chained_ht.SetMaxChainLength(4);
+
+    std::map<uint64_t, uint64_t> lala;
+    int refused = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t key = my_int_rand(), val = my_value_rand();
+        if (lala.find(key) != lala.end()) {
+            continue;
+        }
+        if (chained_ht.Insert(key, val)) {
+            lala[key] = val;
+        } else {
+            refused++;
+        }
+    }
+    ASSERT_GT(refused, 0);
+    ASSERT_EQ(chained_ht.MaxChainLength(), 4u);
+
+    for (auto& [key, value] : lala) {
+        uint64_t val = 0;
+        ASSERT_TRUE(chained_ht.Query(key, &val));
+        ASSERT_EQ(val, value);
+    }
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "concurrent_bin_aware_chained_ht.h"
+#include "resizable_ht.h"
+#include "utils/rng.h"
+
+rng::rng64 rng64(123456789);
+
+using namespace tinyptr;
+using namespace std;
+
+uint64_t my_value_rand() {
+    return rng64();
+}
+
+vector<pair<uint64_t, uint64_t>> gen_data(int num_operations) {
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+    return data;
+}
+
+template <typename HTType, typename Op>
+void run_threads(HTType& ht, int num_threads, int num_operations, Op op) {
+    vector<thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int i = 0; i < num_threads; ++i) {
+        int start = i * operations_per_thread;
+        int end = (i == num_threads - 1) ? num_operations
+                                         : start + operations_per_thread;
+        threads.emplace_back([&ht, &op, start, end]() {
+            for (int j = start; j < end; ++j) {
+                op(ht, j);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+template <typename HTType>
+void parallel_insert_query_free(HTType& ht, int num_threads,
+                                const vector<pair<uint64_t, uint64_t>>& data) {
+    int num_operations = data.size();
+
+    auto start = chrono::high_resolution_clock::now();
+    run_threads(ht, num_threads, num_operations, [&](HTType& ht, int i) {
+        ASSERT_TRUE(ht.Insert(data[i].first, data[i].second));
+    });
+    auto end = chrono::high_resolution_clock::now();
+    std::cout
+        << "insert time: "
+        << chrono::duration_cast<chrono::milliseconds>(end - start).count()
+        << "ms" << std::endl;
+
+    start = chrono::high_resolution_clock::now();
+    run_threads(ht, num_threads, num_operations, [&](HTType& ht, int i) {
+        uint64_t val = 0;
+        ASSERT_TRUE(ht.Query(data[i].first, &val));
+        ASSERT_EQ(val, data[i].second);
+    });
+    end = chrono::high_resolution_clock::now();
+    std::cout
+        << "query time: "
+        << chrono::duration_cast<chrono::milliseconds>(end - start).count()
+        << "ms" << std::endl;
+
+    run_threads(ht, num_threads, num_operations, [&](HTType& ht, int i) {
+        if (i & 1) {
+            ht.Free(data[i].first);
+        } else {
+            ASSERT_TRUE(ht.Update(data[i].first, ~data[i].second));
+        }
+    });
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(ht.Query(data[i].first, &val), !(i & 1));
+        if (!(i & 1)) {
+            ASSERT_EQ(val, ~data[i].second);
+        }
+    }
+
+    // freed slots, single and double, take new keys again
+    run_threads(ht, num_threads, num_operations, [&](HTType& ht, int i) {
+        if (i & 1) {
+            ASSERT_TRUE(ht.Insert(data[i].first, data[i].second));
+        }
+    });
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_TRUE(ht.Query(data[i].first, &val));
+        ASSERT_EQ(val, (i & 1) ? data[i].second : ~data[i].second);
+    }
+}
+
+TEST(ConcurrentBinAwareChainedHT_TESTSUITE, ParallelInsertQueryFree) {
+    srand(233);
+
+    int num_operations = 1 << 20;
+    vector<pair<uint64_t, uint64_t>> data = gen_data(num_operations);
+
+    ConcurrentBinAwareChainedHT ht(num_operations * 1.2);
+    parallel_insert_query_free(ht, 4, data);
+
+    // chains of two or more keep moving into pairs
+    std::cout << "double slots in use: " << ht.DoubleSlotCnt()
+              << ", avg chain length: " << ht.AvgChainLength() << std::endl;
+    ASSERT_GT(ht.DoubleSlotCnt(), 0u);
+}
+
+TEST(ConcurrentSameBinChainedHT_TESTSUITE, ParallelInsertQueryFree) {
+    srand(233);
+
+    int num_operations = 1 << 20;
+    vector<pair<uint64_t, uint64_t>> data = gen_data(num_operations);
+
+    ConcurrentSameBinChainedHT ht(num_operations * 1.2);
+    parallel_insert_query_free(ht, 4, data);
+    ASSERT_EQ(ht.DoubleSlotCnt(), 0u);
+}
+
+// readers of the stable half must never miss while the other half is freed
+// and reinserted, moving the tails of the chains they walk
+TEST(ConcurrentBinAwareChainedHT_TESTSUITE, ReadersDuringChurn) {
+    srand(233);
+
+    int num_operations = 1 << 18;
+    int num_readers = 2;
+    int num_writers = 2;
+    vector<pair<uint64_t, uint64_t>> data = gen_data(num_operations);
+
+    ConcurrentBinAwareChainedHT ht(num_operations * 1.2);
+    for (int i = 0; i < num_operations; ++i) {
+        ASSERT_TRUE(ht.Insert(data[i].first, data[i].second));
+    }
+
+    atomic<bool> stop(false);
+    vector<thread> threads;
+    for (int t = 0; t < num_writers; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < 4; ++round) {
+                for (int i = 2 * t + 1; i < num_operations;
+                     i += 2 * num_writers) {
+                    ht.Free(data[i].first);
+                    ASSERT_TRUE(ht.Insert(data[i].first, data[i].second));
+                }
+            }
+        });
+    }
+    for (int t = 0; t < num_readers; ++t) {
+        threads.emplace_back([&, t]() {
+            while (!stop.load()) {
+                for (int i = 2 * t; i < num_operations; i += 2 * num_readers) {
+                    uint64_t val = 0;
+                    ASSERT_TRUE(ht.Query(data[i].first, &val));
+                    ASSERT_EQ(val, data[i].second);
+                }
+            }
+        });
+    }
+    for (int t = 0; t < num_writers; ++t) {
+        threads[t].join();
+    }
+    stop.store(true);
+    for (int t = num_writers; t < num_writers + num_readers; ++t) {
+        threads[t].join();
+    }
+
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_TRUE(ht.Query(data[i].first, &val));
+        ASSERT_EQ(val, data[i].second);
+    }
+}
+
+template <typename ResizableType>
+void resizable_insert_query_erase(int num_threads, int num_operations) {
+    vector<pair<uint64_t, uint64_t>> data = gen_data(num_operations);
+
+    // small partitions, so every one of them resizes
+    ResizableType ht(1 << 12, 4, num_threads);
+
+    vector<thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * operations_per_thread;
+        int end = (t == num_threads - 1) ? num_operations
+                                         : start + operations_per_thread;
+        threads.emplace_back([&ht, &data, start, end]() {
+            uint64_t handle = ht.GetHandle();
+            for (int i = start; i < end; ++i) {
+                ASSERT_TRUE(ht.Insert(handle, data[i].first, data[i].second));
+            }
+            for (int i = start; i < end; i += 2) {
+                ht.Erase(handle, data[i].first);
+            }
+            ht.FreeHandle(handle);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t handle = ht.GetHandle();
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        int start = min(i / operations_per_thread, num_threads - 1) *
+                    operations_per_thread;
+        bool erased = !((i - start) & 1);
+        ASSERT_EQ(ht.Query(handle, data[i].first, &val), !erased);
+        if (!erased) {
+            ASSERT_EQ(val, data[i].second);
+        }
+    }
+    ht.FreeHandle(handle);
+}
+
+TEST(ResizableBinAwareChainedHT_TESTSUITE, ParallelInsertQueryErase) {
+    srand(233);
+    resizable_insert_query_erase<ResizableBinAwareChainedHT>(4, 1 << 18);
+}
+
+TEST(ResizableSameBinChainedHT_TESTSUITE, ParallelInsertQueryErase) {
+    srand(233);
+    resizable_insert_query_erase<ResizableSameBinChainedHT>(4, 1 << 18);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
@@ -139,6 +140,198 @@ TEST(ConcurrentByteArrayChainedHT_TESTSUITE, ParallelInsertQuery) {
         << "ms" << std::endl;
 }
 
+TEST(ConcurrentByteArrayChainedHT_TESTSUITE, MultiQuery) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 20;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    // few base slots, so the chains run several entries long
+    ConcurrentByteArrayChainedHT ht(num_operations * 2, uint8_t(16),
+                                    uint16_t(127));
+
+    // the first half is in place; the second half goes in while the first is
+    // looked up, so the walks race with writers on the same chains
+    int half = num_operations / 2;
+    concurrent_insert(ht, data, 0, half);
+
+    vector<thread> threads;
+    threads.emplace_back(concurrent_insert, std::ref(ht), std::cref(data),
+                         half, num_operations);
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&ht, &data, half]() {
+            vector<uint64_t> keys(half), values(half);
+            unique_ptr<bool[]> found(new bool[half]);
+            for (int i = 0; i < half; ++i) {
+                keys[i] = data[i].first;
+            }
+            ASSERT_EQ(ht.MultiQuery(keys.data(), half, values.data(),
+                                    found.get()),
+                      uint32_t(half));
+            for (int i = 0; i < half; ++i) {
+                ASSERT_TRUE(found[i]);
+                ASSERT_EQ(values[i], data[i].second);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // and keys that were never inserted are reported missing
+    vector<uint64_t> keys(num_operations), values(num_operations);
+    unique_ptr<bool[]> found(new bool[num_operations]);
+    for (int i = 0; i < num_operations; ++i) {
+        keys[i] = i & 1 ? data[i].first : data[i].first + 1;
+    }
+    ASSERT_EQ(ht.MultiQuery(keys.data(), num_operations, values.data(),
+                            found.get()),
+              uint32_t(half));
+    for (int i = 0; i < num_operations; ++i) {
+        ASSERT_EQ(found[i], bool(i & 1));
+        if (i & 1) {
+            ASSERT_EQ(values[i], data[i].second);
+        }
+    }
+}
+
+TEST(ConcurrentByteArrayChainedHT_TESTSUITE, ConcurrentInsertFree) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 20;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    // few base slots, so appends and erases keep landing on the same chains
+    ConcurrentByteArrayChainedHT ht(num_operations * 2, uint8_t(16),
+                                    uint16_t(127));
+
+    // every thread erases the odd keys of its share right after inserting
+    // them, while the others append behind it
+    vector<thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * operations_per_thread;
+        int end = start + operations_per_thread;
+        threads.emplace_back([&ht, &data, start, end]() {
+            for (int i = start; i < end; ++i) {
+                ASSERT_TRUE(ht.Insert(data[i].first, data[i].second));
+                if (i & 1) {
+                    ht.Free(data[i].first);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(ht.Query(data[i].first, &val), !(i & 1));
+        if (!(i & 1)) {
+            ASSERT_EQ(val, data[i].second);
+        }
+    }
+}
+
+TEST(ConcurrentByteArrayChainedHT_TESTSUITE, AdaptiveChains) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 20;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    // few base slots, so the chains run several entries long
+    ConcurrentByteArrayChainedHT ht(num_operations * 2, uint8_t(16),
+                                    uint16_t(127));
+    ht.SetAdaptiveChains(true);
+
+    int half = num_operations / 2;
+    concurrent_insert(ht, data, 0, half);
+
+    // a small hot set is read over and over while the rest goes in, so the
+    // promotions race with appends and with each other
+    vector<thread> threads;
+    threads.emplace_back(concurrent_insert, std::ref(ht), std::cref(data),
+                         half, num_operations);
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&ht, &data, t]() {
+            for (int round = 0; round < 64; ++round) {
+                for (int i = t; i < (1 << 12); i += 2) {
+                    uint64_t val = 0;
+                    ASSERT_TRUE(ht.Query(data[i].first, &val));
+                    ASSERT_EQ(val, data[i].second);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_TRUE(ht.Query(data[i].first, &val));
+        ASSERT_EQ(val, data[i].second);
+    }
+}
+
+TEST(ConcurrentByteArrayChainedHT_TESTSUITE, MaxChainLength) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 20;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    // few base slots, so racing appends keep meeting at the cap
+    ConcurrentByteArrayChainedHT ht(num_operations * 2, uint8_t(16),
+                                    uint16_t(127));
+    ht.SetMaxChainLength(8);
+
+    unique_ptr<bool[]> inserted(new bool[num_operations]);
+    vector<thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * operations_per_thread;
+        int end = start + operations_per_thread;
+        threads.emplace_back([&ht, &data, &inserted, start, end]() {
+            for (int i = start; i < end; ++i) {
+                inserted[i] = ht.Insert(data[i].first, data[i].second);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(ht.MaxChainLength(), 8u);
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(ht.Query(data[i].first, &val), inserted[i]);
+        if (inserted[i]) {
+            ASSERT_EQ(val, data[i].second);
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -140,6 +140,101 @@ TEST(ConcurrentSkulkerHT_TESTSUITE, ParallelInsertQuery) {
         << "ms" << std::endl;
 }
 
+// the same keys with and without the fingerprint lane; misses are timed, as
+// they are what the lane is for
+TEST(ConcurrentSkulkerHT_TESTSUITE, FingerprintLaneInsertQueryFree) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = (1 << 20) - 1;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL, my_value_rand()};
+    }
+
+#ifdef TINYPTR_CONCURRENT_SKULKER_QUERY_ENTRY_CNT
+    // tiny pointers followed by the miss queries, without and with the lane
+    uint64_t miss_entry_cnt[2];
+#endif
+
+    for (bool if_fingerprint : {false, true}) {
+        ConcurrentSkulkerHT ht(num_operations, 127, false, 1.0,
+                               if_fingerprint);
+        if (if_fingerprint) {
+            ASSERT_LE(ht.kBushCapacity, ht.kFingerprintLaneByteLength);
+        }
+
+        vector<thread> threads;
+        int operations_per_thread = num_operations / num_threads;
+        for (int i = 0; i < num_threads; ++i) {
+            int start = i * operations_per_thread;
+            int end = (i == num_threads - 1) ? num_operations
+                                             : start + operations_per_thread;
+            threads.emplace_back(concurrent_insert, std::ref(ht),
+                                 std::cref(data), start, end);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (int i = 0; i < num_operations; ++i) {
+            uint64_t val = 0;
+            ASSERT_TRUE(ht.Query(data[i].first, &val));
+            ASSERT_EQ(val, data[i].second);
+        }
+
+        // keys that are not multiples of 233 were never inserted
+#ifdef TINYPTR_CONCURRENT_SKULKER_QUERY_ENTRY_CNT
+        uint64_t entry_cnt = ConcurrentSkulkerHT::QueryEntryCnt();
+#endif
+        auto start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < num_operations; ++i) {
+            uint64_t val = 0;
+            ASSERT_FALSE(ht.Query(data[i].first + 1, &val));
+        }
+        auto end = chrono::high_resolution_clock::now();
+        std::cout
+            << (if_fingerprint ? "with" : "without")
+            << " fingerprint lane, miss query time: "
+            << chrono::duration_cast<chrono::milliseconds>(end - start).count()
+            << "ms" << std::endl;
+#ifdef TINYPTR_CONCURRENT_SKULKER_QUERY_ENTRY_CNT
+        miss_entry_cnt[if_fingerprint] =
+            ConcurrentSkulkerHT::QueryEntryCnt() - entry_cnt;
+        std::cout << "entries followed: " << miss_entry_cnt[if_fingerprint]
+                  << std::endl;
+#endif
+
+        for (int i = 0; i < num_operations; i += 2) {
+            ht.Free(data[i].first);
+        }
+        for (int i = 0; i < num_operations; ++i) {
+            uint64_t val = 0;
+            ASSERT_EQ(ht.Query(data[i].first, &val), bool(i & 1));
+            if (i & 1) {
+                ASSERT_EQ(val, data[i].second);
+            }
+        }
+
+        // freed slots take new keys again
+        for (int i = 0; i < num_operations; i += 2) {
+            ASSERT_TRUE(ht.Insert(data[i].first, ~data[i].second));
+        }
+        for (int i = 0; i < num_operations; ++i) {
+            uint64_t val = 0;
+            ASSERT_TRUE(ht.Query(data[i].first, &val));
+            ASSERT_EQ(val, (i & 1) ? data[i].second : ~data[i].second);
+        }
+    }
+
+#ifdef TINYPTR_CONCURRENT_SKULKER_QUERY_ENTRY_CNT
+    // the lane turns most misses away before their first tiny pointer
+    EXPECT_GT(miss_entry_cnt[0], 0u);
+    EXPECT_LT(miss_entry_cnt[1], miss_entry_cnt[0] / 2);
+#endif
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
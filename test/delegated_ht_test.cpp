@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "delegated_ht.h"
+
+using namespace tinyptr;
+using namespace std;
+
+uint64_t my_value_rand() {
+    int tmp = (rand() | (rand() >> 10 << 15));
+    return SlowXXHash64::hash(&tmp, sizeof(int32_t), 1);
+}
+
+TEST(DelegatedHT_TESTSUITE, ConcurrentBatchedInsertUpdateErase) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 16;
+    int batch_size = 64;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    // small shards, so every owner resizes several times
+    DelegatedBlastHT ht(1 << 12, 3, num_threads + 1, 2);
+
+    vector<thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * operations_per_thread;
+        int end = start + operations_per_thread;
+        threads.emplace_back([&ht, &data, start, end, batch_size]() {
+            uint64_t handle = ht.GetHandle();
+            vector<DelegatedBlastHT::Request> requests(batch_size);
+            vector<DelegatedBlastHT::Response> responses(batch_size);
+
+            for (int i = start; i < end; i += batch_size) {
+                for (int j = 0; j < batch_size; ++j) {
+                    requests[j] = {data[i + j].first, data[i + j].second,
+                                   DelegatedBlastHT::kInsert};
+                }
+                ASSERT_EQ(ht.Execute(handle, requests.data(), batch_size,
+                                     responses.data()),
+                          uint32_t(batch_size));
+            }
+
+            // each key is updated or erased, then read back in the same
+            // batch, which sees the write as it runs after it on the owner
+            for (int i = start; i < end; i += batch_size / 2) {
+                for (int j = 0; j < batch_size / 2; ++j) {
+                    uint64_t key = data[i + j].first;
+                    requests[j << 1] = {key, ~data[i + j].second,
+                                        ((i + j) & 1)
+                                            ? DelegatedBlastHT::kErase
+                                            : DelegatedBlastHT::kUpdate};
+                    requests[j << 1 | 1] = {key, 0, DelegatedBlastHT::kQuery};
+                }
+                ht.Execute(handle, requests.data(), batch_size,
+                           responses.data());
+                for (int j = 0; j < batch_size / 2; ++j) {
+                    ASSERT_TRUE(responses[j << 1].ok);
+                    ASSERT_EQ(responses[j << 1 | 1].ok, !((i + j) & 1));
+                    if (!((i + j) & 1)) {
+                        ASSERT_EQ(responses[j << 1 | 1].value,
+                                  ~data[i + j].second);
+                    }
+                }
+            }
+            ht.FreeHandle(handle);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_GT(ht.GetResizeNum(), 0u);
+
+    uint64_t handle = ht.GetHandle();
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(ht.Query(handle, data[i].first, &val), !(i & 1));
+        if (!(i & 1)) {
+            ASSERT_EQ(val, ~data[i].second);
+        }
+    }
+    ht.FreeHandle(handle);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <map>
 #include <utility>
+#include <vector>
 #include "dereference_table_64.h"
 #include "utils/xxhash64.h"
 
@@ -53,6 +54,36 @@ TEST(DereferenceTable64_TESTSUITE, RandomAll) {
     }
 }
 
+// keys up to kBinSize + 1 look like the free list pointers kept in free
+// slots, so they go down a different path than the large hashed keys
+TEST(DereferenceTable64_TESTSUITE, SmallKeys) {
+    srand(233);
+
+    int m = 1e4;
+    DereferenceTable64 dereftab(m);
+    vector<uint8_t> ptrs(m);
+
+    for (int round = 0; round < 3; ++round) {
+        for (int key = 0; key < m; ++key) {
+            ptrs[key] = dereftab.Allocate(key, ~uint64_t(key));
+            ASSERT_NE(ptrs[key], 0);
+        }
+#ifdef TINYPTR_DEREFTAB64_KEY_UNIQUENESS_CHECK
+        for (int key = 0; key < m; key += 7) {
+            ASSERT_EQ(dereftab.Allocate(key, 0), 0);
+        }
+#endif
+        for (int key = 0; key < m; ++key) {
+            uint64_t val;
+            ASSERT_TRUE(dereftab.Query(key, ptrs[key], &val));
+            ASSERT_EQ(val, ~uint64_t(key));
+        }
+        for (int key = 0; key < m; ++key) {
+            ASSERT_TRUE(dereftab.Free(key, ptrs[key]));
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,155 @@
+#include "utils/flat_overflow_map.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "o2v_overflow_table.h"
+#include "overflow_table.h"
+#include "utils/rng.h"
+
+rng::rng64 rng64(123456789);
+
+using namespace std;
+
+// random inserts, updates and erases against std::unordered_map; a small
+// key range keeps erased keys coming back, over tombstones
+TEST(FlatOverflowMap_TESTSUITE, MatchesUnorderedMap) {
+    utils::FlatOverflowMap<2> map(0);
+    unordered_map<uint64_t, pair<uint64_t, uint64_t>> ref;
+
+    int num_operations = 1 << 20;
+    uint64_t key_range = 1 << 14;
+    for (int i = 0; i < num_operations; ++i) {
+        // key 0 included
+        uint64_t key = rng64() % key_range;
+        uint64_t values[2] = {rng64(), rng64()};
+        switch (rng64() % 4) {
+            case 0:
+                ASSERT_EQ(map.Insert(key, values, true), !ref.count(key));
+                ref.insert({key, {values[0], values[1]}});
+                break;
+            case 1:
+                ASSERT_EQ(map.Update(key, 1, values[1]), ref.count(key) > 0);
+                if (ref.count(key)) {
+                    ref[key].second = values[1];
+                }
+                break;
+            case 2:
+                ASSERT_EQ(map.Erase(key), ref.erase(key) > 0);
+                break;
+            default: {
+                uint64_t val = 0;
+                ASSERT_EQ(map.Query(key, 0, &val), ref.count(key) > 0);
+                if (ref.count(key)) {
+                    ASSERT_EQ(val, ref[key].first);
+                }
+            }
+        }
+        ASSERT_EQ(map.Size(), ref.size());
+    }
+
+    for (auto& [key, vv] : ref) {
+        uint64_t val = 0;
+        ASSERT_TRUE(map.Query(key, 0, &val));
+        ASSERT_EQ(val, vv.first);
+        ASSERT_TRUE(map.Query(key, 1, &val));
+        ASSERT_EQ(val, vv.second);
+    }
+    // tombstones were cleared in place, the map never outgrew the key range
+    ASSERT_LE(map.Capacity(), key_range * 4);
+}
+
+// writers grow the map from its minimum while readers query keys they
+// inserted before, which must never go missing across the rebuilds
+TEST(FlatOverflowMap_TESTSUITE, ConcurrentGrowth) {
+    int num_threads = 4;
+    int num_operations = 1 << 18;
+    int num_stable = 1 << 10;
+
+    utils::FlatOverflowMap<1> map(0, true);
+    for (int i = 0; i < num_stable; ++i) {
+        uint64_t value = ~uint64_t(i);
+        ASSERT_TRUE(map.Insert(i, &value, false));
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    atomic<bool> stop(false);
+    vector<thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = num_stable + t; i < num_operations;
+                 i += num_threads) {
+                uint64_t value = i;
+                ASSERT_TRUE(map.Insert(i, &value, true));
+                if (i & 1) {
+                    ASSERT_TRUE(map.Update(i, 0, ~value));
+                } else {
+                    ASSERT_TRUE(map.Erase(i));
+                }
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        while (!stop.load()) {
+            for (int i = 0; i < num_stable; ++i) {
+                uint64_t val = 0;
+                ASSERT_TRUE(map.Query(i, 0, &val));
+                ASSERT_EQ(val, ~uint64_t(i));
+            }
+        }
+    });
+    for (int t = 0; t < num_threads; ++t) {
+        threads[t].join();
+    }
+    stop.store(true);
+    threads.back().join();
+    auto end = chrono::high_resolution_clock::now();
+    std::cout
+        << "concurrent insert/update/erase time: "
+        << chrono::duration_cast<chrono::milliseconds>(end - start).count()
+        << "ms, capacity: " << map.Capacity() << std::endl;
+
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        bool live = i < num_stable || (i & 1);
+        ASSERT_EQ(map.Query(i, 0, &val), live);
+        if (live) {
+            ASSERT_EQ(val, ~uint64_t(i));
+        }
+    }
+    ASSERT_EQ(map.Size(), num_stable + (num_operations - num_stable) / 2);
+}
+
+TEST(FlatOverflowMap_TESTSUITE, OverflowTables) {
+    int num_operations = 1 << 16;
+
+    tinyptr::OverflowTable o_tab(16);
+    tinyptr::O2VOverflowTable o2v_tab(16);
+    for (int i = 0; i < num_operations; ++i) {
+        ASSERT_TRUE(o_tab.Allocate(i * 233ULL, i));
+        ASSERT_TRUE(o2v_tab.Allocate(i * 233ULL, i, ~uint64_t(i)));
+    }
+    for (int i = 0; i < num_operations; i += 2) {
+        ASSERT_TRUE(o_tab.Free(i * 233ULL));
+        o2v_tab.Free(i * 233ULL);
+    }
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(o_tab.Query(i * 233ULL, &val), bool(i & 1));
+        ASSERT_EQ(o2v_tab.QuerySecond(i * 233ULL), (i & 1) ? ~uint64_t(i) : 0);
+        if (i & 1) {
+            ASSERT_EQ(val, uint64_t(i));
+            ASSERT_EQ(o2v_tab.QueryFirst(i * 233ULL), uint64_t(i));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
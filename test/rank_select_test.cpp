@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "utils/rank_select.h"
+#include "utils/rng.h"
+
+using namespace std;
+
+rng::rng64 rng64(123456789);
+
+uint32_t naive_rank(uint64_t bits, uint32_t pos) {
+    uint32_t res = 0;
+    for (uint32_t i = 0; i < pos; i++) {
+        res += (bits >> i) & 1;
+    }
+    return res;
+}
+
+uint32_t naive_select(uint64_t bits, uint32_t rank) {
+    for (uint32_t i = 0; i < 64; i++) {
+        if (((bits >> i) & 1) && rank-- == 0) {
+            return i;
+        }
+    }
+    return 64;
+}
+
+// words of every density, from a single bit to all of them
+vector<uint64_t> gen_words(int n) {
+    vector<uint64_t> words(n);
+    for (int i = 0; i < n; i++) {
+        uint64_t word = rng64();
+        for (int j = i % 4; j > 0; j--) {
+            word &= rng64();
+        }
+        words[i] = word | (1ULL << (i & 63));
+    }
+    words[0] = ~0ULL;
+    words[1] = 1ULL << 63;
+    return words;
+}
+
+TEST(RankSelect_TESTSUITE, MatchesNaive) {
+    vector<uint64_t> words = gen_words(1 << 14);
+
+    for (uint64_t word : words) {
+        for (uint32_t pos = 0; pos <= 64; pos++) {
+            ASSERT_EQ(utils::Rank64(word, pos), naive_rank(word, pos));
+            ASSERT_EQ(utils::Rank64Broadword(word, pos),
+                      naive_rank(word, pos));
+        }
+        for (uint32_t rank = 0; rank < utils::Popcount64(word); rank++) {
+            ASSERT_EQ(utils::Select64(word, rank), naive_select(word, rank));
+            ASSERT_EQ(utils::Select64Broadword(word, rank),
+                      naive_select(word, rank));
+        }
+    }
+
+    for (int i = 0; i + 1 < (int)words.size(); i += 2) {
+        for (uint32_t pos = 0; pos <= 128; pos++) {
+            uint32_t expected =
+                pos <= 64 ? naive_rank(words[i], pos)
+                          : utils::Popcount64(words[i]) +
+                                naive_rank(words[i + 1], pos - 64);
+            ASSERT_EQ(utils::Rank128(words[i], words[i + 1], pos), expected);
+        }
+    }
+}
+
+// microbenchmarks: each kernel over the same words, with the positions and
+// ranks drawn up front, reporting ns per call; the sum keeps the calls alive
+
+template <typename Kernel>
+void time_kernel(const char* name, const vector<uint64_t>& words,
+                 const vector<uint32_t>& args, Kernel kernel) {
+    uint64_t sum = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (int round = 0; round < 16; round++) {
+        for (size_t i = 0; i < words.size(); i++) {
+            sum += kernel(words[i], args[i]);
+        }
+    }
+    auto end = chrono::high_resolution_clock::now();
+    double ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    std::cout << name << ": " << ns / (16.0 * words.size()) << " ns/op"
+              << " (checksum " << sum << ")" << std::endl;
+}
+
+TEST(RankSelect_TESTSUITE, Microbenchmark) {
+    vector<uint64_t> words = gen_words(1 << 20);
+    vector<uint32_t> positions(words.size()), ranks(words.size());
+    for (size_t i = 0; i < words.size(); i++) {
+        positions[i] = rng64() % 65;
+        ranks[i] = rng64() % utils::Popcount64(words[i]);
+    }
+
+    time_kernel("Rank64", words, positions,
+                [](uint64_t w, uint32_t p) { return utils::Rank64(w, p); });
+    time_kernel("Rank64Broadword", words, positions,
+                [](uint64_t w, uint32_t p) {
+                    return utils::Rank64Broadword(w, p);
+                });
+    time_kernel("Rank128", words, positions, [](uint64_t w, uint32_t p) {
+        return utils::Rank128(w, ~w, p << 1);
+    });
+    time_kernel("Select64", words, ranks,
+                [](uint64_t w, uint32_t r) { return utils::Select64(w, r); });
+    time_kernel("Select64Broadword", words, ranks, [](uint64_t w, uint32_t r) {
+        return utils::Select64Broadword(w, r);
+    });
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
@@ -35,27 +36,21 @@ uint64_t my_value_rand() {
     // return SlowXXHash64::hash(&tmp, sizeof(int32_t), 1);
 }
 
-void concurrent_insert(ResizableBlastHT& ht,
-                       const vector<pair<uint64_t, uint64_t>>& data, int start,
-                       int end) {
+template <typename HTType>
+void concurrent_insert(HTType& ht, const vector<pair<uint64_t, uint64_t>>& data,
+                       int start, int end) {
 
     uint64_t handle = ht.GetHandle();
     for (int i = start; i < end; ++i) {
-        if (!ht.Insert(handle, data[i].first, data[i].second)) {
-            printf("insert failed: %lu, %lu\n", data[i].first,
-                   data[i].second);
-            // printf("handle: %llu\n", handle);
-            // printf("i: %llu\n", i);
-            // ht.FreeHandle(handle);
-            // exit(0);
-        }
+        EXPECT_TRUE(ht.Insert(handle, data[i].first, data[i].second))
+            << "insert failed: " << data[i].first << ", " << data[i].second;
     }
     ht.FreeHandle(handle);
 }
 
-void concurrent_query(ResizableBlastHT& ht,
-                      const vector<pair<uint64_t, uint64_t>>& data, int start,
-                      int end) {
+template <typename HTType>
+void concurrent_query(HTType& ht, const vector<pair<uint64_t, uint64_t>>& data,
+                      int start, int end) {
     uint64_t handle = ht.GetHandle();
     for (int i = start; i < end; ++i) {
         uint64_t val = 0;
@@ -68,6 +63,53 @@ void concurrent_query(ResizableBlastHT& ht,
     ht.FreeHandle(handle);
 }
 
+template <typename HTType>
+void buffered_insert(HTType& ht, const vector<pair<uint64_t, uint64_t>>& data,
+                     int start, int end) {
+    uint64_t handle = ht.GetHandle();
+    for (int i = start; i < end; ++i) {
+        ASSERT_TRUE(ht.InsertBuffered(handle, data[i].first, data[i].second));
+
+        // read-your-writes, whether the entry is still buffered or not
+        uint64_t val = 0;
+        ASSERT_TRUE(ht.QueryBuffered(handle, data[i].first, &val));
+        ASSERT_EQ(val, data[i].second);
+    }
+    ASSERT_TRUE(ht.Flush(handle));
+    ht.FreeHandle(handle);
+}
+
+// num_operations distinct keys, none of them 0, with random values
+vector<pair<uint64_t, uint64_t>> make_data(int num_operations) {
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+    return data;
+}
+
+// runs worker on num_threads threads, each on its own slice of data, and
+// waits for all of them
+template <typename HTType>
+void fan_out(HTType& ht, const vector<pair<uint64_t, uint64_t>>& data,
+             int num_threads,
+             void (*worker)(HTType&, const vector<pair<uint64_t, uint64_t>>&,
+                            int, int)) {
+    int num_operations = data.size();
+    int operations_per_thread = num_operations / num_threads;
+    vector<thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        int start = i * operations_per_thread;
+        int end = (i == num_threads - 1) ? num_operations
+                                         : start + operations_per_thread;
+        threads.emplace_back(worker, std::ref(ht), std::cref(data), start,
+                             end);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 TEST(ResizableBlastHT_TESTSUITE, ParallelInsertQuery) {
     srand(233);
 
@@ -111,8 +153,8 @@ TEST(ResizableBlastHT_TESTSUITE, ParallelInsertQuery) {
         int start = i * operations_per_thread;
         int end = (i == num_threads - 1) ? num_operations
                                          : start + operations_per_thread;
-        insert_threads.emplace_back(concurrent_insert, std::ref(ht),
-                                    std::cref(data), start, end);
+        insert_threads.emplace_back(concurrent_insert<ResizableBlastHT>,
+                                    std::ref(ht), std::cref(data), start, end);
     }
 
     for (auto& thread : insert_threads) {
@@ -132,8 +174,8 @@ TEST(ResizableBlastHT_TESTSUITE, ParallelInsertQuery) {
         int start = i * operations_per_thread;
         int end = (i == num_threads - 1) ? num_operations
                                          : start + operations_per_thread;
-        query_threads.emplace_back(concurrent_query, std::ref(ht),
-                                   std::cref(data), start, end);
+        query_threads.emplace_back(concurrent_query<ResizableBlastHT>,
+                                   std::ref(ht), std::cref(data), start, end);
     }
 
     for (auto& thread : query_threads) {
@@ -147,6 +189,195 @@ TEST(ResizableBlastHT_TESTSUITE, ParallelInsertQuery) {
         << "ms" << std::endl;
 }
 
+TEST(ResizableBlastHT_TESTSUITE, OversubscribedResize) {
+    srand(233);
+
+    // more threads than cores, so resizers and helpers get descheduled while
+    // others wait on them
+    int num_threads =
+        4 * std::max(1u, std::thread::hardware_concurrency());
+    auto data = make_data(1 << 21);
+
+    ResizableBlastHT ht(4096, 4, num_threads);
+
+    fan_out(ht, data, num_threads, concurrent_insert<ResizableBlastHT>);
+    fan_out(ht, data, num_threads, concurrent_query<ResizableBlastHT>);
+
+    // with every handle released, the next reclaim pass frees all replaced
+    // partitions
+    uint64_t handle = ht.GetHandle();
+    ht.FreeHandle(handle);
+    EXPECT_EQ(ht.GetRetiredPartitionNum(), 0);
+
+    // every inserted key made it through the resizes
+    concurrent_query(ht, data, 0, data.size());
+    EXPECT_GT(ht.GetResizeNum(), uint64_t(0));
+
+    // with this many threads per core, someone waited, and every wait was
+    // resolved either spinning or parked
+    uint64_t wait_cnt = 0;
+    for (uint8_t site = 0; site < ResizableBlastHT::kWaitSiteNum; ++site) {
+        auto stats =
+            ht.GetWaitStats(static_cast<ResizableBlastHT::WaitSite>(site));
+        std::cout << "wait site " << int(site)
+                  << " spin exits: " << stats.spin_exit_cnt
+                  << " parks: " << stats.park_cnt
+                  << " wakes: " << stats.wake_cnt << std::endl;
+        wait_cnt += stats.spin_exit_cnt + stats.park_cnt;
+    }
+    EXPECT_GT(wait_cnt, uint64_t(0));
+}
+
+// a handle that is held but not used must not hold up resizes; they would
+// wait for it forever
+TEST(ResizableBlastHT_TESTSUITE, IdleHandle) {
+    srand(233);
+
+    ResizableBlastHT ht(4096, 4, 2);
+
+    uint64_t idle_handle = ht.GetHandle();
+    uint64_t val = 0;
+    ASSERT_FALSE(ht.Query(idle_handle, 1, &val));
+
+    auto data = make_data(1 << 20);
+    fan_out(ht, data, 1, concurrent_insert<ResizableBlastHT>);
+    EXPECT_GT(ht.GetResizeNum(), uint64_t(0));
+
+    concurrent_query(ht, data, 0, data.size());
+    ht.FreeHandle(idle_handle);
+}
+
+TEST(ResizableBlastHT_TESTSUITE, SplitFromFewPartitions) {
+    srand(233);
+
+    int num_threads = 4;
+    int part_num = 2;
+    int max_part_num = 64;
+    auto data = make_data(1 << 21);
+
+    // every resize below max_part_num splits a partition instead of growing it
+    ResizableBlastHT ht(1 << 14, part_num, num_threads, false, 0.7, 2.0,
+                        max_part_num);
+
+    fan_out(ht, data, num_threads, concurrent_insert<ResizableBlastHT>);
+
+    EXPECT_EQ(ht.GetPartitionNum(), uint64_t(max_part_num));
+
+    // every split shows up in the resize log, with its phases in order
+    uint64_t split_cnt = 0;
+    for (auto& record : ht.GetResizeLog()) {
+        split_cnt += record.split_id != record.part_id;
+        EXPECT_LE(record.start_ns, record.grace_ns);
+        EXPECT_LE(record.grace_ns, record.alloc_ns);
+        EXPECT_LE(record.alloc_ns, record.migrate_ns);
+        EXPECT_LE(record.migrate_ns, record.drain_ns);
+        EXPECT_LE(record.drain_ns, record.swap_ns);
+    }
+    EXPECT_EQ(split_cnt, uint64_t(max_part_num - part_num));
+    EXPECT_EQ(ht.GetResizeLog().size(), ht.GetResizeNum());
+
+    fan_out(ht, data, num_threads, concurrent_query<ResizableBlastHT>);
+}
+
+TEST(ResizableBlastHT_TESTSUITE, PreallocatedResize) {
+    srand(233);
+
+    int num_threads = 4;
+    auto data = make_data(1 << 21);
+
+    // start building the next tables at 80% of the resize threshold, and
+    // split up to 64 partitions: a split keeps the table size, so the tables
+    // one level frees are the size the next level's splits build
+    ResizableBlastHT ht(1 << 14, 4, num_threads, false, 0.7, 2.0, 64, 0.8);
+
+    fan_out(ht, data, num_threads, concurrent_insert<ResizableBlastHT>);
+    fan_out(ht, data, num_threads, concurrent_query<ResizableBlastHT>);
+
+    auto stats = ht.GetPagePoolStats();
+    std::cout << "prepared resizes: " << ht.GetPreparedResizeNum()
+              << " mapped: " << stats.map_cnt << " reused: " << stats.reuse_cnt
+              << " cached bytes: " << stats.cached_bytes << std::endl;
+
+    EXPECT_GT(ht.GetPreparedResizeNum(), 0u);
+    EXPECT_GT(stats.reuse_cnt, 0u);
+}
+
+TEST(ResizableBlastHT_TESTSUITE, InsertFailureForcesResize) {
+    srand(233);
+
+    int num_threads = 4;
+    auto data = make_data(1 << 20);
+
+    // the count threshold is above capacity, so only failed inserts resize
+    ResizableBlastHT ht(1 << 14, 4, num_threads, false, 1.2, 2.0, 0, 1.0);
+
+    fan_out(ht, data, num_threads, concurrent_insert<ResizableBlastHT>);
+    fan_out(ht, data, num_threads, concurrent_query<ResizableBlastHT>);
+
+    EXPECT_GT(ht.GetResizeNum(), uint64_t(0));
+    for (auto& record : ht.GetResizeLog()) {
+        EXPECT_TRUE(record.forced);
+    }
+}
+
+// a BlastHT whose first failed_move_num stride moves copy nothing and report
+// it, as moves whose entries did not fit the new tables would
+class FailingMoveBlastHT : public BlastHT {
+   public:
+    using BlastHT::BlastHT;
+
+    static std::atomic<int> failed_move_num;
+
+    bool ResizeMoveStride(uint64_t stride_id, FailingMoveBlastHT* new_ht,
+                          FailingMoveBlastHT* split_ht = nullptr,
+                          PartitionRouter router = {}, uint64_t split_bit = 0) {
+        if (failed_move_num.fetch_sub(1) > 0) {
+            return false;
+        }
+        return BlastHT::ResizeMoveStride<BlastHT>(stride_id, new_ht, split_ht,
+                                                  router, split_bit);
+    }
+};
+
+std::atomic<int> FailingMoveBlastHT::failed_move_num(0);
+
+// failed moves of splitting resizes are redone into larger tables, and no
+// key is lost
+TEST(ResizableBlastHT_TESTSUITE, SplitMoveFailureRetries) {
+    srand(233);
+
+    using FailingMoveHT = ResizableHT<FailingMoveBlastHT>;
+    auto data = make_data(1 << 20);
+
+    FailingMoveBlastHT::failed_move_num.store(8);
+    FailingMoveHT ht(1 << 14, 2, 4, false, 0.7, 2.0, 16);
+
+    fan_out(ht, data, 4, concurrent_insert<FailingMoveHT>);
+
+    uint64_t split_cnt = 0, move_retry_num = 0;
+    for (auto& record : ht.GetResizeLog()) {
+        split_cnt += record.split_id != record.part_id;
+        move_retry_num += record.move_retry_num;
+    }
+    EXPECT_GT(split_cnt, uint64_t(0));
+    EXPECT_GT(move_retry_num, uint64_t(0));
+
+    concurrent_query(ht, data, 0, data.size());
+}
+
+TEST(ResizableBlastHT_TESTSUITE, BufferedInsert) {
+    srand(233);
+
+    int num_threads = 4;
+    auto data = make_data(1 << 21);
+
+    // partitions split while entries sit in the buffers
+    ResizableBlastHT ht(1 << 14, 4, num_threads, false, 0.7, 2.0, 32);
+
+    fan_out(ht, data, num_threads, buffered_insert<ResizableBlastHT>);
+    fan_out(ht, data, num_threads, concurrent_query<ResizableBlastHT>);
+}
+
 int main(int argc, char** argv) {
     srand(233);
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "resizable_ht.h"
+#include "utils/rng.h"
+
+rng::rng64 rng64(123456789);
+
+using namespace tinyptr;
+using namespace std;
+
+uint64_t my_value_rand() {
+    return rng64();
+}
+
+void concurrent_insert(ResizableHybridHT& ht,
+                       const vector<pair<uint64_t, uint64_t>>& data, int start,
+                       int end) {
+    uint64_t handle = ht.GetHandle();
+    for (int i = start; i < end; ++i) {
+        if (!ht.Insert(handle, data[i].first, data[i].second)) {
+            printf("insert failed: %lu, %lu\n", data[i].first,
+                   data[i].second);
+            ht.FreeHandle(handle);
+            exit(0);
+        }
+    }
+    ht.FreeHandle(handle);
+}
+
+void concurrent_query(ResizableHybridHT& ht,
+                      const vector<pair<uint64_t, uint64_t>>& data, int start,
+                      int end) {
+    uint64_t handle = ht.GetHandle();
+    for (int i = start; i < end; ++i) {
+        uint64_t val = 0;
+        ASSERT_TRUE(ht.Query(handle, data[i].first, &val));
+        ASSERT_EQ(val, data[i].second);
+    }
+    ht.FreeHandle(handle);
+}
+
+TEST(ResizableHybridHT_TESTSUITE, ParallelInsertQuery) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 21;
+    int part_num = 16;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    ResizableHybridHT ht(1 << 14, part_num, num_threads);
+
+    vector<thread> insert_threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int i = 0; i < num_threads; ++i) {
+        int start = i * operations_per_thread;
+        int end = (i == num_threads - 1) ? num_operations
+                                         : start + operations_per_thread;
+        insert_threads.emplace_back(concurrent_insert, std::ref(ht),
+                                    std::cref(data), start, end);
+    }
+    for (auto& thread : insert_threads) {
+        thread.join();
+    }
+
+    // insert-only traffic never makes a partition hot
+    for (auto& record : ht.GetResizeLog()) {
+        EXPECT_FALSE(record.hot);
+    }
+
+    vector<thread> query_threads;
+    for (int i = 0; i < num_threads; ++i) {
+        int start = i * operations_per_thread;
+        int end = (i == num_threads - 1) ? num_operations
+                                         : start + operations_per_thread;
+        query_threads.emplace_back(concurrent_query, std::ref(ht),
+                                   std::cref(data), start, end);
+    }
+    for (auto& thread : query_threads) {
+        thread.join();
+    }
+}
+
+TEST(ResizableHybridHT_TESTSUITE, SkewedTrafficTurnsPartitionHot) {
+    srand(233);
+
+    int num_operations = 1 << 20;
+    int part_num = 16;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    ResizableHybridHT ht(1 << 12, part_num, 1, false, 0.7, 2.0, 0, 1.0);
+    uint64_t handle = ht.GetHandle();
+
+    // grows every partition about once
+    auto insert_round = [&](int& next) {
+        uint64_t target = ht.GetResizeNum() + part_num;
+        while (ht.GetResizeNum() < target && next < num_operations) {
+            ASSERT_TRUE(
+                ht.Insert(handle, data[next].first, data[next].second));
+            next++;
+        }
+    };
+
+    int next = 0;
+    insert_round(next);
+
+    // one key takes almost all of the reads, so its partition runs hot
+    uint64_t val = 0;
+    for (int i = 0; i < (1 << 20); ++i) {
+        ASSERT_TRUE(ht.Query(handle, data[0].first, &val));
+    }
+
+    uint64_t hot_round_begin = ht.GetResizeNum();
+    insert_round(next);
+    uint64_t cold_round_begin = ht.GetResizeNum();
+    // without the reads, the hot partition goes back to chained
+    insert_round(next);
+    insert_round(next);
+
+    ht.FreeHandle(handle);
+
+    vector<ResizableHybridHT::ResizeRecord> log = ht.GetResizeLog();
+    ASSERT_EQ(log.size(), ht.GetResizeNum());
+
+    vector<bool> went_hot(part_num, false);
+    for (uint64_t i = 0; i < hot_round_begin; ++i) {
+        EXPECT_FALSE(log[i].hot);
+    }
+    for (uint64_t i = hot_round_begin; i < cold_round_begin; ++i) {
+        went_hot[log[i].part_id] = went_hot[log[i].part_id] || log[i].hot;
+    }
+    EXPECT_EQ(count(went_hot.begin(), went_hot.end(), true), 1);
+
+    for (uint64_t i = cold_round_begin; i < log.size(); ++i) {
+        if (went_hot[log[i].part_id]) {
+            EXPECT_FALSE(log[i].hot);
+        }
+    }
+
+    // the entries survived both conversions
+    concurrent_query(ht, data, 0, next);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "single_owner_resizable_ht.h"
+
+using namespace tinyptr;
+using namespace std;
+
+uint64_t my_sparse_key_rand() {
+    int tmp = (rand() & ((1 << 15) - 1));
+    return SlowXXHash64::hash(&tmp, sizeof(int32_t), 0);
+}
+
+uint64_t my_value_rand() {
+    int tmp = (rand() | (rand() >> 10 << 15));
+    return SlowXXHash64::hash(&tmp, sizeof(int32_t), 1);
+}
+
+// grows well past the initial tables while checking every operation against
+// std::unordered_map
+template <typename HTType>
+void StdMapCompliance(HTType& ht) {
+    int n = 1 << 20;
+    std::unordered_map<uint64_t, uint64_t> lala;
+
+    for (int i = 0; i < n; i++) {
+        uint64_t key = static_cast<uint64_t>(i) * 233ULL + 1;
+        uint64_t value = my_value_rand();
+        ASSERT_TRUE(ht.Insert(key, value));
+        lala[key] = value;
+
+        key = my_sparse_key_rand(), value = my_value_rand();
+        uint64_t val = 0;
+        if (lala.find(key) != lala.end()) {
+            ASSERT_TRUE(ht.Query(key, &val));
+            ASSERT_EQ(val, lala[key]);
+            ASSERT_TRUE(ht.Update(key, value));
+            lala[key] = value;
+        } else {
+            ASSERT_FALSE(ht.Query(key, &val));
+            ASSERT_FALSE(ht.Update(key, value));
+        }
+
+        if (!(rand() & ((1 << 3) - 1))) {
+            key = static_cast<uint64_t>(rand() % (i + 1)) * 233ULL + 1;
+            ASSERT_EQ(ht.Erase(key), lala.erase(key) == 1);
+        }
+    }
+
+    ASSERT_GT(ht.GetResizeNum(), 0u);
+
+    for (int i = 0; i < n; i++) {
+        uint64_t key = static_cast<uint64_t>(i) * 233ULL + 1, val = 0;
+        if (lala.find(key) != lala.end()) {
+            ASSERT_TRUE(ht.Query(key, &val));
+            ASSERT_EQ(val, lala[key]);
+        } else {
+            ASSERT_FALSE(ht.Query(key, &val));
+        }
+    }
+}
+
+TEST(SingleOwnerResizableHT_TESTSUITE, SkulkerHT) {
+    srand(233);
+    SingleOwnerSkulkerHT ht(1 << 14, 4);
+    StdMapCompliance(ht);
+}
+
+TEST(SingleOwnerResizableHT_TESTSUITE, NonConcBlastHT) {
+    srand(233);
+    SingleOwnerBlastHT ht(1 << 14, 4);
+    StdMapCompliance(ht);
+}
+
+TEST(SingleOwnerResizableHT_TESTSUITE, ByteArrayChainedHT) {
+    srand(233);
+    SingleOwnerByteArrayChainedHT ht(1 << 14, 4);
+    StdMapCompliance(ht);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,7 @@
 #include "skulker_ht.h"
+#include "incremental_skulker_ht.h"
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
@@ -96,6 +98,76 @@ TEST(SkulkerHT_TESTSUITE, StdMapCompliance) {
     }
 }
 
+TEST(SkulkerHT_TESTSUITE, IncrementalResizeStdMapCompliance) {
+    srand(233);
+
+    int n = 1 << 20, m = 1 << 14;
+    std::unordered_map<uint64_t, uint64_t> lala;
+    // two bushes a step, so lookups run against half-moved tables for long
+    tinyptr::IncrementalSkulkerHT skulker_ht(m, 0.7, 2.0, 2);
+
+    bool seen_resizing = false;
+    for (uint64_t i = 1; i <= n; i++) {
+        uint64_t key = SlowXXHash64::hash(&i, sizeof(uint64_t), 0),
+                 new_val = my_value_rand(), val = 0;
+
+        ASSERT_TRUE(skulker_ht.Insert(key, new_val));
+        lala[key] = new_val;
+        seen_resizing |= skulker_ht.IsResizing();
+
+        uint64_t j = rand() % i + 1;
+        key = SlowXXHash64::hash(&j, sizeof(uint64_t), 0);
+        new_val = my_value_rand();
+
+        if (lala.find(key) != lala.end()) {
+            ASSERT_TRUE(skulker_ht.Query(key, &val));
+            ASSERT_EQ(val, lala[key]);
+            ASSERT_TRUE(skulker_ht.Update(key, new_val));
+            lala[key] = new_val;
+        } else {
+            ASSERT_FALSE(skulker_ht.Query(key, &val));
+        }
+
+        if (!(rand() & ((1 << 2) - 1))) {
+            skulker_ht.Free(key), lala.erase(key);
+        }
+    }
+
+    ASSERT_TRUE(seen_resizing);
+    ASSERT_GT(skulker_ht.GetResizeNum(), 0u);
+
+    for (auto& [key, value] : lala) {
+        uint64_t val = 0;
+        ASSERT_TRUE(skulker_ht.Query(key, &val));
+        ASSERT_EQ(val, value);
+    }
+}
+
+// a bound past the table's capacity lets tables fill up, so inserts and
+// stride moves keep failing into the stash; no key may go missing
+TEST(SkulkerHT_TESTSUITE, IncrementalResizeOverfull) {
+    srand(233);
+
+    int n = 1 << 18;
+    tinyptr::IncrementalSkulkerHT skulker_ht(1 << 14, 1.2, 1.1, 2);
+
+    uint64_t max_stash_size = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+        uint64_t key = SlowXXHash64::hash(&i, sizeof(uint64_t), 0);
+        ASSERT_TRUE(skulker_ht.Insert(key, i));
+        max_stash_size = std::max(max_stash_size, skulker_ht.GetStashSize());
+    }
+    std::cout << "resizes: " << skulker_ht.GetResizeNum()
+              << ", max stash size: " << max_stash_size << std::endl;
+    ASSERT_GT(max_stash_size, 0u);
+
+    for (uint64_t i = 1; i <= n; i++) {
+        uint64_t key = SlowXXHash64::hash(&i, sizeof(uint64_t), 0), val = 0;
+        ASSERT_TRUE(skulker_ht.Query(key, &val));
+        ASSERT_EQ(val, i);
+    }
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
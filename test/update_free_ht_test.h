@@ -0,0 +1,106 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "utils/xxhash64.h"
+
+// tests shared by the tables with Update and Free, and by their ResizableHT
+// wrappers; the including test file defines my_value_rand
+
+uint64_t my_value_rand();
+
+inline uint64_t my_sparse_key_rand() {
+    int tmp = (rand() & ((1 << 15) - 1));
+    return SlowXXHash64::hash(&tmp, sizeof(int32_t), 0);
+}
+
+// checks every operation against std::unordered_map; with ht sized for as
+// many entries as there are keys, most inserts land past the first choice
+template <typename HTType>
+void StdMapCompliance(HTType& ht) {
+    int n = 1e6;
+    std::unordered_map<uint64_t, uint64_t> lala;
+
+    while (n--) {
+        uint64_t key = my_sparse_key_rand(), new_val = my_value_rand(), val = 0;
+
+        if (lala.find(key) == lala.end() && ht.Insert(key, new_val)) {
+            lala[key] = new_val;
+        }
+
+        key = my_sparse_key_rand(), new_val = my_value_rand(), val = 0;
+
+        if (lala.find(key) != lala.end()) {
+            ASSERT_TRUE(ht.Query(key, &val));
+            ASSERT_EQ(val, lala[key]);
+        } else {
+            ASSERT_FALSE(ht.Query(key, &val));
+        }
+
+        if (ht.Update(key, new_val)) {
+            lala[key] = new_val;
+        }
+
+        if (!(rand() & ((1 << 3) - 1))) {
+            ht.Free(key), lala.erase(key);
+        }
+    }
+}
+
+// num_threads threads insert 2^20 keys into ResizableType, starting from
+// partitions of 2^12, then erase half of them and update the rest
+template <typename ResizableType>
+void ResizableInsertUpdateFree() {
+    int num_threads = 4;
+    int num_operations = 1 << 20;
+    int part_num = 16;
+
+    std::vector<std::pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    ResizableType ht(1 << 12, part_num, num_threads);
+
+    std::vector<std::thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * operations_per_thread;
+        int end = start + operations_per_thread;
+        threads.emplace_back([&ht, &data, start, end]() {
+            uint64_t handle = ht.GetHandle();
+            for (int i = start; i < end; ++i) {
+                ASSERT_TRUE(ht.Insert(handle, data[i].first, data[i].second));
+            }
+            for (int i = start; i < end; ++i) {
+                if (i & 1) {
+                    ht.Erase(handle, data[i].first);
+                } else {
+                    ASSERT_TRUE(
+                        ht.Update(handle, data[i].first, ~data[i].second));
+                }
+            }
+            ht.FreeHandle(handle);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_GT(ht.GetResizeNum(), 0u);
+
+    uint64_t handle = ht.GetHandle();
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(ht.Query(handle, data[i].first, &val), !(i & 1));
+        if (!(i & 1)) {
+            ASSERT_EQ(val, ~data[i].second);
+        }
+    }
+    ht.FreeHandle(handle);
+}
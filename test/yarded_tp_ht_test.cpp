@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "resizable_ht.h"
+#include "update_free_ht_test.h"
+#include "yarded_tp_ht.h"
+
+using namespace tinyptr;
+using namespace std;
+
+uint64_t my_value_rand() {
+    int tmp = (rand() | (rand() >> 10 << 15));
+    return SlowXXHash64::hash(&tmp, sizeof(int32_t), 1);
+}
+
+TEST(YardedTPHT_TESTSUITE, StdMapCompliance) {
+    srand(233);
+    // as many keys as entries, so most duplexes run into their backyards
+    YardedTPHT yarded_ht(1 << 15, 127);
+    StdMapCompliance(yarded_ht);
+}
+
+TEST(YardedTPHT_TESTSUITE, ConcurrentInsertFree) {
+    srand(233);
+
+    int num_threads = 4;
+    int num_operations = 1 << 20;
+
+    vector<pair<uint64_t, uint64_t>> data(num_operations);
+    for (int i = 0; i < num_operations; ++i) {
+        data[i] = {static_cast<uint64_t>(i) * 233ULL + 1, my_value_rand()};
+    }
+
+    ConcurrentYardedTPHT ht(num_operations * 2, uint16_t(127));
+
+    // erases free chain heads and shift the pointers of the chains next to
+    // them, while the other threads insert into the same duplexes
+    vector<thread> threads;
+    int operations_per_thread = num_operations / num_threads;
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * operations_per_thread;
+        int end = start + operations_per_thread;
+        threads.emplace_back([&ht, &data, start, end]() {
+            for (int i = start; i < end; ++i) {
+                ASSERT_TRUE(ht.Insert(data[i].first, data[i].second));
+                if (i & 1) {
+                    ht.Free(data[i].first);
+                }
+                uint64_t val = 0;
+                ASSERT_EQ(ht.Query(data[i].first, &val), !(i & 1));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < num_operations; ++i) {
+        uint64_t val = 0;
+        ASSERT_EQ(ht.Query(data[i].first, &val), !(i & 1));
+        if (!(i & 1)) {
+            ASSERT_EQ(val, data[i].second);
+        }
+    }
+}
+
+TEST(YardedTPHT_TESTSUITE, ResizableInsertUpdateFree) {
+    srand(233);
+    ResizableInsertUpdateFree<ResizableYardedTPHT>();
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}